@@ -1,4 +1,5 @@
 #include "Font.hpp"
+#include "gl_state_cache.hpp"
 
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
@@ -54,20 +55,19 @@ void Font::initialize() {
 
 //Draw a single character, given a single character, a location (x,y) for the
 // character, a shader program, and a depth (z).
-void Font::draw_char (char letter, glm::vec2 loc, Shader sProgram, float depth_change) {
+void Font::draw_char (char letter, glm::vec2 loc, Shader& sProgram, float depth_change) {
     sProgram.use();
     glm::mat4 mod = glm::mat4(1.0f);
     mod = glm::translate(mod,glm::vec3(loc.x,loc.y,depth_change));
     mod = glm::scale(mod,glm::vec3(this->scaleX,this->scaleY,1.0f));
 
 
-    sProgram.setMat4("model",mod);
-    glBindTexture(GL_TEXTURE_2D,this->getTexNum());
+    sProgram.setMat4(sProgram.draw_uniforms.model,mod);
+    GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,this->getTexNum());
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glActiveTexture(GL_TEXTURE0);
 
     unsigned char c = static_cast<unsigned char>(letter);
-    this->charVAOs[(int)letter].draw(sProgram.ID);
+    this->charVAOs[(int)letter].draw(&sProgram);
     //glBindVertexArray(this->charVAOs[(int)letter]);
     //glDrawArrays(GL_TRIANGLE_FAN, 0, this->charVAOs[(int)letter].v_size);
 
@@ -75,7 +75,7 @@ void Font::draw_char (char letter, glm::vec2 loc, Shader sProgram, float depth_c
 }
 
 //Given a string, draw all the characters to the screen.
-void Font::draw_text(std::string s, glm::vec2 start, Shader sProgram) {
+void Font::draw_text(std::string s, glm::vec2 start, Shader& sProgram) {
     float depth = -0.01;
     for (int i = 0; i < s.length(); i++) {
         unsigned char letter = static_cast<unsigned char>(s[i]);
@@ -101,6 +101,7 @@ void Font::setScale(glm::vec2 newScale) {
 int Font::getEndNum() {return this->endNum;}
 int Font::getStartNum() {return this->startNum;}
 unsigned int Font::getTexNum() {return this->texNumber;}
+glm::vec2 Font::getScale() {return glm::vec2(this->scaleX,this->scaleY);}
 Shape Font::getCharShape(int index) {
     if (index < 0 || index > 255) throw std::invalid_argument("Invalid index to Font::getCharVAO");
     return this->charVAOs[index];
@@ -21,12 +21,14 @@ class Font
         void initialize();
 
         //Draws a single character at a given x and y coordinate (lower left hand)
-        void draw_char (char letter, glm::vec2 loc, Shader sProgram, float depth_change = 0);
+        void draw_char (char letter, glm::vec2 loc, Shader& sProgram, float depth_change = 0);
         // Draws the string starting at a given X/Y coordinate (lower left hand)
-        void draw_text(std::string s, glm::vec2 start, Shader sProgram);
+        void draw_text(std::string s, glm::vec2 start, Shader& sProgram);
 
         //Re-scale the characters.
         void setScale(glm::vec2 newScale);
+        //Get the current scaling.
+        glm::vec2 getScale();
 
         //Get the last ascii character
         int getEndNum();
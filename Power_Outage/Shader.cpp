@@ -1,4 +1,10 @@
 #include "Shader.hpp"
+#include "frame_uniforms.hpp"
+#include "gl_state_cache.hpp"
+#include <algorithm>
+
+unsigned int Shader::driver_lookups = 0;
+unsigned int Shader::uniform_calls = 0;
 
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
@@ -50,38 +56,167 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
+        bindUniformBlock("FrameCamera", FRAME_CAMERA_BINDING);
+        bindUniformBlock("FrameLights", FRAME_LIGHTS_BINDING);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
 }
 
 void Shader::use() {
-    glUseProgram(this->ID);
+    GL_State_Cache::use_program(this->ID);
 }
 
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(this->ID,name.c_str()),(int)value);
+    this->setBool(Uniform_Handle{this->location(name)},value);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(this->ID,name.c_str()),value);
+    this->setInt(Uniform_Handle{this->location(name)},value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(this->ID,name.c_str()),value);
+    this->setFloat(Uniform_Handle{this->location(name)},value);
 }
 
 void Shader::setVec4(const std::string &name, glm::vec4 vec) const {
-    glUniform4f(glGetUniformLocation(this->ID,name.c_str()),vec.x, vec.y,vec.z,vec.w);
+    this->setVec4(Uniform_Handle{this->location(name)},vec);
 }
 
 void Shader::setVec3(const std::string &name, glm::vec3 vec) const {
-    glUniform3f(glGetUniformLocation(this->ID,name.c_str()),vec.x, vec.y,vec.z);
+    this->setVec3(Uniform_Handle{this->location(name)},vec);
 }
 
 
 void Shader::setMat4 (const std::string &name, glm::mat4 m) const {
-    glUniformMatrix4fv(glGetUniformLocation(this->ID,name.c_str()),1,GL_FALSE,glm::value_ptr(m));
+    this->setMat4(Uniform_Handle{this->location(name)},m);
+}
+
+Uniform_Handle Shader::getUniform(const std::string &name) const {
+    Uniform_Handle handle;
+    handle.location = this->location(name);
+    return handle;
+}
+
+bool Shader::hasUniform(const std::string &name) const {
+    return this->location(name) >= 0;
+}
+
+//Uniforms the program does not use are skipped without calling into the driver
+void Shader::setBool(Uniform_Handle u, bool value) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform1i(u.location,(int)value);
+}
+
+void Shader::setInt(Uniform_Handle u, int value) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform1i(u.location,value);
+}
+
+void Shader::setFloat(Uniform_Handle u, float value) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform1f(u.location,value);
+}
+
+void Shader::setVec4(Uniform_Handle u, glm::vec4 vec) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform4f(u.location,vec.x,vec.y,vec.z,vec.w);
+}
+
+void Shader::setVec3(Uniform_Handle u, glm::vec3 vec) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform3f(u.location,vec.x,vec.y,vec.z);
+}
+
+void Shader::setVec2(Uniform_Handle u, glm::vec2 vec) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniform2f(u.location,vec.x,vec.y);
+}
+
+void Shader::setMat4(Uniform_Handle u, glm::mat4 m) const {
+    if (u.location < 0) return;
+    uniform_calls++;
+    glUniformMatrix4fv(u.location,1,GL_FALSE,glm::value_ptr(m));
+}
+
+void Shader::bindUniformBlock(const std::string &name, unsigned int binding) {
+    unsigned int index = glGetUniformBlockIndex(this->ID,name.c_str());
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(this->ID,index,binding);
+}
+
+void Shader::resetCounters() {
+    driver_lookups = 0;
+    uniform_calls = 0;
+}
+
+void Shader::reflectUniforms() {
+    this->uniforms.clear();
+    int count = 0;
+    int max_length = 0;
+    glGetProgramiv(this->ID,GL_ACTIVE_UNIFORMS,&count);
+    glGetProgramiv(this->ID,GL_ACTIVE_UNIFORM_MAX_LENGTH,&max_length);
+    std::vector<char> name_buffer(max_length + 1);
+
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->ID,i,max_length + 1,&length,&size,&type,name_buffer.data());
+        std::string name(name_buffer.data(),length);
+        //Members of uniform blocks have no location
+        driver_lookups++;
+        int base_location = glGetUniformLocation(this->ID,name.c_str());
+        if (base_location < 0) continue;
+
+        //Arrays are reported once as "name[0]"; give every element (and the bare name) an entry
+        size_t bracket = name.find('[');
+        if (size > 1 && bracket != std::string::npos) {
+            std::string base = name.substr(0,bracket);
+            this->uniforms.push_back(Uniform_Info{base,base_location,type});
+            for (int element = 0; element < size; element++) {
+                std::string element_name = base + "[" + std::to_string(element) + "]";
+                driver_lookups++;
+                this->uniforms.push_back(Uniform_Info{element_name,glGetUniformLocation(this->ID,element_name.c_str()),type});
+            }
+        }
+        else {
+            this->uniforms.push_back(Uniform_Info{name,base_location,type});
+            if (bracket != std::string::npos) {
+                this->uniforms.push_back(Uniform_Info{name.substr(0,bracket),base_location,type});
+            }
+        }
+    }
+    std::sort(this->uniforms.begin(),this->uniforms.end(),
+              [](const Uniform_Info &a, const Uniform_Info &b) { return a.name < b.name; });
+
+    this->draw_uniforms.model = this->getUniform("model");
+    this->draw_uniforms.transform = this->getUniform("transform");
+    this->draw_uniforms.use_texture = this->getUniform("use_texture");
+    this->draw_uniforms.use_atlas = this->getUniform("use_atlas");
+    this->draw_uniforms.atlas_rect = this->getUniform("atlas_rect");
+    this->draw_uniforms.atlas_layer = this->getUniform("atlas_layer");
+    this->draw_uniforms.material_ambient = this->getUniform("material.ambient");
+    this->draw_uniforms.material_diffuse = this->getUniform("material.diffuse");
+    this->draw_uniforms.material_specular = this->getUniform("material.specular");
+    this->draw_uniforms.material_shininess = this->getUniform("material.shininess");
+    this->draw_uniforms.screen_space = this->getUniform("screen_space");
+    this->draw_uniforms.screen_projection = this->getUniform("screen_projection");
+    this->draw_uniforms.use_set_color = this->getUniform("use_set_color");
+    this->draw_uniforms.set_color = this->getUniform("set_color");
+}
+
+int Shader::location(const std::string &name) const {
+    std::vector<Uniform_Info>::const_iterator it = std::lower_bound(this->uniforms.begin(),this->uniforms.end(),name,
+        [](const Uniform_Info &info, const std::string &key) { return info.name < key; });
+    if (it != this->uniforms.end() && it->name == name) return it->location;
+    return -1;
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type) {
@@ -6,10 +6,36 @@
 #include <glad/glad.h>
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+//A uniform location resolved once (see Shader::getUniform).  Only valid with the program
+// that produced it.  A location of -1 (inactive or unknown uniform) makes the set calls no-ops.
+struct Uniform_Handle {
+    int location = -1;
+};
+
+//Handles of the uniforms the scene, the moving objects and the HUD set for every draw, resolved
+// once after linking.  Programs that do not declare one of them get a no-op handle.
+struct Draw_Uniforms {
+    Uniform_Handle model;
+    Uniform_Handle transform;
+    Uniform_Handle use_texture;
+    Uniform_Handle use_atlas;
+    Uniform_Handle atlas_rect;
+    Uniform_Handle atlas_layer;
+    Uniform_Handle material_ambient;
+    Uniform_Handle material_diffuse;
+    Uniform_Handle material_specular;
+    Uniform_Handle material_shininess;
+    Uniform_Handle screen_space;
+    Uniform_Handle screen_projection;
+    Uniform_Handle use_set_color;
+    Uniform_Handle set_color;
+};
+
 //Class is similar to the one defined on www.learnopengl.com.  Primary
 // differences include: 1) separate header and source files; 2) use of the
 // GLM library to easily set vectors of size 4 (1-3 could be added separately).
@@ -17,6 +43,8 @@ class Shader {
 public:
     //The ID of the resulting shader program
     unsigned int ID;
+    //The per-draw uniforms of this program
+    Draw_Uniforms draw_uniforms;
 
     //Constructor for the shader program (takes the path to the
     //vertex and fragment shader GLSL files).
@@ -34,7 +62,45 @@ public:
     void setVec3 (const std::string &name, glm::vec3 v) const;
     void setMat4 (const std::string &name, glm::mat4 m) const;
 
+    //Returns the pre-resolved location of a uniform.  The string setters above look the name up
+    // in the table built at link time; the handle setters below skip even that.
+    Uniform_Handle getUniform(const std::string &name) const;
+    void setBool(Uniform_Handle u, bool value) const;
+    void setInt (Uniform_Handle u, int value) const;
+    void setFloat (Uniform_Handle u, float value) const;
+    void setVec4 (Uniform_Handle u, glm::vec4 v) const;
+    void setVec3 (Uniform_Handle u, glm::vec3 v) const;
+    void setVec2 (Uniform_Handle u, glm::vec2 v) const;
+    void setMat4 (Uniform_Handle u, glm::mat4 m) const;
+
+    //Attaches the program's uniform block (if it declares one with this name) to a binding point.
+    // The FrameCamera and FrameLights blocks are bound automatically after linking.
+    void bindUniformBlock(const std::string &name, unsigned int binding);
+
+    //Returns true if the linked program has an active uniform with this name.
+    bool hasUniform(const std::string &name) const;
+
+    //Counters shared by every program: glGetUniformLocation calls and glUniform* calls
+    // since the last resetCounters().  After link, driver_lookups should stay at zero.
+    static unsigned int driver_lookups;
+    static unsigned int uniform_calls;
+    static void resetCounters();
+
 private:
+    //One active uniform (array elements get one entry each, plus the bare array name)
+    struct Uniform_Info {
+        std::string name;
+        int location;
+        GLenum type;
+    };
+    //Sorted by name for binary search
+    std::vector<Uniform_Info> uniforms;
+
+    //Fills the uniform table from glGetActiveUniform after the program is linked, then the
+    // draw_uniforms handles from the table.
+    void reflectUniforms();
+    int location(const std::string &name) const;
+
     //Internal function used to check for errors during shader compilation.
     void checkCompileErrors(unsigned int shader, std::string type);
 };
@@ -0,0 +1,236 @@
+#include "asset_loader.hpp"
+#include "compressed_texture.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+Asset_Loader::Asset_Loader(int num_threads): num_threads(num_threads) {
+}
+
+Asset_Loader::~Asset_Loader() {
+    //Drops the loader's texture references; what the scene still holds stays resident
+    for (size_t i = 0; i < this->models.size(); i++) {
+        free_texture_image(this->models[i]->image);
+        Texture_Cache::release(this->models[i]->texture);
+        delete this->models[i];
+    }
+    for (size_t i = 0; i < this->textures.size(); i++) {
+        free_texture_image(this->textures[i]->image);
+        Texture_Cache::release(this->textures[i]->texture);
+        delete this->textures[i];
+    }
+}
+
+int Asset_Loader::add_model(std::string baseName, bool pack_vertices) {
+    Model_Job* job = new Model_Job();
+    job->base_name = baseName;
+    job->timing.name = baseName;
+    //Workers would interleave the importer's per-model report; print_timings replaces it
+    job->importer.debugOutput = false;
+    job->importer.packVertices = pack_vertices;
+    this->models.push_back(job);
+    return this->models.size() - 1;
+}
+
+bool Asset_Loader::claim_decode(const std::string& canonical_path) {
+    std::lock_guard<std::mutex> lock(this->decode_mutex);
+    return this->decoded_paths.insert(canonical_path).second;
+}
+
+int Asset_Loader::add_texture(std::string path) {
+    Texture_Job* job = new Texture_Job();
+    job->path = path;
+    job->timing.name = path;
+    this->textures.push_back(job);
+    return this->textures.size() - 1;
+}
+
+void Asset_Loader::load_all() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    this->decoded_paths.clear();
+    //Asked here, on the context thread, for the workers
+    bool compressed = compressed_textures_supported();
+    {
+        Thread_Pool pool(this->num_threads);
+        for (size_t i = 0; i < this->models.size(); i++) {
+            Model_Job* job = this->models[i];
+            job->importer.validatePacking = this->validate_packing;
+            pool.submit([this, job, compressed, &pool]() {
+                std::chrono::steady_clock::time_point parse_start = std::chrono::steady_clock::now();
+                job->importer.prepareFiles(job->base_name);
+                job->timing.parse_ms = elapsed_ms(parse_start);
+                job->timing.from_cache = job->importer.preparedFromCache();
+                job->texture_path = Texture_Cache::canonical_path(job->importer.getTexturePath());
+
+                //Decode the texture as a separate job so another worker can pick it up
+                if (job->texture_path.empty() || (this->streamer != NULL && this->atlas == NULL)) return;
+                if (!this->claim_decode(job->texture_path)) {
+                    job->shares_texture = true;
+                }
+                else {
+                    //The atlas copies texels, so it needs them decoded rather than block-compressed
+                    bool compressed_image = compressed && this->atlas == NULL;
+                    pool.submit([job, compressed_image]() {
+                        std::chrono::steady_clock::time_point decode_start = std::chrono::steady_clock::now();
+                        decode_texture(job->texture_path, job->image, compressed_image);
+                        job->timing.decode_ms = elapsed_ms(decode_start);
+                    });
+                }
+            });
+        }
+        for (size_t i = 0; this->streamer == NULL && i < this->textures.size(); i++) {
+            Texture_Job* job = this->textures[i];
+            pool.submit([this, job, compressed]() {
+                if (!this->claim_decode(Texture_Cache::canonical_path(job->path))) {
+                    job->shares_texture = true;
+                    return;
+                }
+                std::chrono::steady_clock::time_point decode_start = std::chrono::steady_clock::now();
+                decode_texture(job->path, job->image, compressed);
+                job->timing.decode_ms = elapsed_ms(decode_start);
+            });
+        }
+        pool.wait();
+    }
+    this->cpu_stage_ms = elapsed_ms(start);
+
+    //Everything below touches OpenGL, so it stays on this thread.  The jobs that decoded an
+    //image upload it first; the ones sharing it then find it in the cache.
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < this->models.size(); i++) {
+        Model_Job* job = this->models[i];
+        std::chrono::steady_clock::time_point upload_start = std::chrono::steady_clock::now();
+        job->shape = job->importer.uploadPrepared();
+        if (!job->texture_path.empty() && this->atlas != NULL) {
+            //Images too large for the atlas stay standalone textures at full resolution
+            if (!job->shares_texture) job->atlas_entry = this->atlas->add(job->texture_path, job->image);
+            if (!job->shares_texture && job->atlas_entry < 0) job->texture = Texture_Cache::acquire(job->texture_path, &job->image);
+        }
+        else if (!job->texture_path.empty() && this->streamer != NULL) {
+            job->texture = this->streamer->request(job->texture_path);
+        }
+        else if (!job->texture_path.empty() && !job->shares_texture) {
+            job->texture = Texture_Cache::acquire(job->texture_path, &job->image);
+        }
+        job->timing.upload_ms = elapsed_ms(upload_start);
+    }
+    for (size_t i = 0; i < this->textures.size(); i++) {
+        Texture_Job* job = this->textures[i];
+        if (job->shares_texture) continue;
+        std::chrono::steady_clock::time_point upload_start = std::chrono::steady_clock::now();
+        if (this->streamer != NULL) job->texture = this->streamer->request(job->path);
+        else job->texture = Texture_Cache::acquire(job->path, &job->image);
+        job->timing.upload_ms = elapsed_ms(upload_start);
+    }
+    for (size_t i = 0; i < this->models.size(); i++) {
+        Model_Job* job = this->models[i];
+        if (!job->shares_texture) continue;
+        //The decode may have gone to a standalone texture job or been too large for the atlas
+        if (this->atlas != NULL) job->atlas_entry = this->atlas->find(job->texture_path);
+        if (job->atlas_entry < 0) job->texture = Texture_Cache::acquire(job->texture_path);
+    }
+    if (this->atlas != NULL) {
+        bool any = false;
+        for (size_t i = 0; i < this->models.size(); i++) any = any || this->models[i]->atlas_entry >= 0;
+        //Without the atlas, every model that was packed gets its own texture again
+        if (any && !this->atlas->build()) {
+            for (size_t i = 0; i < this->models.size(); i++) {
+                Model_Job* job = this->models[i];
+                if (job->atlas_entry < 0) continue;
+                job->texture = Texture_Cache::acquire(job->texture_path);
+                job->atlas_entry = -1;
+            }
+        }
+    }
+    for (size_t i = 0; i < this->textures.size(); i++) {
+        Texture_Job* job = this->textures[i];
+        if (job->shares_texture) job->texture = Texture_Cache::acquire(job->path);
+    }
+    this->upload_stage_ms = elapsed_ms(start);
+}
+
+Shape_Struct Asset_Loader::get_shape(int model) {
+    if (model < 0 || model >= (int)this->models.size()) {
+        std::cout << "ERROR: Asset_Loader has no model " << model << std::endl;
+        return Shape_Struct();
+    }
+    return this->models[model]->shape;
+}
+
+unsigned int Asset_Loader::get_model_texture(int model) {
+    if (model < 0 || model >= (int)this->models.size()) {
+        std::cout << "ERROR: Asset_Loader has no model " << model << std::endl;
+        return 0;
+    }
+    return this->models[model]->texture;
+}
+
+Atlas_Region Asset_Loader::get_model_region(int model) {
+    if (model < 0 || model >= (int)this->models.size()) {
+        std::cout << "ERROR: Asset_Loader has no model " << model << std::endl;
+        return Atlas_Region();
+    }
+    if (this->atlas == NULL || this->models[model]->atlas_entry < 0) return Atlas_Region();
+    return this->atlas->get_region(this->models[model]->atlas_entry);
+}
+
+unsigned int Asset_Loader::get_texture(int texture) {
+    if (texture < 0 || texture >= (int)this->textures.size()) {
+        std::cout << "ERROR: Asset_Loader has no texture " << texture << std::endl;
+        return 0;
+    }
+    return this->textures[texture]->texture;
+}
+
+std::vector<Asset_Timing> Asset_Loader::get_timings() {
+    std::vector<Asset_Timing> timings;
+    for (size_t i = 0; i < this->models.size(); i++) {
+        timings.push_back(this->models[i]->timing);
+    }
+    for (size_t i = 0; i < this->textures.size(); i++) {
+        timings.push_back(this->textures[i]->timing);
+    }
+    return timings;
+}
+
+double Asset_Loader::get_cpu_stage_ms() {
+    return this->cpu_stage_ms;
+}
+
+double Asset_Loader::get_upload_stage_ms() {
+    return this->upload_stage_ms;
+}
+
+void Asset_Loader::print_timings() {
+    std::vector<Asset_Timing> timings = this->get_timings();
+    double total_cpu_ms = 0.0;
+    int slowest = -1;
+    double slowest_ms = 0.0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << std::left << std::setw(36) << "Asset" << std::right << std::setw(10) << "parse ms"
+              << std::setw(11) << "decode ms" << std::setw(11) << "upload ms" << std::endl;
+    for (size_t i = 0; i < timings.size(); i++) {
+        Asset_Timing& t = timings[i];
+        std::string name = t.from_cache ? t.name + " (cache)" : t.name;
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(10) << t.parse_ms
+                  << std::setw(11) << t.decode_ms << std::setw(11) << t.upload_ms << std::endl;
+        total_cpu_ms += t.parse_ms + t.decode_ms;
+        if (t.parse_ms + t.decode_ms > slowest_ms) {
+            slowest_ms = t.parse_ms + t.decode_ms;
+            slowest = i;
+        }
+    }
+    std::cout << "Parse/decode stage: " << this->cpu_stage_ms << " ms wall (" << total_cpu_ms
+              << " ms of work); upload stage: " << this->upload_stage_ms << " ms" << std::endl;
+    if (slowest >= 0) {
+        std::cout << "Critical path: " << timings[slowest].name << " (" << slowest_ms << " ms parse+decode)" << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
@@ -0,0 +1,110 @@
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "import_object.hpp"
+#include "build_shapes.hpp"
+#include "texture_atlas.hpp"
+#include "texture_cache.hpp"
+#include "texture_streamer.hpp"
+
+//Per-asset startup timings in milliseconds.  parse_ms and decode_ms are measured on the
+//worker thread that ran the stage, upload_ms on the GL context thread.
+struct Asset_Timing {
+    std::string name;
+    double parse_ms = 0.0;
+    double decode_ms = 0.0;
+    double upload_ms = 0.0;
+    bool from_cache = false;
+};
+
+//Loads a batch of models and textures in two stages:
+//  1. Every .OBJ/.MTL parse (or .pomesh cache map) and every image decode runs concurrently
+//     on a thread pool.  A model's texture is decoded as soon as its .MTL names it.
+//  2. The GL uploads (VAO/VBO/EBO, glTexImage2D) run back to back on the calling thread,
+//     which must own the OpenGL context.
+//Textures go through Texture_Cache: an image named by several assets is decoded once, and one
+//the cache already holds is only decoded again to find that out.  With a streamer set, no
+//images are decoded here at all: each texture is requested from it instead and arrives later.
+//With an atlas set, the models' textures are decoded and packed into it instead (built at the
+//end of load_all()), except those over ATLAS_MAX_TEXTURE, which go through the cache at full
+//resolution; standalone textures still go through the cache or the streamer.
+//Queue everything with add_model/add_texture, call load_all() once, then read the results.
+class Asset_Loader {
+    public:
+        //num_threads <= 0 uses one worker per hardware thread.
+        Asset_Loader(int num_threads = 0);
+        ~Asset_Loader();
+
+        //Queues a model (base name without the .OBJ/.MTL extension) and returns its handle.
+        //pack_vertices selects the compact ImportOBJ::PackedVertex layout.
+        int add_model(std::string name_without_file_extension, bool pack_vertices = false);
+        //Queues a standalone texture image and returns its handle.
+        int add_texture(std::string path);
+
+        //Runs both stages.  Blocks until every queued asset is on the GPU.
+        void load_all();
+
+        //Diff every packed model against its float vertices while loading (see ImportOBJ::validatePacking)
+        bool validate_packing = false;
+        //Streams textures through this instead of loading them before load_all() returns
+        Texture_Streamer* streamer = NULL;
+        //Packs the models' textures into this (see get_model_region)
+        Texture_Atlas* atlas = NULL;
+
+        Shape_Struct get_shape(int model);
+        //Texture named by the model's .MTL file (0 if it names none).  The loader holds the
+        //Texture_Cache reference to this and get_texture's textures until it is destroyed;
+        //owners that outlive it take their own with Texture_Cache::retain.
+        unsigned int get_model_texture(int model);
+        //Region of the atlas holding the model's texture (layer -1 without an atlas or a texture)
+        Atlas_Region get_model_region(int model);
+        unsigned int get_texture(int texture);
+
+        //Prints one line per asset plus the stage totals and the slowest parse+decode chain.
+        void print_timings();
+        std::vector<Asset_Timing> get_timings();
+        //Wall-clock time of each stage of the last load_all()
+        double get_cpu_stage_ms();
+        double get_upload_stage_ms();
+
+    private:
+        Asset_Loader(const Asset_Loader&);
+        Asset_Loader& operator=(const Asset_Loader&);
+
+        struct Model_Job {
+            std::string base_name;
+            ImportOBJ importer;
+            std::string texture_path;
+            Texture_Image image;
+            //Another job of the batch decodes the same image
+            bool shares_texture = false;
+            Shape_Struct shape;
+            unsigned int texture = 0;
+            int atlas_entry = -1;
+            Asset_Timing timing;
+        };
+        struct Texture_Job {
+            std::string path;
+            Texture_Image image;
+            bool shares_texture = false;
+            unsigned int texture = 0;
+            Asset_Timing timing;
+        };
+
+        //Claims the decode of an image for the calling job; false if another job has it
+        bool claim_decode(const std::string& canonical_path);
+
+        int num_threads;
+        std::vector<Model_Job*> models;
+        std::vector<Texture_Job*> textures;
+        double cpu_stage_ms = 0.0;
+        double upload_stage_ms = 0.0;
+        std::mutex decode_mutex;
+        std::set<std::string> decoded_paths;
+};
+
+#endif //ASSET_LOADER_HPP
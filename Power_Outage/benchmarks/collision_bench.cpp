@@ -0,0 +1,94 @@
+//Microbenchmark: headless collision queries (no GL context needed).  The office colliders come
+//from levels/office_walls_collision.obj and furniture.obj like in the game.  A city of box
+//buildings is added around them, and each frame moves thousands of spheres (radius 0.2,
+//random walks of 0.1 units) with Collision_World::move_sphere.
+//  brute: every collider is tested for every query (use_broadphase = false)
+//  grid:  only the colliders in the grid cells the motion passes through
+//Both must end every sphere at exactly the same position.
+//
+//CMake target: collision_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/collision_bench [queries_per_frame] [frames]
+
+#include "collision_world.hpp"
+#include "transform.hpp"
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static float random_float(float low, float high) {
+    return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+static void build_world(Collision_World& world, int buildings) {
+    Transform office(glm::vec3(0.0f,-3.99f,0.0f));
+    world.load_obj("levels/office_walls_collision.obj",office.get_local_matrix());
+    Transform furniture(glm::vec3(0.0f,-3.99f,0.0f),glm::vec3(0.0f),glm::vec3(0.5f));
+    world.load_obj("models/office/furniture.obj",furniture.get_local_matrix());
+    for (int i = 0; i < buildings; i++) {
+        glm::vec3 center(random_float(-500.0f,500.0f),0.0f,random_float(-500.0f,500.0f));
+        if (fabsf(center.x) < 20.0f && fabsf(center.z) < 20.0f) continue;
+        AABB box;
+        box.min = center + glm::vec3(-random_float(2.0f,6.0f),-4.0f,-random_float(2.0f,6.0f));
+        box.max = center + glm::vec3(random_float(2.0f,6.0f),random_float(5.0f,30.0f),random_float(2.0f,6.0f));
+        world.add_box(box,"building");
+    }
+}
+
+static double run(Collision_World& world, std::vector<glm::vec3>& positions,
+                  const std::vector<glm::vec3>& steps, int frames) {
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        for (size_t i = 0; i < positions.size(); i++) {
+            positions[i] = world.move_sphere(positions[i],steps[(i + f) % steps.size()],0.2f);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int queries = argc > 1 ? atoi(argv[1]) : 5000;
+    int frames = argc > 2 ? atoi(argv[2]) : 20;
+    int building_counts[3] = {100, 1000, 10000};
+
+    printf("%10s %10s %16s %16s %9s %12s %11s\n", "colliders", "queries", "brute us/frame", "grid us/frame",
+           "speedup", "tested/query", "mismatches");
+    for (int b = 0; b < 3; b++) {
+        srand(99);
+        Collision_World world;
+        build_world(world,building_counts[b]);
+
+        //Half the spheres start in and around the office, half around the city
+        std::vector<glm::vec3> start(queries);
+        for (int i = 0; i < queries; i++) {
+            float spread = i % 2 == 0 ? 8.0f : 500.0f;
+            start[i] = glm::vec3(random_float(-spread,spread),-3.6f,random_float(-spread,spread));
+        }
+        std::vector<glm::vec3> steps(997);
+        for (size_t i = 0; i < steps.size(); i++) {
+            float angle = random_float(0.0f,6.2831853f);
+            steps[i] = glm::vec3(cosf(angle),0.0f,sinf(angle)) * 0.1f;
+        }
+
+        std::vector<glm::vec3> brute_positions = start;
+        world.use_broadphase = false;
+        world.stats = Collision_Stats();
+        double brute_seconds = run(world,brute_positions,steps,frames);
+
+        std::vector<glm::vec3> grid_positions = start;
+        world.use_broadphase = true;
+        world.stats = Collision_Stats();
+        double grid_seconds = run(world,grid_positions,steps,frames);
+
+        int mismatches = 0;
+        for (int i = 0; i < queries; i++) {
+            if (brute_positions[i] != grid_positions[i]) mismatches++;
+        }
+        printf("%10d %10d %16.1f %16.1f %8.1fx %12.2f %11d\n", world.size(), queries, brute_seconds * 1e6 / frames,
+               grid_seconds * 1e6 / frames, brute_seconds / grid_seconds,
+               world.stats.candidates / (double)world.stats.queries, mismatches);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+//Microbenchmark: CPU cost of frustum culling a large number of world-space boxes.
+//  scalar: aabb_visible on each box, one plane at a time
+//  sse:    cull_boxes, which tests four planes per instruction
+//The camera is the game's (60 degree perspective, 0.1 to 100) turning in place among boxes
+//scattered over a 1000 x 1000 city, so only a few percent of them are visible.  Both versions
+//must agree on every box.
+//
+//CMake target: frustum_cull_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/frustum_cull_bench [boxes] [frames]
+
+#include "frustum.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static std::vector<AABB> make_boxes(int count) {
+    std::vector<AABB> boxes(count);
+    srand(1237);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 center(rand() % 1000 - 500.0f, rand() % 20 - 4.0f, rand() % 1000 - 500.0f);
+        glm::vec3 extent(0.5f + rand() % 8, 0.5f + rand() % 12, 0.5f + rand() % 8);
+        boxes[i].min = center - extent;
+        boxes[i].max = center + extent;
+    }
+    return boxes;
+}
+
+static Frustum frame_frustum(int frame) {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),1280.0f/720.0f,0.1f,100.0f);
+    float yaw = glm::radians(frame * 0.6f);
+    glm::vec3 eye(10.0f,-3.0f,-3.0f);
+    glm::mat4 view = glm::lookAt(eye,eye + glm::vec3(cosf(yaw),0.0f,sinf(yaw)),glm::vec3(0.0f,1.0f,0.0f));
+    return extract_frustum(projection * view);
+}
+
+typedef int (*Cull_Function)(const Frustum&, const AABB*, int, unsigned char*);
+
+static double run(Cull_Function cull, const std::vector<AABB>& boxes, int frames,
+                  std::vector<unsigned char>& visible, long long& total_visible) {
+    total_visible = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        total_visible += cull(frame_frustum(f),boxes.data(),boxes.size(),visible.data());
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    std::vector<AABB> boxes = make_boxes(count);
+
+    //Check that both versions cull the same boxes
+    int mismatches = 0;
+    std::vector<unsigned char> scalar_visible(count), sse_visible(count);
+    for (int f = 0; f < 600; f += 37) {
+        Frustum frustum = frame_frustum(f);
+        cull_boxes_scalar(frustum,boxes.data(),count,scalar_visible.data());
+        cull_boxes(frustum,boxes.data(),count,sse_visible.data());
+        for (int i = 0; i < count; i++) {
+            if (scalar_visible[i] != sse_visible[i]) mismatches++;
+        }
+    }
+
+    long long scalar_total, sse_total;
+    double scalar_seconds = run(cull_boxes_scalar,boxes,frames,scalar_visible,scalar_total);
+    double sse_seconds = run(cull_boxes,boxes,frames,sse_visible,sse_total);
+
+    printf("%d boxes, %d frames, %.1f%% visible on average\n", count, frames, 100.0 * sse_total / ((double)count * frames));
+    printf("%8s %12s %12s\n", "", "us/frame", "ns/box");
+    printf("%8s %12.1f %12.2f\n", "scalar", scalar_seconds * 1e6 / frames, scalar_seconds * 1e9 / ((double)count * frames));
+    printf("%8s %12.1f %12.2f\n", "sse", sse_seconds * 1e6 / frames, sse_seconds * 1e9 / ((double)count * frames));
+    printf("speedup %.2fx, %d mismatches, visible totals %s\n", scalar_seconds / sse_seconds, mismatches,
+           scalar_total == sse_total ? "match" : "DIFFER");
+    return mismatches == 0 && scalar_total == sse_total ? 0 : 1;
+}
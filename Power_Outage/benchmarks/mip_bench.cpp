@@ -0,0 +1,162 @@
+//Microbenchmark: making the mip chains of the skybox faces and the bricks texture.
+//  scalar box        generate_mip_chain_scalar, one thread
+//  sse box           generate_mip_chain, one thread
+//  sse box, rows     generate_mip_chain with each level's rows spread over every hardware thread
+//  sse box, images   one image per Thread_Pool worker (how Asset_Loader runs it)
+//  sse kaiser, rows  the Kaiser filter bake_textures uses
+//All are gamma-correct.  The scalar and SSE chains must match byte for byte.  Built with
+//POWER_OUTAGE_BENCH it also times, on an offscreen EGL context (Mesa's llvmpipe without a
+//GPU), glGenerateMipmap after uploading level 0 against uploading the generated chain.
+//
+//CMake target: mip_bench
+//Run (from the Power_Outage directory):
+//  EGL_PLATFORM=surfaceless ./build/release/mip_bench [passes]
+
+#ifdef POWER_OUTAGE_BENCH
+#include "environment_setup.hpp"
+#endif
+#include "build_shapes.hpp"
+#include "mip_generator.hpp"
+#include "stb_image.h"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static const char* IMAGES[] = {"skybox/right.jpg","skybox/left.jpg","skybox/top.jpg","skybox/bottom.jpg",
+                               "skybox/front.jpg","skybox/back.jpg","images/bricks.jpg"};
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+//A private copy of the decoded level 0 (generate_mip_chain replaces the pixels it is given)
+static Texture_Image copy_image(const Texture_Image& source) {
+    Texture_Image copy = source;
+    copy.data = (unsigned char*)malloc(source.data_bytes);
+    memcpy(copy.data,source.data,source.data_bytes);
+    return copy;
+}
+
+typedef bool (*Mip_Function)(Texture_Image&, const Mip_Options&);
+
+//Seconds for one pass over every image, the best of the given passes
+static double run(Mip_Function generate, const std::vector<Texture_Image>& images, const Mip_Options& options,
+                  int passes, bool pool_images, std::vector<Texture_Image>* chains = NULL) {
+    double best = 1e30;
+    Thread_Pool pool;
+    for (int p = 0; p < passes; p++) {
+        std::vector<Texture_Image> work;
+        for (size_t i = 0; i < images.size(); i++) work.push_back(copy_image(images[i]));
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < work.size(); i++) {
+            Texture_Image* image = &work[i];
+            if (pool_images) pool.submit([generate, image, options]() { generate(*image,options); });
+            else generate(*image,options);
+        }
+        pool.wait();
+        double seconds = seconds_since(start);
+        if (seconds < best) best = seconds;
+        for (size_t i = 0; i < work.size(); i++) {
+            if (chains != NULL && p == passes - 1) chains->push_back(work[i]);
+            else free_texture_image(work[i]);
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int passes = argc > 1 ? atoi(argv[1]) : 5;
+    std::vector<Texture_Image> images;
+    double texels = 0.0;
+    for (size_t i = 0; i < sizeof(IMAGES) / sizeof(IMAGES[0]); i++) {
+        Texture_Image image;
+        stbi_set_flip_vertically_on_load(true);
+        image.data = stbi_load(IMAGES[i],&image.width,&image.height,&image.channels,0);
+        if (image.data == NULL) {
+            printf("ERROR: could not load %s (run from the Power_Outage directory)\n",IMAGES[i]);
+            return 1;
+        }
+        image.data_bytes = (size_t)image.width * image.height * image.channels;
+        texels += (double)image.width * image.height;
+        images.push_back(image);
+    }
+    int threads = std::thread::hardware_concurrency();
+    printf("%d images, %.1f Mtexels at level 0, best of %d passes, %d hardware threads\n",
+           (int)images.size(),texels / 1e6,passes,threads);
+
+    Mip_Options single, rows, kaiser;
+    rows.num_threads = threads;
+    kaiser.num_threads = threads;
+    kaiser.filter = MIP_FILTER_KAISER;
+    std::vector<Texture_Image> scalar_chains, sse_chains;
+    double scalar = run(generate_mip_chain_scalar,images,single,passes,false,&scalar_chains);
+    double sse = run(generate_mip_chain,images,single,passes,false,&sse_chains);
+    double sse_rows = run(generate_mip_chain,images,rows,passes,false);
+    double sse_images = run(generate_mip_chain,images,single,passes,true);
+    double sse_kaiser = run(generate_mip_chain,images,kaiser,passes,false);
+
+    int mismatches = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+        if (scalar_chains[i].data_bytes != sse_chains[i].data_bytes ||
+            memcmp(scalar_chains[i].data,sse_chains[i].data,sse_chains[i].data_bytes) != 0) {
+            mismatches++;
+        }
+        free_texture_image(scalar_chains[i]);
+    }
+
+    printf("%-18s %10s %12s %9s\n","","ms/pass","Mtexels/s","speedup");
+    const char* names[] = {"scalar box","sse box","sse box, rows","sse box, images","sse kaiser, rows"};
+    double times[] = {scalar,sse,sse_rows,sse_images,sse_kaiser};
+    for (int i = 0; i < 5; i++) {
+        printf("%-18s %10.1f %12.1f %8.2fx\n",names[i],times[i] * 1e3,texels / times[i] / 1e6,scalar / times[i]);
+    }
+    printf("scalar and sse chains: %d of %d images differ\n",mismatches,(int)images.size());
+
+#ifdef POWER_OUTAGE_BENCH
+    if (initialize_headless_environment(64,64)) {
+        //Level 0 is uploaded untimed, then glGenerateMipmap until the GPU is done, against
+        //uploading the whole generated chain
+        double driver_mips = 0.0, chain_upload = 0.0, level0_upload = 0.0;
+        for (int p = 0; p < passes; p++) {
+            for (size_t i = 0; i < images.size(); i++) {
+                unsigned int textures[2];
+                glGenTextures(2,textures);
+                int format = images[i].channels > 3 ? GL_RGBA : GL_RGB;
+                glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+                glBindTexture(GL_TEXTURE_2D,textures[0]);
+                auto start = std::chrono::steady_clock::now();
+                glTexImage2D(GL_TEXTURE_2D,0,format,images[i].width,images[i].height,0,format,GL_UNSIGNED_BYTE,images[i].data);
+                glFinish();
+                level0_upload += seconds_since(start);
+                start = std::chrono::steady_clock::now();
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glFinish();
+                driver_mips += seconds_since(start);
+
+                glBindTexture(GL_TEXTURE_2D,textures[1]);
+                start = std::chrono::steady_clock::now();
+                upload_texture_levels(GL_TEXTURE_2D,sse_chains[i],sse_chains[i].data);
+                glFinish();
+                chain_upload += seconds_since(start);
+                glDeleteTextures(2,textures);
+            }
+        }
+        printf("OpenGL (%s), ms per pass:\n",(const char*)glGetString(GL_RENDERER));
+        printf("  level 0 upload %.1f + glGenerateMipmap %.1f = %.1f\n",level0_upload * 1e3 / passes,
+               driver_mips * 1e3 / passes,(level0_upload + driver_mips) * 1e3 / passes);
+        printf("  generated chain upload %.1f, plus %.1f to generate it on one thread (%.1f on %d)\n",
+               chain_upload * 1e3 / passes,sse * 1e3,sse_rows * 1e3,threads);
+    }
+    else printf("No OpenGL context, glGenerateMipmap is not measured\n");
+#endif
+
+    for (size_t i = 0; i < images.size(); i++) {
+        free_texture_image(sse_chains[i]);
+        free_texture_image(images[i]);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,196 @@
+//Microbenchmark: memory-mapped ImportOBJ parser vs. the original getline/istringstream parser.
+//Parses every .obj/.mtl pair under models/ and reports throughput in MB/s.
+//
+//CMake target: obj_parse_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/obj_parse_bench [models_directory] [iterations]
+
+#include "import_object.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+//The parser ImportOBJ shipped with before it was memory mapped, kept here verbatim
+//(minus the texture upload) as the baseline.
+class LegacyOBJ {
+    public:
+        std::vector<ImportOBJ::CompleteVertex> combinedData;
+
+        void load(std::string baseName) {
+            vertices.clear();
+            normals.clear();
+            textCoords.clear();
+            combinedData.clear();
+            matAbbrev.clear();
+            matDiffuse.clear();
+            matSpecular.clear();
+            readMTLFile(baseName + ".mtl");
+            readOBJFile(baseName + ".obj");
+        }
+
+    private:
+        int curMat = -1;
+        std::string texturePath;
+        std::vector<glm::vec3> vertices;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> textCoords;
+        std::map<std::string, int> matAbbrev;
+        std::vector<glm::vec3> matDiffuse;
+        std::vector<glm::vec3> matSpecular;
+
+        void readMTLFile(std::string fName) {
+            std::ifstream infile(fName.c_str());
+            if (infile.fail()) return;
+            std::string curLine;
+            int matCount = 0;
+            while (std::getline(infile, curLine)) {
+                std::string linePrefix;
+                std::istringstream iss(curLine, std::istringstream::in);
+                iss >> linePrefix;
+                if (linePrefix == "newmtl") {
+                    matAbbrev.insert(std::pair<std::string, int>(curLine.substr(7), matCount));
+                    matCount += 1;
+                }
+                else if (linePrefix == "Kd") matDiffuse.push_back(getVec3(curLine));
+                else if (linePrefix == "Ks") matSpecular.push_back(getVec3(curLine));
+                else if (linePrefix == "map_Kd") texturePath = curLine.substr(7);
+            }
+        }
+
+        void readOBJFile(std::string fName) {
+            std::ifstream infile(fName.c_str());
+            if (infile.fail()) return;
+            std::string curLine;
+            vertices.push_back(glm::vec3(-1.0, -1.0, -1.0));
+            normals.push_back(glm::vec3(-1.0, -1.0, -1.0));
+            textCoords.push_back(glm::vec2(-1.0, -1.0));
+            while (std::getline(infile, curLine)) {
+                std::string linePrefix;
+                std::istringstream iss(curLine, std::istringstream::in);
+                iss >> linePrefix;
+                if (linePrefix == "v") vertices.push_back(getVec3(curLine));
+                else if (linePrefix == "vn") normals.push_back(getVec3(curLine));
+                else if (linePrefix == "vt") textCoords.push_back(getVec2(curLine));
+                else if (linePrefix == "usemtl") curMat = matAbbrev.find(curLine.substr(7))->second;
+                else if (linePrefix == "f") readLineFace(curLine);
+            }
+        }
+
+        void readLineFace(std::string line) {
+            int firstVertexStart = 2;
+            int secondVertexStart = line.find(" ", firstVertexStart) + 1;
+            int thirdVertexStart = line.find(" ", secondVertexStart) + 1;
+            readFace(line.substr(firstVertexStart, secondVertexStart - 1));
+            readFace(line.substr(secondVertexStart, thirdVertexStart - 1));
+            readFace(line.substr(thirdVertexStart));
+        }
+
+        void readFace(std::string lineSegment) {
+            int indexY = lineSegment.find("/", 0) + 1;
+            int indexZ = lineSegment.find("/", indexY) + 1;
+            int x = strtol(lineSegment.substr(0, indexY - 1).c_str(), NULL, 10);
+            int y = strtol(lineSegment.substr(indexY, indexZ - 1).c_str(), NULL, 10);
+            int z = strtol(lineSegment.substr(indexZ).c_str(), NULL, 10);
+            ImportOBJ::CompleteVertex newVert;
+            newVert.Position = vertices.at(x);
+            newVert.TexCoords = textCoords.at(y);
+            newVert.Normal = normals.at(z);
+            if (curMat != -1) newVert.Color = matDiffuse.at(curMat);
+            if (curMat != -1) newVert.sColor = matSpecular.at(curMat);
+            if (curMat == -1) newVert.Color = glm::vec3(1.0, 1.0, 1.0);
+            combinedData.push_back(newVert);
+        }
+
+        glm::vec3 getVec3(std::string line) {
+            int indexX = line.find(" ", 0) + 1;
+            int indexY = line.find(" ", indexX) + 1;
+            int indexZ = line.find(" ", indexY) + 1;
+            float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
+            float y = strtof(line.substr(indexY, indexZ-1).c_str(), NULL);
+            float z = strtof(line.substr(indexZ).c_str(), NULL);
+            return glm::vec3(x, y, z);
+        }
+
+        glm::vec2 getVec2(std::string line) {
+            int indexX = line.find(" ", 0) + 1;
+            int indexY = line.find(" ", indexX) + 1;
+            float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
+            float y = strtof(line.substr(indexY).c_str(), NULL);
+            return glm::vec2(x, y);
+        }
+};
+
+//Largest absolute difference between any attribute of the flat legacy stream and
+//the indexed stream (expanded through its index buffer)
+float max_difference(const std::vector<ImportOBJ::CompleteVertex>& a,
+                     const std::vector<ImportOBJ::CompleteVertex>& b,
+                     const std::vector<unsigned int>& b_indices) {
+    float worst = 0.0f;
+    for (size_t i = 0; i < a.size() && i < b_indices.size(); i++) {
+        const float* fa = (const float*)&a[i];
+        const float* fb = (const float*)&b[b_indices[i]];
+        for (size_t k = 0; k < sizeof(ImportOBJ::CompleteVertex) / sizeof(float); k++) {
+            float d = fa[k] > fb[k] ? fa[k] - fb[k] : fb[k] - fa[k];
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    std::string models_dir = argc > 1 ? argv[1] : "models";
+    int iterations = argc > 2 ? atoi(argv[2]) : 50;
+
+    std::vector<std::string> base_names;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(models_dir)) {
+        if (entry.path().extension() == ".obj") {
+            std::string path = entry.path().string();
+            base_names.push_back(path.substr(0, path.size() - 4));
+        }
+    }
+
+    ImportOBJ importer;
+    importer.debugOutput = false;
+    LegacyOBJ legacy;
+    double total_bytes = 0.0, total_legacy = 0.0, total_mapped = 0.0;
+
+    std::cout << "model                                      KB   legacy MB/s   mapped MB/s  speedup  max diff\n";
+    for (size_t m = 0; m < base_names.size(); m++) {
+        double bytes = (double)std::filesystem::file_size(base_names[m] + ".obj");
+        if (std::filesystem::exists(base_names[m] + ".mtl")) {
+            bytes += (double)std::filesystem::file_size(base_names[m] + ".mtl");
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) legacy.load(base_names[m]);
+        double legacy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) importer.parseFiles(base_names[m]);
+        double mapped_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (legacy.combinedData.size() != importer.getIndices().size()) {
+            std::cout << "MISMATCH: " << base_names[m] << " legacy " << legacy.combinedData.size()
+                      << " vertices vs mapped " << importer.getIndices().size() << " indices\n";
+        }
+
+        double megabytes = bytes * iterations / (1024.0 * 1024.0);
+        printf("%-40s %6.1f %13.1f %13.1f %7.2fx %9.2g\n", base_names[m].c_str(), bytes / 1024.0,
+               megabytes / legacy_seconds, megabytes / mapped_seconds, legacy_seconds / mapped_seconds,
+               max_difference(legacy.combinedData, importer.getCombinedData(), importer.getIndices()));
+        total_bytes += bytes * iterations;
+        total_legacy += legacy_seconds;
+        total_mapped += mapped_seconds;
+    }
+
+    double megabytes = total_bytes / (1024.0 * 1024.0);
+    printf("%-40s %6s %13.1f %13.1f %7.2fx\n", "TOTAL", "", megabytes / total_legacy,
+           megabytes / total_mapped, total_legacy / total_mapped);
+    return 0;
+}
@@ -0,0 +1,258 @@
+//Microbenchmark: CPU cost of render_scene's submission phase with the old by-value
+//std::map<std::string, Draw_Data> versus the flat Render_Queue.
+//Both versions walk the same 17 static objects for a shadow pass and a main pass per frame.
+//The GL calls are replaced by appending a Draw_Call to a list, so only the bookkeeping
+//(map copy, string lookups, matrix building vs. the linear walk) is timed.
+//
+//CMake target: render_queue_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/render_queue_bench [frames]
+
+#include "render_queue.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+//What render_scene would hand to OpenGL for one object
+struct Draw_Call {
+    Shape* shape;
+    Shader* shader;
+    unsigned int texture;
+    glm::mat4 model;
+    bool use_texture;
+};
+
+//The draw map render_scene took before the Render_Queue, kept here as the baseline
+struct Draw_Data {
+    Shape* shape;
+    Shader* shader;
+    unsigned int texture = -1;
+};
+
+static void record(std::vector<Draw_Call>& calls, Shape* shape, Shader* shader, unsigned int texture,
+                   glm::mat4 model, bool use_texture) {
+    Draw_Call call = {shape, shader, texture, model, use_texture};
+    calls.push_back(call);
+}
+
+//The object section of the old World::render_scene, with each draw recorded instead of issued
+static void legacy_submit(std::map<std::string, Draw_Data> objects, Shader* optional_shader, std::vector<Draw_Call>& calls) {
+    Shape* worldFloor = objects["worldFloor"].shape;
+    Shader* worldFloor_shader = objects["worldFloor"].shader;
+    glm::mat4 worldFloor_model(1.0f);
+    worldFloor_model = glm::translate(worldFloor_model,glm::vec3(0.0,-4.0,0.0));
+    worldFloor_model = glm::scale(worldFloor_model,glm::vec3(150.0f,150.0f,150.0f));
+    worldFloor_model = glm::rotate(worldFloor_model,glm::radians(-90.0f),glm::vec3(1.0,0.0,0.0));
+    record(calls,worldFloor,worldFloor_shader,objects["worldFloor"].texture,worldFloor_model,false);
+
+    const char* textured[2] = {"officeFloor","walls"};
+    float textured_scale[2] = {0.5f,1.0f};
+    for (int i = 0; i < 2; i++) {
+        glm::mat4 transform(1.0f);
+        transform = glm::translate(transform,glm::vec3(0.0f,-3.99f,0.0f));
+        transform = glm::scale(transform,glm::vec3(textured_scale[i]));
+        record(calls,objects[textured[i]].shape,objects[textured[i]].shader,objects[textured[i]].texture,transform,true);
+    }
+
+    Shader* furniture_shader = objects["furniture"].shader;
+    if (optional_shader != NULL) furniture_shader = optional_shader;
+    glm::mat4 furniture_transform(1.0f);
+    furniture_transform = glm::translate(furniture_transform,glm::vec3(0.0f,-3.99f,0.0f));
+    furniture_transform = glm::scale(furniture_transform,glm::vec3(0.5f,0.5f, 0.5f));
+    record(calls,objects["furniture"].shape,furniture_shader,objects["furniture"].texture,furniture_transform,true);
+
+    Shader* keyhole_shader = objects["keyhole"].shader;
+    if (optional_shader != NULL) keyhole_shader = optional_shader;
+    glm::mat4 keyhole_transform(1.0f);
+    keyhole_transform = glm::translate(keyhole_transform,glm::vec3(5.159f,-3.7f,0.0f));
+    keyhole_transform = glm::rotate(keyhole_transform,glm::radians(-90.0f),glm::vec3(0.0,1.0,0.0));
+    keyhole_transform = glm::scale(keyhole_transform,glm::vec3(0.25f,0.25f,0.25f));
+    record(calls,objects["keyhole"].shape,keyhole_shader,objects["keyhole"].texture,keyhole_transform,true);
+
+    Shader* lamppost_shader = objects["lamppost"].shader;
+    if (optional_shader != NULL) lamppost_shader = optional_shader;
+    glm::mat4 lamppost_transform(1.0f);
+    lamppost_transform = glm::translate(lamppost_transform,glm::vec3(15.0f,-3.99f,0.0f));
+    lamppost_transform = glm::rotate(lamppost_transform,glm::radians(-90.0f),glm::vec3(0.0,1.0,0.0));
+    lamppost_transform = glm::scale(lamppost_transform,glm::vec3(0.2f,0.2f,0.2f));
+    record(calls,objects["lamppost"].shape,lamppost_shader,0,lamppost_transform,false);
+
+    //The old code spelled out each portal and building; the lookups and matrix work are the same
+    const char* portals[4] = {"portal1","portal2","portal3","portal4"};
+    glm::vec3 portal_positions[4] = {glm::vec3(10.0f,-3.99f,7.5f),glm::vec3(20.0f,-3.99f,7.5f),
+                                     glm::vec3(10.0f,-3.99f,-7.5f),glm::vec3(20.0f,-3.99f,-7.5f)};
+    Shader* portal_shader = objects["portal1"].shader;
+    for (int i = 0; i < 4; i++) {
+        Shape* portal = objects[portals[i]].shape;
+        glm::mat4 transform(1.0f);
+        transform = glm::translate(transform,portal_positions[i]);
+        transform = glm::rotate(transform,glm::radians(0.0f),glm::vec3(0.0,1.0,0.0));
+        transform = glm::scale(transform,glm::vec3(0.6f,0.6f,0.6f));
+        record(calls,portal,portal_shader,0,transform,false);
+    }
+    const char* buildings[4] = {"building1","building2","building3","building4"};
+    glm::vec3 building_positions[4] = {glm::vec3(-80.0f,-3.99f,20.0f),glm::vec3(38.0f,-3.99f,20.0f),
+                                       glm::vec3(-7.5f,-3.99f,-20.0f),glm::vec3(110.0f,-3.99f,-15.0f)};
+    float building_rotations[4] = {-90.0f,-90.0f,90.0f,90.0f};
+    Shader* building_shader = objects["building1"].shader;
+    for (int i = 0; i < 4; i++) {
+        Shape* building = objects[buildings[i]].shape;
+        glm::mat4 transform(1.0f);
+        transform = glm::translate(transform,building_positions[i]);
+        transform = glm::rotate(transform,glm::radians(building_rotations[i]),glm::vec3(0.0,1.0,0.0));
+        transform = glm::scale(transform,glm::vec3(0.6f,0.6f,0.6f));
+        record(calls,building,building_shader,0,transform,false);
+    }
+
+    const char* cubes[2] = {"cube1","cube2"};
+    glm::vec3 cube_positions[2] = {glm::vec3(-1.0f,-3.35f,1.0f),glm::vec3(-1.05f,-3.35f,-1.0f)};
+    for (int i = 0; i < 2; i++) {
+        Shader* cube_shader = objects[cubes[i]].shader;
+        if (optional_shader != NULL) cube_shader = optional_shader;
+        glm::mat4 transform(1.0f);
+        transform = glm::translate(transform,cube_positions[i]);
+        transform = glm::scale(transform,glm::vec3(0.25f,0.25f, 0.25f));
+        record(calls,objects[cubes[i]].shape,cube_shader,0,transform,false);
+    }
+
+    //render_stencils looked these up as well
+    Shader* stencil_fill = objects["stencil_fill"].shader;
+    Shader* stencil_import = objects["stencil_import"].shader;
+    if (stencil_fill == NULL || stencil_import == NULL) abort();
+}
+
+//The object loop of the current World::render_scene, with each draw recorded instead of issued
+static void queue_submit(Render_Queue& queue, Shader* optional_shader, std::vector<Draw_Call>& calls) {
+    const std::vector<Draw_Item>& items = queue.get_items();
+    for (size_t i = 0; i < items.size(); i++) {
+        const Draw_Item& item = items[i];
+        Shader* shader = item.shader;
+        if (optional_shader != NULL && (item.flags & DRAW_SHADOW_SHADER)) shader = optional_shader;
+        record(calls,item.shape,shader,item.texture,item.model,(item.flags & DRAW_USE_TEXTURE) != 0);
+    }
+}
+
+static bool same_calls(const std::vector<Draw_Call>& a, const std::vector<Draw_Call>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        bool same_texture = a[i].texture == b[i].texture || (a[i].texture == (unsigned int)-1 && b[i].texture == 0);
+        if (a[i].shape != b[i].shape || a[i].shader != b[i].shader || !same_texture ||
+            a[i].use_texture != b[i].use_texture) return false;
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                if (fabsf(a[i].model[c][r] - b[i].model[c][r]) > 1e-5f) return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 200000;
+
+    //Shapes are never drawn, so default ones (which own no GL objects) are enough.  The shaders
+    //are only compared by address and are never constructed or dereferenced.
+    Shape shapes[17];
+    Shader* texture_program = (Shader*)::operator new(sizeof(Shader));
+    Shader* import_program = (Shader*)::operator new(sizeof(Shader));
+    Shader* fill_program = (Shader*)::operator new(sizeof(Shader));
+    Shader* depth_program = (Shader*)::operator new(sizeof(Shader));
+
+    //Same registration as main.cpp
+    const char* names[17] = {"worldFloor","officeFloor","walls","furniture","keyhole","lamppost",
+                             "portal1","portal2","portal3","portal4",
+                             "building1","building2","building3","building4","cube1","cube2",""};
+    std::map<std::string, Draw_Data> draw_map;
+    for (int i = 0; i < 16; i++) {
+        draw_map[names[i]].shape = &shapes[i];
+        draw_map[names[i]].shader = import_program;
+    }
+    draw_map["worldFloor"].shader = texture_program;
+    draw_map["worldFloor"].texture = 1;
+    draw_map["officeFloor"].texture = 2;
+    draw_map["walls"].texture = 3;
+    draw_map["furniture"].texture = 4;
+    draw_map["keyhole"].texture = 5;
+    draw_map["cube1"].shader = fill_program;
+    draw_map["cube2"].shader = fill_program;
+    draw_map["stencil_fill"].shader = fill_program;
+    draw_map["stencil_import"].shader = import_program;
+
+    //Placement of everything but the floor, as registered in main.cpp
+    glm::vec3 positions[16] = {glm::vec3(0.0f),glm::vec3(0.0f,-3.99f,0.0f),glm::vec3(0.0f,-3.99f,0.0f),
+                               glm::vec3(0.0f,-3.99f,0.0f),glm::vec3(5.159f,-3.7f,0.0f),glm::vec3(15.0f,-3.99f,0.0f),
+                               glm::vec3(10.0f,-3.99f,7.5f),glm::vec3(20.0f,-3.99f,7.5f),
+                               glm::vec3(10.0f,-3.99f,-7.5f),glm::vec3(20.0f,-3.99f,-7.5f),
+                               glm::vec3(-80.0f,-3.99f,20.0f),glm::vec3(38.0f,-3.99f,20.0f),
+                               glm::vec3(-7.5f,-3.99f,-20.0f),glm::vec3(110.0f,-3.99f,-15.0f),
+                               glm::vec3(-1.0f,-3.35f,1.0f),glm::vec3(-1.05f,-3.35f,-1.0f)};
+    float rotations[16] = {0.0f,0.0f,0.0f,0.0f,-90.0f,-90.0f,0.0f,0.0f,0.0f,0.0f,-90.0f,-90.0f,90.0f,90.0f,0.0f,0.0f};
+    float scales[16] = {1.0f,0.5f,1.0f,0.5f,0.25f,0.2f,0.6f,0.6f,0.6f,0.6f,0.6f,0.6f,0.6f,0.6f,0.25f,0.25f};
+
+    Render_Queue queue;
+    for (int i = 0; i < 16; i++) {
+        Draw_Item item;
+        item.shape = &shapes[i];
+        item.shader = draw_map[names[i]].shader;
+        item.texture = draw_map[names[i]].texture == (unsigned int)-1 ? 0 : draw_map[names[i]].texture;
+        item.model = place_model(positions[i],rotations[i],glm::vec3(scales[i]));
+        if (i >= 1 && i <= 4) item.flags |= DRAW_USE_TEXTURE;
+        if ((i >= 3 && i <= 5) || i >= 14) item.flags |= DRAW_SHADOW_SHADER;
+        queue.add(item);
+    }
+    Draw_Item* floor = queue.get(0);
+    floor->model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0,-4.0,0.0));
+    floor->model = glm::scale(floor->model,glm::vec3(150.0f,150.0f,150.0f));
+    floor->model = glm::rotate(floor->model,glm::radians(-90.0f),glm::vec3(1.0,0.0,0.0));
+
+    std::vector<Draw_Call> legacy_calls, queue_calls;
+    legacy_calls.reserve(64);
+    queue_calls.reserve(64);
+    for (int pass = 0; pass < 2; pass++) {
+        Shader* optional_shader = pass == 0 ? depth_program : NULL;
+        legacy_calls.clear();
+        queue_calls.clear();
+        legacy_submit(draw_map,optional_shader,legacy_calls);
+        queue_submit(queue,optional_shader,queue_calls);
+        if (!same_calls(legacy_calls,queue_calls)) {
+            printf("MISMATCH: the queue does not reproduce the %s pass\n", pass == 0 ? "shadow" : "main");
+            return 1;
+        }
+    }
+
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        legacy_calls.clear();
+        legacy_submit(draw_map,depth_program,legacy_calls); //Shadows
+        legacy_submit(draw_map,NULL,legacy_calls); //Primary rendering
+        checksum += legacy_calls.size();
+    }
+    double legacy_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        queue_calls.clear();
+        queue_submit(queue,depth_program,queue_calls); //Shadows
+        queue_submit(queue,NULL,queue_calls); //Primary rendering
+        checksum += queue_calls.size();
+    }
+    double queue_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("frames: %d, draws per frame: %d (checksum %zu)\n", frames, (int)queue_calls.size(), checksum);
+    printf("std::map by value: %8.3f us/frame\n", legacy_seconds * 1e6 / frames);
+    printf("Render_Queue:      %8.3f us/frame\n", queue_seconds * 1e6 / frames);
+    printf("speedup:           %8.2fx\n", legacy_seconds / queue_seconds);
+
+    ::operator delete(texture_program);
+    ::operator delete(import_program);
+    ::operator delete(fill_program);
+    ::operator delete(depth_program);
+    return 0;
+}
@@ -0,0 +1,172 @@
+//Microbenchmark: Spatial_Index (a BVH) against linear scans over every box, for scenes of
+//1k, 10k and 100k objects scattered over a 1000 x 1000 city.  Per frame it runs:
+//  frustum: one camera frustum query
+//  sphere:  100 proximity queries (radius 5) around random points
+//  ray:     100 ray casts (nearest hit within 200)
+//  refit:   three objects (the door, key and plate) moved with update()
+//Every query's result is checked against the linear scan; any mismatch makes the exit code 1.
+//(tests/spatial_index_test.cpp covers the same queries as a ctest test.)
+//
+//CMake target: spatial_index_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/spatial_index_bench [frames]
+
+#include "spatial_index.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define SPHERE_QUERIES 100
+#define RAY_QUERIES 100
+
+static float random_float(float low, float high) {
+    return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+static std::vector<AABB> make_boxes(int count) {
+    std::vector<AABB> boxes(count);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 center(random_float(-500.0f,500.0f),random_float(-4.0f,16.0f),random_float(-500.0f,500.0f));
+        glm::vec3 extent(random_float(0.5f,8.0f),random_float(0.5f,12.0f),random_float(0.5f,8.0f));
+        boxes[i].min = center - extent;
+        boxes[i].max = center + extent;
+    }
+    return boxes;
+}
+
+//The queries for one frame
+struct Frame_Queries {
+    Frustum frustum;
+    glm::vec3 sphere_centers[SPHERE_QUERIES];
+    glm::vec3 ray_origins[RAY_QUERIES];
+    glm::vec3 ray_directions[RAY_QUERIES];
+    AABB moved[3];
+};
+
+static Frame_Queries make_queries(int frame, const std::vector<AABB>& boxes) {
+    Frame_Queries q;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),1280.0f/720.0f,0.1f,100.0f);
+    float yaw = glm::radians(frame * 0.6f);
+    glm::vec3 eye(10.0f,-3.0f,-3.0f);
+    q.frustum = extract_frustum(projection * glm::lookAt(eye,eye + glm::vec3(cosf(yaw),0.0f,sinf(yaw)),glm::vec3(0.0f,1.0f,0.0f)));
+    for (int i = 0; i < SPHERE_QUERIES; i++) {
+        q.sphere_centers[i] = glm::vec3(random_float(-500.0f,500.0f),0.0f,random_float(-500.0f,500.0f));
+    }
+    for (int i = 0; i < RAY_QUERIES; i++) {
+        q.ray_origins[i] = glm::vec3(random_float(-500.0f,500.0f),-3.0f,random_float(-500.0f,500.0f));
+        float angle = random_float(0.0f,6.2831853f);
+        q.ray_directions[i] = glm::vec3(cosf(angle),random_float(-0.1f,0.1f),sinf(angle));
+    }
+    //The first three boxes stand in for the moving objects: they slide back and forth
+    for (int m = 0; m < 3; m++) {
+        glm::vec3 offset(sinf(frame * 0.05f + m) * 2.0f,0.0f,0.0f);
+        q.moved[m].min = boxes[m].min + offset;
+        q.moved[m].max = boxes[m].max + offset;
+    }
+    return q;
+}
+
+//Results of one frame, sorted so the two versions can be compared
+struct Frame_Results {
+    std::vector<int> frustum_ids;
+    std::vector<int> sphere_ids;
+    std::vector<float> ray_distances;
+};
+
+static bool box_touches_sphere(const AABB& box, glm::vec3 center, float radius) {
+    glm::vec3 offset = center - glm::clamp(center,box.min,box.max);
+    return glm::dot(offset,offset) <= radius * radius;
+}
+
+static float ray_enters_box(const AABB& box, glm::vec3 origin, glm::vec3 direction, float max_distance) {
+    glm::vec3 inverse_direction = 1.0f / direction;
+    glm::vec3 t0 = (box.min - origin) * inverse_direction;
+    glm::vec3 t1 = (box.max - origin) * inverse_direction;
+    glm::vec3 t_near = glm::min(t0,t1);
+    glm::vec3 t_far = glm::max(t0,t1);
+    float enter = fmaxf(fmaxf(t_near.x,t_near.y),fmaxf(t_near.z,0.0f));
+    float leave = fminf(fminf(t_far.x,t_far.y),fminf(t_far.z,max_distance));
+    return enter <= leave ? enter : -1.0f;
+}
+
+static void run_linear(std::vector<AABB>& boxes, const Frame_Queries& q, Frame_Results& r) {
+    for (int m = 0; m < 3; m++) boxes[m] = q.moved[m];
+    for (size_t i = 0; i < boxes.size(); i++) {
+        if (aabb_visible(q.frustum,boxes[i])) r.frustum_ids.push_back(i);
+    }
+    for (int s = 0; s < SPHERE_QUERIES; s++) {
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (box_touches_sphere(boxes[i],q.sphere_centers[s],5.0f)) r.sphere_ids.push_back(i);
+        }
+    }
+    for (int s = 0; s < RAY_QUERIES; s++) {
+        float best = -1.0f;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            float t = ray_enters_box(boxes[i],q.ray_origins[s],q.ray_directions[s],200.0f);
+            if (t >= 0.0f && (best < 0.0f || t < best)) best = t;
+        }
+        r.ray_distances.push_back(best);
+    }
+}
+
+static void run_index(Spatial_Index& index, const std::vector<int>& proxies, const Frame_Queries& q, Frame_Results& r) {
+    for (int m = 0; m < 3; m++) index.update(proxies[m],q.moved[m]);
+    index.query_frustum(q.frustum,r.frustum_ids);
+    for (int s = 0; s < SPHERE_QUERIES; s++) index.query_sphere(q.sphere_centers[s],5.0f,r.sphere_ids);
+    for (int s = 0; s < RAY_QUERIES; s++) {
+        Ray_Hit hit;
+        r.ray_distances.push_back(index.raycast(q.ray_origins[s],q.ray_directions[s],200.0f,hit) ? hit.distance : -1.0f);
+    }
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 50;
+    int counts[3] = {1000, 10000, 100000};
+    int total_mismatches = 0;
+
+    printf("%8s %10s %14s %14s %9s %12s %10s\n", "objects", "build ms", "linear us/frm", "bvh us/frm", "speedup",
+           "nodes/frame", "mismatches");
+    for (int c = 0; c < 3; c++) {
+        srand(4242);
+        std::vector<AABB> boxes = make_boxes(counts[c]);
+        std::vector<Frame_Queries> queries;
+        for (int f = 0; f < frames; f++) queries.push_back(make_queries(f,boxes));
+
+        Spatial_Index index;
+        std::vector<int> proxies;
+        for (size_t i = 0; i < boxes.size(); i++) proxies.push_back(index.add(boxes[i],i));
+        auto build_start = std::chrono::steady_clock::now();
+        index.build();
+        double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+
+        std::vector<Frame_Results> linear_results(frames), index_results(frames);
+        auto start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) run_linear(boxes,queries[f],linear_results[f]);
+        double linear_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        index.nodes_visited = 0;
+        start = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; f++) run_index(index,proxies,queries[f],index_results[f]);
+        double index_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int mismatches = 0;
+        for (int f = 0; f < frames; f++) {
+            Frame_Results& a = linear_results[f];
+            Frame_Results& b = index_results[f];
+            std::sort(b.frustum_ids.begin(),b.frustum_ids.end());
+            std::sort(a.sphere_ids.begin(),a.sphere_ids.end());
+            std::sort(b.sphere_ids.begin(),b.sphere_ids.end());
+            if (a.frustum_ids != b.frustum_ids) mismatches++;
+            if (a.sphere_ids != b.sphere_ids) mismatches++;
+            if (a.ray_distances != b.ray_distances) mismatches++;
+        }
+        printf("%8d %10.2f %14.1f %14.1f %8.1fx %12u %10d\n", counts[c], build_seconds * 1e3, linear_seconds * 1e6 / frames,
+               index_seconds * 1e6 / frames, linear_seconds / index_seconds, index.nodes_visited / frames, mismatches);
+        total_mismatches += mismatches;
+    }
+    return total_mismatches == 0 ? 0 : 1;
+}
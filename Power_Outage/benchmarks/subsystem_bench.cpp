@@ -0,0 +1,230 @@
+//Microbenchmarks on Google Benchmark for the subsystems a frame (or a level load) spends its
+//time in.  Unlike the other benchmarks, which compare an old and a new version of one piece,
+//these track the current code's cost so builds (Release, LTO, PGO) can be compared:
+//  BM_ParseOBJ/<model>        ImportOBJ::parseFiles on the game's .obj/.mtl files (bytes/s)
+//  BM_DecodeTexture/<image>   decode_texture (stb_image) on the game's images (bytes/s of pixels)
+//  BM_CullBoxes*/<boxes>      frustum culling boxes scattered over the city, scalar and SSE
+//  BM_SpatialIndexFrustum     the same frustum query through the BVH
+//  BM_FrameCamera*            Frame_Uniforms uploads of the FrameCamera block, changed and unchanged
+//  BM_SetMat4*                Shader::setMat4 by name and by pre-resolved handle
+//The uniform benchmarks need an OpenGL context: built with POWER_OUTAGE_BENCH they make an
+//offscreen one over EGL (see environment_setup.hpp), and are skipped if that fails.
+//
+//CMake target: subsystem_bench (built when Google Benchmark is found)
+//Run (from the Power_Outage directory; any Google Benchmark flag works, e.g. --benchmark_filter=Cull):
+//  EGL_PLATFORM=surfaceless ./build/release/subsystem_bench [--benchmark_filter=REGEX] [--benchmark_format=json]
+
+#include <benchmark/benchmark.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef POWER_OUTAGE_BENCH
+#include "environment_setup.hpp"
+#endif
+#include "build_shapes.hpp"
+#include "frame_uniforms.hpp"
+#include "frustum.hpp"
+#include "import_object.hpp"
+#include "Shader.hpp"
+#include "spatial_index.hpp"
+
+static const char* OBJ_MODELS[] = {"models/key","models/door","models/office/walls","models/office/furniture",
+                                   "models/portals/portal1"};
+static const char* TEXTURE_IMAGES[] = {"images/bricks.jpg","skybox/front.jpg","textures/wallpaper.png",
+                                       "fonts/ArialBlackLarge.bmp"};
+
+static bool file_exists(const std::string& path, double* bytes = NULL) {
+    struct stat info;
+    if (stat(path.c_str(),&info) != 0) return false;
+    if (bytes != NULL) *bytes += info.st_size;
+    return true;
+}
+
+//Same scene as frustum_cull_bench: boxes over a 1000 x 1000 city, the game's camera turning in place
+static std::vector<AABB> make_boxes(int count) {
+    std::vector<AABB> boxes(count);
+    srand(1237);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 center(rand() % 1000 - 500.0f, rand() % 20 - 4.0f, rand() % 1000 - 500.0f);
+        glm::vec3 extent(0.5f + rand() % 8, 0.5f + rand() % 12, 0.5f + rand() % 8);
+        boxes[i].min = center - extent;
+        boxes[i].max = center + extent;
+    }
+    return boxes;
+}
+
+static glm::mat4 frame_view(int frame) {
+    float yaw = glm::radians(frame * 0.6f);
+    glm::vec3 eye(10.0f,-3.0f,-3.0f);
+    return glm::lookAt(eye,eye + glm::vec3(cosf(yaw),0.0f,sinf(yaw)),glm::vec3(0.0f,1.0f,0.0f));
+}
+
+static Frustum frame_frustum(int frame) {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),1280.0f/720.0f,0.1f,100.0f);
+    return extract_frustum(projection * frame_view(frame));
+}
+
+static void BM_ParseOBJ(benchmark::State& state, std::string base_name) {
+    double bytes = 0.0;
+    file_exists(base_name + ".obj",&bytes);
+    file_exists(base_name + ".mtl",&bytes);
+    ImportOBJ importer;
+    importer.debugOutput = false;
+    for (auto _ : state) {
+        if (!importer.parseFiles(base_name)) {
+            state.SkipWithError("could not open the .obj file");
+            break;
+        }
+        benchmark::DoNotOptimize(importer.getIndices().data());
+    }
+    state.SetBytesProcessed((int64_t)(bytes * state.iterations()));
+    state.counters["vertices"] = importer.getNumCombined();
+}
+
+static void BM_DecodeTexture(benchmark::State& state, std::string path) {
+    int64_t pixel_bytes = 0;
+    for (auto _ : state) {
+        Texture_Image image;
+        if (!decode_texture(path,image)) {
+            state.SkipWithError("could not decode the image");
+            break;
+        }
+        pixel_bytes = (int64_t)image.width * image.height * image.channels;
+        benchmark::DoNotOptimize(image.data);
+        free_texture_image(image);
+    }
+    state.SetBytesProcessed(pixel_bytes * state.iterations());
+}
+
+static void cull_boxes_benchmark(benchmark::State& state,
+                                 int (*cull)(const Frustum&, const AABB*, int, unsigned char*)) {
+    std::vector<AABB> boxes = make_boxes(state.range(0));
+    std::vector<unsigned char> visible(boxes.size());
+    int frame = 0;
+    long long total_visible = 0;
+    for (auto _ : state) {
+        total_visible += cull(frame_frustum(frame++),boxes.data(),boxes.size(),visible.data());
+    }
+    state.SetItemsProcessed(state.iterations() * boxes.size());
+    state.counters["visible"] = benchmark::Counter(total_visible,benchmark::Counter::kAvgIterations);
+}
+
+static void BM_CullBoxesScalar(benchmark::State& state) {
+    cull_boxes_benchmark(state,cull_boxes_scalar);
+}
+BENCHMARK(BM_CullBoxesScalar)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_CullBoxesSSE(benchmark::State& state) {
+    cull_boxes_benchmark(state,cull_boxes);
+}
+BENCHMARK(BM_CullBoxesSSE)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_SpatialIndexFrustum(benchmark::State& state) {
+    std::vector<AABB> boxes = make_boxes(state.range(0));
+    Spatial_Index index;
+    for (size_t i = 0; i < boxes.size(); i++) index.add(boxes[i],i);
+    index.build();
+    std::vector<int> ids;
+    int frame = 0;
+    long long total_visible = 0;
+    for (auto _ : state) {
+        ids.clear();
+        index.query_frustum(frame_frustum(frame++),ids);
+        total_visible += ids.size();
+    }
+    state.SetItemsProcessed(state.iterations() * boxes.size());
+    state.counters["visible"] = benchmark::Counter(total_visible,benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SpatialIndexFrustum)->Arg(1000)->Arg(10000)->Arg(100000);
+
+#ifdef POWER_OUTAGE_BENCH
+//The FrameCamera block as World::update_frame_uniforms fills it, with the camera turning when moving
+static Frame_Camera make_frame_camera(int frame) {
+    Frame_Camera camera = Frame_Camera(); //zeroed padding, update_camera compares the bytes
+    camera.view = frame_view(frame);
+    camera.projection = glm::perspective(glm::radians(45.0f),960.0f/720.0f,0.1f,100.0f);
+    camera.light_space = glm::mat4(1.0f);
+    camera.view_position = glm::vec4(10.0f,-3.0f,-3.0f,1.0f);
+    camera.time = frame / 60.0f;
+    return camera;
+}
+
+static void frame_camera_benchmark(benchmark::State& state, bool moving) {
+    Frame_Uniforms uniforms;
+    uniforms.initialize();
+    int frame = 0;
+    Frame_Uniforms::uploads = 0;
+    for (auto _ : state) {
+        uniforms.update_camera(make_frame_camera(moving ? frame++ : 0));
+    }
+    glFinish();
+    state.counters["uploads"] = benchmark::Counter(Frame_Uniforms::uploads,benchmark::Counter::kAvgIterations);
+}
+
+static void BM_FrameCameraChanged(benchmark::State& state) {
+    frame_camera_benchmark(state,true);
+}
+
+static void BM_FrameCameraUnchanged(benchmark::State& state) {
+    frame_camera_benchmark(state,false);
+}
+
+//One model matrix per draw, as render_scene sets it on the fill shader
+static void BM_SetMat4ByName(benchmark::State& state) {
+    Shader shader("shaders/vertexShader.glsl","shaders/fragmentShader.glsl");
+    shader.use();
+    glm::mat4 model(1.0f);
+    for (auto _ : state) {
+        model[3][0] += 0.001f;
+        shader.setMat4("model",model);
+    }
+    glFinish();
+}
+
+static void BM_SetMat4ByHandle(benchmark::State& state) {
+    Shader shader("shaders/vertexShader.glsl","shaders/fragmentShader.glsl");
+    shader.use();
+    Uniform_Handle model_uniform = shader.getUniform("model");
+    glm::mat4 model(1.0f);
+    for (auto _ : state) {
+        model[3][0] += 0.001f;
+        shader.setMat4(model_uniform,model);
+    }
+    glFinish();
+}
+#endif
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc,argv);
+    if (benchmark::ReportUnrecognizedArguments(argc,argv)) return 1;
+
+    //Only the assets that are present in this checkout are registered
+    for (size_t i = 0; i < sizeof(OBJ_MODELS)/sizeof(OBJ_MODELS[0]); i++) {
+        std::string base_name = OBJ_MODELS[i];
+        if (!file_exists(base_name + ".obj")) continue;
+        benchmark::RegisterBenchmark(("BM_ParseOBJ/" + base_name).c_str(),BM_ParseOBJ,base_name);
+    }
+    for (size_t i = 0; i < sizeof(TEXTURE_IMAGES)/sizeof(TEXTURE_IMAGES[0]); i++) {
+        std::string path = TEXTURE_IMAGES[i];
+        if (!file_exists(path)) continue;
+        benchmark::RegisterBenchmark(("BM_DecodeTexture/" + path).c_str(),BM_DecodeTexture,path);
+    }
+
+#ifdef POWER_OUTAGE_BENCH
+    if (initialize_headless_environment(64,64)) {
+        benchmark::RegisterBenchmark("BM_FrameCameraChanged",BM_FrameCameraChanged);
+        benchmark::RegisterBenchmark("BM_FrameCameraUnchanged",BM_FrameCameraUnchanged);
+        benchmark::RegisterBenchmark("BM_SetMat4ByName",BM_SetMat4ByName);
+        benchmark::RegisterBenchmark("BM_SetMat4ByHandle",BM_SetMat4ByHandle);
+    }
+    else std::cout << "No OpenGL context, the uniform benchmarks are skipped" << std::endl;
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
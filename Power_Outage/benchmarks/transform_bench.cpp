@@ -0,0 +1,128 @@
+//Microbenchmark: per-frame model matrix cost of a scene scaled up to thousands of static props.
+//  rebuild: every prop's matrix is rebuilt with glm::translate/rotate/scale in both the shadow
+//           and the main pass, as render_scene did before the matrices were cached
+//  cached:  every prop is a Transform; the matrices are built once and read back each pass
+//Both scenes also carry three moving objects (door, plate, key) whose state changes every
+//few frames.  Only the CPU side is timed; every element of every matrix goes into the checksum,
+//so the compiler cannot drop the rotate and scale work and keep only the translation.
+//
+//CMake target: transform_bench
+//Run (from the Power_Outage directory):
+//  ./build/release/transform_bench [frames]
+
+#include "transform.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+struct Prop {
+    glm::vec3 position;
+    float rotation;
+    glm::vec3 scale;
+};
+
+static std::vector<Prop> make_props(int count) {
+    std::vector<Prop> props;
+    srand(473);
+    for (int i = 0; i < count; i++) {
+        Prop prop;
+        prop.position = glm::vec3(rand() % 300 - 150.0f, -3.99f, rand() % 300 - 150.0f);
+        prop.rotation = (float)(rand() % 4) * 90.0f - 90.0f;
+        prop.scale = glm::vec3(0.2f + (rand() % 5) * 0.1f);
+        props.push_back(prop);
+    }
+    return props;
+}
+
+//Door state for a frame: it opens and closes every 120 frames
+static void door_state(int frame, glm::vec3& position, float& rotation) {
+    bool open = (frame / 120) % 2 == 1;
+    position = open ? glm::vec3(3.42,-3.99,4.9) : glm::vec3(4.0,-3.99,5.0);
+    rotation = open ? 90.0f : 0.0f;
+}
+
+//All sixteen elements, as a draw's glUniformMatrix4fv would read them
+static float matrix_sum(const glm::mat4& m) {
+    float sum = 0.0f;
+    for (int column = 0; column < 4; column++) {
+        sum += m[column][0] + m[column][1] + m[column][2] + m[column][3];
+    }
+    return sum;
+}
+
+static double run_rebuild(const std::vector<Prop>& props, int frames, float& sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        glm::vec3 door_position;
+        float door_rotation;
+        door_state(f,door_position,door_rotation);
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t i = 0; i < props.size(); i++) {
+                glm::mat4 model(1.0f);
+                model = glm::translate(model,props[i].position);
+                model = glm::rotate(model,glm::radians(props[i].rotation),glm::vec3(0.0,1.0,0.0));
+                model = glm::scale(model,props[i].scale);
+                sink += matrix_sum(model);
+            }
+            //The moving objects rebuilt theirs on every draw as well
+            for (int m = 0; m < 3; m++) {
+                glm::mat4 model(1.0f);
+                model = glm::translate(model,door_position);
+                model = glm::rotate(model,glm::radians(door_rotation),glm::vec3(0.0,1.0,0.0));
+                model = glm::scale(model,glm::vec3(0.638f));
+                model = glm::rotate(model,glm::radians(90.0f),glm::vec3(0.0,1.0,0.0));
+                sink += matrix_sum(model);
+            }
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double run_cached(const std::vector<Prop>& props, int frames, float& sink) {
+    std::vector<Transform> transforms;
+    transforms.reserve(props.size());
+    for (size_t i = 0; i < props.size(); i++) {
+        transforms.push_back(Transform(props[i].position,glm::vec3(0.0f,props[i].rotation,0.0f),props[i].scale));
+    }
+    std::vector<Transform> moving(3,Transform(glm::vec3(4.0,-3.99,5.0),glm::vec3(0.0f),glm::vec3(0.638f),90.0f));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        glm::vec3 door_position;
+        float door_rotation;
+        door_state(f,door_position,door_rotation);
+        for (int m = 0; m < 3; m++) {
+            moving[m].set_position(door_position);
+            moving[m].set_rotation(glm::vec3(0.0f,door_rotation,0.0f));
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            for (size_t i = 0; i < transforms.size(); i++) {
+                sink += matrix_sum(transforms[i].get_world_matrix());
+            }
+            for (int m = 0; m < 3; m++) {
+                sink += matrix_sum(moving[m].get_world_matrix());
+            }
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    int counts[4] = {17, 1000, 5000, 20000};
+    float sink = 0.0f;
+
+    printf("%8s %16s %16s %9s %10s\n", "props", "rebuild us/frm", "cached us/frm", "speedup", "rebuilds");
+    for (int c = 0; c < 4; c++) {
+        std::vector<Prop> props = make_props(counts[c]);
+        double rebuild_seconds = run_rebuild(props,frames,sink);
+        Transform::rebuilds = 0;
+        double cached_seconds = run_cached(props,frames,sink);
+        printf("%8d %16.2f %16.2f %8.2fx %10u\n", counts[c], rebuild_seconds * 1e6 / frames,
+               cached_seconds * 1e6 / frames, rebuild_seconds / cached_seconds, Transform::rebuilds);
+    }
+    printf("(checksum %g)\n", sink);
+    return 0;
+}
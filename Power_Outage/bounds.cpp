@@ -0,0 +1,68 @@
+#include <math.h>
+#include <string.h>
+#include "bounds.hpp"
+
+bool aabb_empty(const AABB& box) {
+    return box.min.x > box.max.x || box.min.y > box.max.y || box.min.z > box.max.z;
+}
+
+AABB aabb_everything() {
+    AABB box;
+    box.min = glm::vec3(-1e30f);
+    box.max = glm::vec3(1e30f);
+    return box;
+}
+
+void aabb_expand(AABB& box, glm::vec3 point) {
+    box.min = glm::min(box.min,point);
+    box.max = glm::max(box.max,point);
+}
+
+void aabb_expand(AABB& box, const AABB& other) {
+    if (aabb_empty(other)) return;
+    box.min = glm::min(box.min,other.min);
+    box.max = glm::max(box.max,other.max);
+}
+
+AABB aabb_transform(const AABB& box, const glm::mat4& model) {
+    if (aabb_empty(box)) return box;
+    glm::vec3 center = 0.5f * (box.min + box.max);
+    glm::vec3 extent = 0.5f * (box.max - box.min);
+    glm::vec3 new_center = glm::vec3(model * glm::vec4(center,1.0f));
+    glm::vec3 new_extent(0.0f);
+    for (int col = 0; col < 3; col++) {
+        for (int row = 0; row < 3; row++) {
+            new_extent[row] += fabsf(model[col][row]) * extent[col];
+        }
+    }
+    AABB result;
+    result.min = new_center - new_extent;
+    result.max = new_center + new_extent;
+    return result;
+}
+
+//Reads point i (memcpy, since the vertex layout need not keep floats aligned)
+static glm::vec3 read_point(const unsigned char* bytes, int i, int stride_bytes, int components) {
+    float xyz[3] = {0.0f,0.0f,0.0f};
+    memcpy(xyz,bytes + (size_t)i * stride_bytes,components * sizeof(float));
+    return glm::vec3(xyz[0],xyz[1],xyz[2]);
+}
+
+void compute_bounds(const void* data, int num_vertices, int stride_bytes, int components,
+                    AABB& box, Bounding_Sphere& sphere) {
+    box = AABB();
+    sphere = Bounding_Sphere();
+    if (data == NULL || num_vertices <= 0) return;
+    if (components > 3) components = 3;
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (int i = 0; i < num_vertices; i++) {
+        aabb_expand(box,read_point(bytes,i,stride_bytes,components));
+    }
+    sphere.center = 0.5f * (box.min + box.max);
+    float radius_squared = 0.0f;
+    for (int i = 0; i < num_vertices; i++) {
+        glm::vec3 offset = read_point(bytes,i,stride_bytes,components) - sphere.center;
+        radius_squared = fmaxf(radius_squared,glm::dot(offset,offset));
+    }
+    sphere.radius = sqrtf(radius_squared);
+}
@@ -0,0 +1,34 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <glm/glm.hpp>
+
+//Axis-aligned bounding box.  A box with min > max is empty.
+struct AABB {
+    glm::vec3 min = glm::vec3(1e30f);
+    glm::vec3 max = glm::vec3(-1e30f);
+};
+
+struct Bounding_Sphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = -1.0f;
+};
+
+bool aabb_empty(const AABB& box);
+//A box large enough to contain the whole scene, for shapes whose extent is unknown.
+//(Finite so plane tests never compute 0 * infinity.)
+AABB aabb_everything();
+//Grows a box to contain a point or another box
+void aabb_expand(AABB& box, glm::vec3 point);
+void aabb_expand(AABB& box, const AABB& other);
+//The axis-aligned box around a box moved by a model matrix (Arvo's method: transform the
+//center, and fold the matrix's absolute values into the half extents).
+AABB aabb_transform(const AABB& box, const glm::mat4& model);
+
+//Computes the box and sphere around num_vertices points read as float xyz (xy for 2D shapes,
+//with z = 0) every stride_bytes bytes.  The sphere is centered on the box and its radius is
+//the farthest point, which is tighter than half the box's diagonal.
+void compute_bounds(const void* data, int num_vertices, int stride_bytes, int components,
+                    AABB& box, Bounding_Sphere& sphere);
+
+#endif //BOUNDS_HPP
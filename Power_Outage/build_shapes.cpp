@@ -1,38 +1,81 @@
 #include "build_shapes.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "compressed_texture.hpp"
+#include "gl_state_cache.hpp"
+#include "mip_generator.hpp"
+#include "texture_cache.hpp"
 
 
 unsigned int get_texture (std::string path) {
+  return Texture_Cache::acquire(path);
+}
+
+bool decode_texture (std::string path, Texture_Image& image, bool compressed) {
+  if (compressed && load_compressed_texture(path, true, image)) return true;
+  // the per-thread flag leaves other threads' (and the global) flip setting alone
+  stbi_set_flip_vertically_on_load_thread(true);
+  image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+  image.data_bytes = (size_t)image.width * image.height * image.channels;
+  // the mip levels are made here, off the context thread, instead of by glGenerateMipmap
+  generate_mip_chain(image);
+  return image.data != NULL;
+}
+
+void upload_texture_levels (unsigned int target, const Texture_Image& image, const unsigned char* pixels) {
+  int format = image.channels > 3 ? GL_RGBA : GL_RGB;
+  int width = image.width, height = image.height;
+  size_t offset = 0;
+  // levels are packed without row padding (and RGB rows need not be a multiple of four bytes)
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (int level = 0; level < image.mip_levels; level++) {
+    if (image.compressed_format != 0) {
+      size_t bytes = compressed_level_bytes(image.compressed_format, width, height);
+      glCompressedTexImage2D(target, level, image.compressed_format, width, height, 0, bytes, pixels + offset);
+      offset += bytes;
+    }
+    else {
+      glTexImage2D(target, level, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels + offset);
+      offset += (size_t)width * height * image.channels;
+    }
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+unsigned int upload_texture (Texture_Image& image) {
   unsigned int texture = 0;
   glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  GL_State_Cache::bind_texture(0, GL_TEXTURE_2D, texture);
   // set the texture wrapping/filtering options (on the currently bound texture object)
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // load and generate the texture
-  int width, height, nrChannels;
-  stbi_set_flip_vertically_on_load(true);  
-  unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels,0);
-  int image_type = GL_RGB;
-  if (nrChannels > 3) {
-      image_type = GL_RGBA;
-  }
-  if (data) 
+  // generate the texture from the decoded pixels (with their mip chain, or the baked compressed one)
+  if (image.data) 
   {
-      glTexImage2D(GL_TEXTURE_2D, 0, image_type, width, height, 0, image_type, GL_UNSIGNED_BYTE, data);
-     glGenerateMipmap(GL_TEXTURE_2D);
+      upload_texture_levels(GL_TEXTURE_2D, image, image.data);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mip_levels - 1);
+      // GL_LINEAR only ever reads level 0, so a chain (generated or baked) needs the mipmap filter
+      if (image.mip_levels > 1) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
   }
   else
   {
       std::cout << "Failed to load texture" << std::endl;
   }
-  stbi_image_free(data);
+  free_texture_image(image);
   return texture;
 }
 
+void free_texture_image (Texture_Image& image) {
+  // compressed levels and generated mip chains are malloc'd, not stb's
+  if (image.compressed_format != 0 || image.mip_levels > 1) free(image.data);
+  else stbi_image_free(image.data);
+  image.data = NULL;
+}
+
 void set_up_shape(Shape* shape, void* data, int num_values,int num_vertex_vals, int data_size) {
     
     
@@ -293,10 +336,33 @@ void set_basic_cube (Shape* cube, bool flip_normal, bool outline) {
 unsigned int get_cube_map(std::vector<std::string> faces, bool cube_map_flag) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GL_State_Cache::bind_texture(0, GL_TEXTURE_CUBE_MAP, textureID);
+
+    //Baked .dds faces are used only if all six are there, since the faces must share a format
+    if (compressed_textures_supported()) {
+        std::vector<Texture_Image> compressed(faces.size());
+        bool all_compressed = true;
+        for (unsigned int i = 0; i < faces.size() && all_compressed; i++) {
+            all_compressed = load_compressed_texture(faces[i], cube_map_flag, compressed[i]);
+        }
+        for (unsigned int i = 0; i < faces.size(); i++) {
+            if (all_compressed) upload_texture_levels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, compressed[i], compressed[i].data);
+            free_texture_image(compressed[i]);
+        }
+        if (all_compressed) {
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, compressed[0].mip_levels - 1);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, compressed[0].mip_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            return textureID;
+        }
+    }
 
     int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(cube_map_flag);
+    //Per-thread flag: once decode_texture has set it on this thread, stb ignores the global one
+    stbi_set_flip_vertically_on_load_thread(cube_map_flag);
     for (unsigned int i = 0; i < faces.size(); i++)
     {
         unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
@@ -313,7 +379,7 @@ unsigned int get_cube_map(std::vector<std::string> faces, bool cube_map_flag) {
             stbi_image_free(data);
         }
     }
-    stbi_set_flip_vertically_on_load(!cube_map_flag);
+    stbi_set_flip_vertically_on_load_thread(!cube_map_flag);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -5,9 +5,40 @@
 
 
 //Given a file path and file name, loads a texture into memory and returns an identifier for that 
-// texture.
+// texture.  Goes through Texture_Cache, so asking for the same file again returns the same texture.
 unsigned int get_texture (std::string path);
 
+//Pixels decoded from an image file with their mip chain (see mip_generator.hpp), waiting to be
+// uploaded, or the compressed mip chain read from its baked .dds (see compressed_texture.hpp)
+struct Texture_Image {
+  unsigned char* data = NULL;
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  //0 for plain pixels, otherwise the GL format of the compressed levels
+  unsigned int compressed_format = 0;
+  //Levels in data, largest first and back to back
+  int mip_levels = 1;
+  size_t data_bytes = 0;
+};
+
+//First half of get_texture: decodes the image file without touching OpenGL, so it may run on
+// any thread.  With compressed set (pass compressed_textures_supported(), asked on the context
+// thread) a baked .dds of the image is read instead when there is an up to date one.  Otherwise
+// the image's mip chain is generated along with it.  Returns false if the file could not be loaded.
+bool decode_texture (std::string path, Texture_Image& image, bool compressed = false);
+
+//Second half of get_texture: creates the texture from decoded pixels (on the GL context thread)
+// and frees the pixels.
+unsigned int upload_texture (Texture_Image& image);
+
+//Specifies every level of image on target (the bound 2D texture or a cube map face).  pixels is
+// image.data, or the offset of the same bytes in the bound GL_PIXEL_UNPACK_BUFFER.
+void upload_texture_levels (unsigned int target, const Texture_Image& image, const unsigned char* pixels);
+
+//Frees decoded pixels that will not be uploaded
+void free_texture_image (Texture_Image& image);
+
 //Creates a generic shape given vertex data
 void set_up_shape(Shape* shape, void* data, int num_values,int num_vertex_vals, int data_size);
 
@@ -68,6 +68,12 @@ void Camera::set_position(glm::vec3 newPos) {
     this->position = newPos;
 }
 
+void Camera::set_orientation(float yaw, float pitch) {
+    this->yaw = yaw;
+    this->pitch = pitch;
+    this->update_camera_vectors();
+}
+
 void Camera::update_camera_vectors() {
       //glm::vec3 front;
       this->front.x = cos(glm::radians(this->yaw)) * cos(glm::radians(this->pitch));
@@ -42,6 +42,8 @@ class Camera {
   float get_pitch();
   float get_yaw();
   void set_position(glm::vec3 newPos);
+  //Look along the given yaw and pitch (degrees), e.g. to follow a scripted path
+  void set_orientation(float yaw, float pitch);
 
   glm::mat4 get_view_matrix ();
 
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "camera_path.hpp"
+
+bool Camera_Path::load(std::string path) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cout << "ERROR: could not open camera path " << path << std::endl;
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file,line)) {
+        line_number++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line = line.substr(0,comment);
+        std::istringstream fields(line);
+        Camera_Key key;
+        if (!(fields >> key.time)) continue;
+        if (!(fields >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch)) {
+            std::cout << "ERROR: " << path << ":" << line_number << ": bad camera key" << std::endl;
+            continue;
+        }
+        add_key(key);
+    }
+    if (keys.empty()) {
+        std::cout << "ERROR: camera path " << path << " has no keys" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Camera_Path::add_key(Camera_Key key) {
+    //Keep the keys sorted; equal times stay in the order they were added
+    std::vector<Camera_Key>::iterator at = std::upper_bound(keys.begin(),keys.end(),key,
+        [](const Camera_Key& a, const Camera_Key& b) { return a.time < b.time; });
+    keys.insert(at,key);
+}
+
+void Camera_Path::clear() {
+    keys.clear();
+}
+
+Camera_Key Camera_Path::sample(float time) {
+    if (keys.empty()) return Camera_Key();
+    if (time <= keys.front().time) return keys.front();
+    if (time >= keys.back().time) return keys.back();
+    size_t next = 1;
+    while (keys[next].time <= time) next++;
+    const Camera_Key& a = keys[next-1];
+    const Camera_Key& b = keys[next];
+    float t = (time - a.time) / (b.time - a.time);
+    Camera_Key key;
+    key.time = time;
+    key.position = a.position + (b.position - a.position) * t;
+    key.yaw = a.yaw + (b.yaw - a.yaw) * t;
+    key.pitch = a.pitch + (b.pitch - a.pitch) * t;
+    return key;
+}
+
+float Camera_Path::get_duration() {
+    return keys.empty() ? 0.0f : keys.back().time;
+}
+
+int Camera_Path::size() {
+    return keys.size();
+}
@@ -0,0 +1,37 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+//Where the camera is at one point in time (yaw and pitch in degrees, as Camera uses them)
+struct Camera_Key {
+    float time = 0.0f;
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+};
+
+//A scripted camera flight: keys sorted by time, linearly interpolated between.  Before the
+//first key the camera sits at the first key, after the last key at the last one.
+//
+//Path files have one key per line, '#' starts a comment:
+//  time  x y z  yaw pitch
+class Camera_Path {
+    public:
+        //Reads a path file, replacing any keys (false if it cannot be read or has no keys)
+        bool load(std::string path);
+        void add_key(Camera_Key key);
+        void clear();
+
+        Camera_Key sample(float time);
+        //Time of the last key
+        float get_duration();
+        int size();
+
+    private:
+        std::vector<Camera_Key> keys;
+};
+
+#endif //CAMERA_PATH_HPP
@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include "collision_world.hpp"
+
+bool read_collision_objects(std::string path, std::vector<Collision_Object>& objects) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cout << "ERROR: could not open collision file " << path << std::endl;
+        return false;
+    }
+    //Vertices before the first o/g line belong to an object named after the file
+    Collision_Object current;
+    current.name = path;
+    std::string line;
+    while (std::getline(file,line)) {
+        if (line.size() < 2) continue;
+        if ((line[0] == 'o' || line[0] == 'g') && line[1] == ' ') {
+            if (!aabb_empty(current.box)) objects.push_back(current);
+            current = Collision_Object();
+            std::istringstream name(line.substr(2));
+            name >> current.name;
+        }
+        else if (line[0] == 'v' && line[1] == ' ') {
+            glm::vec3 v(0.0f);
+            std::istringstream values(line.substr(2));
+            values >> v.x >> v.y >> v.z;
+            aabb_expand(current.box,v);
+        }
+    }
+    if (!aabb_empty(current.box)) objects.push_back(current);
+    return true;
+}
+
+int Collision_World::add_box(const AABB& box, std::string name) {
+    Collider collider;
+    collider.box = box;
+    collider.name = name;
+    colliders.push_back(collider);
+    last_gathered.push_back(0);
+    insert_into_grid(colliders.size() - 1);
+    return colliders.size() - 1;
+}
+
+int Collision_World::add_objects(const std::vector<Collision_Object>& objects, const glm::mat4& model) {
+    int first = colliders.size();
+    for (size_t i = 0; i < objects.size(); i++) {
+        add_box(aabb_transform(objects[i].box,model),objects[i].name);
+    }
+    return first;
+}
+
+int Collision_World::load_obj(std::string path, const glm::mat4& model) {
+    std::vector<Collision_Object> objects;
+    if (!read_collision_objects(path,objects)) return -1;
+    return add_objects(objects,model);
+}
+
+int Collision_World::find(std::string name) {
+    for (size_t i = 0; i < colliders.size(); i++) {
+        if (colliders[i].name == name) return i;
+    }
+    return -1;
+}
+
+void Collision_World::set_enabled(int collider, bool enabled) {
+    if (collider < 0 || collider >= (int)colliders.size()) {
+        std::cout << "ERROR: Collision_World has no collider " << collider << std::endl;
+        return;
+    }
+    colliders[collider].enabled = enabled;
+}
+
+void Collision_World::set_box(int collider, const AABB& box) {
+    if (collider < 0 || collider >= (int)colliders.size()) {
+        std::cout << "ERROR: Collision_World has no collider " << collider << std::endl;
+        return;
+    }
+    remove_from_grid(collider);
+    colliders[collider].box = box;
+    insert_into_grid(collider);
+}
+
+const Collider& Collision_World::get_collider(int collider) {
+    return colliders[collider];
+}
+
+int Collision_World::size() {
+    return colliders.size();
+}
+
+void Collision_World::clear() {
+    colliders.clear();
+    grid.clear();
+    last_gathered.clear();
+}
+
+int64_t Collision_World::cell_key(int x, int z) {
+    return ((int64_t)x << 32) ^ (int64_t)(uint32_t)z;
+}
+
+void Collision_World::cell_range(const AABB& box, int& x0, int& z0, int& x1, int& z1) {
+    x0 = (int)floorf(box.min.x / COLLISION_CELL_SIZE);
+    z0 = (int)floorf(box.min.z / COLLISION_CELL_SIZE);
+    x1 = (int)floorf(box.max.x / COLLISION_CELL_SIZE);
+    z1 = (int)floorf(box.max.z / COLLISION_CELL_SIZE);
+}
+
+void Collision_World::insert_into_grid(int collider) {
+    int x0, z0, x1, z1;
+    cell_range(colliders[collider].box,x0,z0,x1,z1);
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) grid[cell_key(x,z)].push_back(collider);
+    }
+}
+
+void Collision_World::remove_from_grid(int collider) {
+    int x0, z0, x1, z1;
+    cell_range(colliders[collider].box,x0,z0,x1,z1);
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) {
+            std::vector<int>& cell = grid[cell_key(x,z)];
+            cell.erase(std::remove(cell.begin(),cell.end(),collider),cell.end());
+        }
+    }
+}
+
+void Collision_World::gather(const AABB& region, std::vector<int>& found) {
+    found.clear();
+    if (!use_broadphase) {
+        for (size_t i = 0; i < colliders.size(); i++) {
+            if (colliders[i].enabled) found.push_back(i);
+        }
+        stats.candidates += found.size();
+        return;
+    }
+    query_number++;
+    int x0, z0, x1, z1;
+    cell_range(region,x0,z0,x1,z1);
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) {
+            std::unordered_map<int64_t, std::vector<int> >::const_iterator cell = grid.find(cell_key(x,z));
+            if (cell == grid.end()) continue;
+            for (size_t i = 0; i < cell->second.size(); i++) {
+                int c = cell->second[i];
+                if (last_gathered[c] == query_number || !colliders[c].enabled) continue;
+                last_gathered[c] = query_number;
+                found.push_back(c);
+            }
+        }
+    }
+    //Handle order, so results do not depend on the cell layout when boxes overlap
+    std::sort(found.begin(),found.end());
+    stats.candidates += found.size();
+}
+
+static AABB grow(const AABB& box, float radius) {
+    AABB grown;
+    grown.min = box.min - glm::vec3(radius);
+    grown.max = box.max + glm::vec3(radius);
+    return grown;
+}
+
+static bool point_inside(const AABB& box, glm::vec3 p) {
+    return p.x > box.min.x && p.x < box.max.x && p.y > box.min.y && p.y < box.max.y && p.z > box.min.z && p.z < box.max.z;
+}
+
+//Ray (origin + t * motion, t in [0, 1]) against a box: the entry time and the face's normal
+static bool sweep_box(const AABB& box, glm::vec3 origin, glm::vec3 motion, float& t_hit, glm::vec3& normal) {
+    float enter = 0.0f, leave = 1.0f;
+    int enter_axis = -1;
+    for (int axis = 0; axis < 3; axis++) {
+        if (fabsf(motion[axis]) < 1e-12f) {
+            if (origin[axis] <= box.min[axis] || origin[axis] >= box.max[axis]) return false;
+            continue;
+        }
+        float t0 = (box.min[axis] - origin[axis]) / motion[axis];
+        float t1 = (box.max[axis] - origin[axis]) / motion[axis];
+        if (t0 > t1) std::swap(t0,t1);
+        if (t0 > enter) {
+            enter = t0;
+            enter_axis = axis;
+        }
+        leave = fminf(leave,t1);
+        if (enter >= leave) return false;
+    }
+    //Starting inside (or exactly on a face with no entry) is handled by the push-out
+    if (enter_axis < 0) return false;
+    t_hit = enter;
+    normal = glm::vec3(0.0f);
+    normal[enter_axis] = motion[enter_axis] > 0.0f ? -1.0f : 1.0f;
+    return true;
+}
+
+glm::vec3 Collision_World::move_sphere(glm::vec3 start, glm::vec3 motion, float radius) {
+    stats.queries++;
+    AABB region;
+    aabb_expand(region,start);
+    aabb_expand(region,start + motion);
+    region = grow(region,radius + COLLISION_SKIN);
+    gather(region,candidates);
+
+    glm::vec3 position = start;
+    //Push out of anything the sphere already overlaps, along the shallowest axis
+    for (size_t i = 0; i < candidates.size(); i++) {
+        AABB grown = grow(colliders[candidates[i]].box,radius);
+        if (!point_inside(grown,position)) continue;
+        stats.hits++;
+        float best = 1e30f;
+        glm::vec3 push(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            float down = position[axis] - grown.min[axis];
+            float up = grown.max[axis] - position[axis];
+            if (down < best) { best = down; push = glm::vec3(0.0f); push[axis] = -(down + COLLISION_SKIN); }
+            if (up < best) { best = up; push = glm::vec3(0.0f); push[axis] = up + COLLISION_SKIN; }
+        }
+        position += push;
+    }
+
+    glm::vec3 remaining = motion;
+    for (int slide = 0; slide < COLLISION_MAX_SLIDES; slide++) {
+        if (glm::dot(remaining,remaining) < 1e-12f) break;
+        float first_t = 1.0f;
+        glm::vec3 first_normal(0.0f);
+        bool hit = false;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            float t;
+            glm::vec3 normal;
+            if (sweep_box(grow(colliders[candidates[i]].box,radius),position,remaining,t,normal) && t < first_t) {
+                first_t = t;
+                first_normal = normal;
+                hit = true;
+            }
+        }
+        if (!hit) {
+            position += remaining;
+            break;
+        }
+        stats.hits++;
+        //Stop just short of the face, then keep the part of the motion along it
+        float length = glm::length(remaining);
+        float t = fmaxf(0.0f,first_t - COLLISION_SKIN / length);
+        position += remaining * t;
+        remaining *= (1.0f - t);
+        remaining -= first_normal * glm::dot(remaining,first_normal);
+    }
+    return position;
+}
+
+bool Collision_World::overlaps_sphere(glm::vec3 center, float radius) {
+    stats.queries++;
+    AABB region;
+    aabb_expand(region,center);
+    region = grow(region,radius);
+    gather(region,candidates);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const AABB& box = colliders[candidates[i]].box;
+        glm::vec3 offset = center - glm::clamp(center,box.min,box.max);
+        if (glm::dot(offset,offset) <= radius * radius) {
+            stats.hits++;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,92 @@
+#ifndef COLLISION_WORLD_HPP
+#define COLLISION_WORLD_HPP
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bounds.hpp"
+
+//Size (world units) of the broadphase grid cells in x and z
+#define COLLISION_CELL_SIZE 4.0f
+//Most times one move_sphere call slides along a new surface before it stops
+#define COLLISION_MAX_SLIDES 4
+//Distance kept between a moved sphere and the surface it stopped against
+#define COLLISION_SKIN 0.001f
+
+//A named box something can bump into.  Disabled colliders are skipped (e.g. an open door).
+struct Collider {
+    AABB box;
+    std::string name;
+    bool enabled = true;
+};
+
+//One box per object ("o" or "g" line) of an OBJ file, in the file's coordinates
+struct Collision_Object {
+    std::string name;
+    AABB box;
+};
+
+//Reads the objects of an OBJ file without touching OpenGL (only the v/o/g lines are used), so
+//collision geometry can come from the drawn model or from a simpler collision-only file.
+//Returns false (after printing an error) if the file cannot be opened.
+bool read_collision_objects(std::string path, std::vector<Collision_Object>& objects);
+
+//Move and overlap tests since the last reset.  candidates counts the colliders the
+//broadphase handed to the exact test.
+struct Collision_Stats {
+    unsigned int queries = 0;
+    unsigned int candidates = 0;
+    unsigned int hits = 0;
+};
+
+//Static and movable boxes the player (a sphere) collides with.  Colliders are bucketed into a
+//uniform x/z grid, so a query only tests the boxes in the cells it passes through.  Headless:
+//it only needs glm.
+class Collision_World {
+    public:
+        //Adds a box and returns its collider handle.
+        int add_box(const AABB& box, std::string name = "");
+        //Adds the read objects, each moved by model.  Returns the first new handle.
+        int add_objects(const std::vector<Collision_Object>& objects, const glm::mat4& model);
+        //Reads an OBJ file and adds its objects (returns -1 if it could not be read).
+        int load_obj(std::string path, const glm::mat4& model);
+        //Handle of the first collider with the name, or -1
+        int find(std::string name);
+        void set_enabled(int collider, bool enabled);
+        //Replaces a collider's box (for things that move)
+        void set_box(int collider, const AABB& box);
+        const Collider& get_collider(int collider);
+        int size();
+        void clear();
+
+        //Moves a sphere from start by motion and returns where it ends up.  It stops at the first
+        //box in its way and slides the rest of the motion along that box's face.  Boxes are grown
+        //by the radius, so corners are treated as square rather than rounded.  A sphere that
+        //starts inside a box is first pushed out the shortest way.
+        glm::vec3 move_sphere(glm::vec3 start, glm::vec3 motion, float radius);
+        //True if the sphere touches an enabled collider
+        bool overlaps_sphere(glm::vec3 center, float radius);
+
+        //False tests every collider instead of using the grid (for comparisons)
+        bool use_broadphase = true;
+        Collision_Stats stats;
+
+    private:
+        //Appends the enabled colliders whose cells overlap the box (each once)
+        void gather(const AABB& region, std::vector<int>& candidates);
+        void insert_into_grid(int collider);
+        void remove_from_grid(int collider);
+        void cell_range(const AABB& box, int& x0, int& z0, int& x1, int& z1);
+        static int64_t cell_key(int x, int z);
+
+        std::vector<Collider> colliders;
+        std::unordered_map<int64_t, std::vector<int> > grid;
+        //Query number each collider was last gathered in, to skip duplicates across cells
+        std::vector<unsigned int> last_gathered;
+        unsigned int query_number = 0;
+        std::vector<int> candidates;
+};
+
+#endif //COLLISION_WORLD_HPP
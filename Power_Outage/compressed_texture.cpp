@@ -0,0 +1,358 @@
+#include "compressed_texture.hpp"
+#include <glad/glad.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <vector>
+
+//The DDS header (after the "DDS " magic), all little-endian 32-bit words
+struct DDS_Header {
+    uint32_t size;              //124
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t linear_size;       //bytes of the top level
+    uint32_t depth;
+    uint32_t mip_levels;
+    uint32_t reserved1[11];     //[0] "POTX", [1] row order (DDS_POTX_FLIPPED)
+    uint32_t format_size;       //32
+    uint32_t format_flags;
+    uint32_t four_cc;
+    uint32_t format_unused[5];  //bit count and masks of uncompressed formats
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+#define DDS_MAGIC 0x20534444          //"DDS "
+#define DDS_FOURCC_DXT1 0x31545844    //"DXT1"
+#define DDS_FOURCC_DXT5 0x35545844    //"DXT5"
+#define DDS_POTX_MARKER 0x58544F50    //"POTX"
+#define DDS_POTX_FLIPPED 1            //bottom row first, as glTexImage2D reads it
+#define DDSD_CAPS 0x1
+#define DDSD_HEIGHT 0x2
+#define DDSD_WIDTH 0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE 0x80000
+#define DDPF_FOURCC 0x4
+#define DDSCAPS_COMPLEX 0x8
+#define DDSCAPS_TEXTURE 0x1000
+#define DDSCAPS_MIPMAP 0x400000
+
+std::string compressed_texture_path(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t separator = path.find_last_of("/\\");
+    if (dot == std::string::npos || (separator != std::string::npos && dot < separator)) return path + ".dds";
+    return path.substr(0,dot) + ".dds";
+}
+
+bool compressed_textures_supported() {
+    static int supported = -1;
+    if (supported < 0) {
+        supported = 0;
+        int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS,&count);
+        for (int i = 0; i < count; i++) {
+            const char* name = (const char*)glGetStringi(GL_EXTENSIONS,i);
+            if (name != NULL && strcmp(name,"GL_EXT_texture_compression_s3tc") == 0) supported = 1;
+        }
+    }
+    return supported == 1;
+}
+
+size_t compressed_level_bytes(unsigned int format, int width, int height) {
+    size_t block_bytes = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? BC3_BLOCK_BYTES : BC1_BLOCK_BYTES;
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+}
+
+static size_t compressed_chain_bytes(unsigned int format, int width, int height, int levels) {
+    size_t bytes = 0;
+    for (int level = 0; level < levels; level++) {
+        bytes += compressed_level_bytes(format,width,height);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+static bool file_mtime(const std::string& path, time_t& mtime) {
+    struct stat info;
+    if (stat(path.c_str(),&info) != 0) return false;
+    mtime = info.st_mtime;
+    return true;
+}
+
+bool load_compressed_texture(const std::string& path, bool flipped, Texture_Image& image) {
+    std::string dds_path = compressed_texture_path(path);
+    time_t dds_time, source_time;
+    if (!file_mtime(dds_path,dds_time)) return false;
+    //A source edited after baking wins (a missing source does not matter)
+    if (file_mtime(path,source_time) && source_time > dds_time) return false;
+
+    FILE* file = fopen(dds_path.c_str(),"rb");
+    if (file == NULL) return false;
+    uint32_t magic = 0;
+    DDS_Header header;
+    bool valid = fread(&magic,sizeof(magic),1,file) == 1 && fread(&header,sizeof(header),1,file) == 1 &&
+                 magic == DDS_MAGIC && header.size == sizeof(DDS_Header) &&
+                 (header.format_flags & DDPF_FOURCC) != 0 &&
+                 (header.four_cc == DDS_FOURCC_DXT1 || header.four_cc == DDS_FOURCC_DXT5) &&
+                 header.reserved1[0] == DDS_POTX_MARKER &&
+                 (header.reserved1[1] & DDS_POTX_FLIPPED) == (flipped ? DDS_POTX_FLIPPED : 0u) &&
+                 header.width > 0 && header.height > 0 && header.width <= 16384 && header.height <= 16384 &&
+                 header.mip_levels >= 1 && (int)header.mip_levels <= mip_level_count(header.width,header.height);
+    if (!valid) {
+        fclose(file);
+        return false;
+    }
+
+    unsigned int format = header.four_cc == DDS_FOURCC_DXT5 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    size_t bytes = compressed_chain_bytes(format,header.width,header.height,header.mip_levels);
+    unsigned char* data = (unsigned char*)malloc(bytes);
+    if (data == NULL || fread(data,1,bytes,file) != bytes) {
+        std::cout << "ERROR: " << dds_path << " is truncated" << std::endl;
+        free(data);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    image.data = data;
+    image.width = header.width;
+    image.height = header.height;
+    image.channels = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 4 : 3;
+    image.compressed_format = format;
+    image.mip_levels = header.mip_levels;
+    image.data_bytes = bytes;
+    return true;
+}
+
+//565 color of an RGB pixel, and its expansion back to 8 bits per channel as the GPU decodes it
+static uint16_t pack_565(const int* rgb) {
+    return (uint16_t)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+static void unpack_565(uint16_t color, int* rgb) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+//Endpoints from the corners of the colors' bounding box, inset by a sixteenth to spend less of
+//the palette on outliers, along the diagonal that follows how green and blue vary with red.
+//Each pixel then takes the nearest of the four palette colors.
+static void compress_color_block(const unsigned char* rgba, unsigned char* block) {
+    int low[3] = {255,255,255}, high[3] = {0,0,0};
+    int mean[3] = {0,0,0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            int value = rgba[i * 4 + c];
+            if (value < low[c]) low[c] = value;
+            if (value > high[c]) high[c] = value;
+            mean[c] += value;
+        }
+    }
+    int covariance[3] = {0,0,0};
+    for (int i = 0; i < 16; i++) {
+        int red = rgba[i * 4] * 16 - mean[0];
+        for (int c = 1; c < 3; c++) covariance[c] += red * (rgba[i * 4 + c] * 16 - mean[c]);
+    }
+    int end0[3], end1[3];
+    for (int c = 0; c < 3; c++) {
+        int inset = (high[c] - low[c]) / 16;
+        end0[c] = high[c] - inset;
+        end1[c] = low[c] + inset;
+        if (c > 0 && covariance[c] < 0) {
+            int swap = end0[c];
+            end0[c] = end1[c];
+            end1[c] = swap;
+        }
+    }
+
+    uint16_t color0 = pack_565(end0), color1 = pack_565(end1);
+    //color0 > color1 selects the four-color palette (BC3 always uses it)
+    if (color0 < color1) {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+    block[0] = color0 & 0xFF;
+    block[1] = color0 >> 8;
+    block[2] = color1 & 0xFF;
+    block[3] = color1 >> 8;
+    uint32_t indices = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpack_565(color0,palette[0]);
+        unpack_565(color1,palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, best_distance = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int distance = 0;
+                for (int c = 0; c < 3; c++) {
+                    int d = rgba[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < best_distance) {
+                    best = p;
+                    best_distance = distance;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    memcpy(block + 4,&indices,4);
+}
+
+//Endpoints are the lowest and highest alpha, in the eight-value mode (alpha0 > alpha1)
+static void compress_alpha_block(const unsigned char* rgba, unsigned char* block) {
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++) {
+        int alpha = rgba[i * 4 + 3];
+        if (alpha < low) low = alpha;
+        if (alpha > high) high = alpha;
+    }
+    block[0] = (unsigned char)high;
+    block[1] = (unsigned char)low;
+    uint64_t indices = 0;
+    if (high > low) {
+        int palette[8];
+        palette[0] = high;
+        palette[1] = low;
+        for (int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * high + p * low) / 7;
+        for (int i = 0; i < 16; i++) {
+            int alpha = rgba[i * 4 + 3];
+            int best = 0, best_distance = 256;
+            for (int p = 0; p < 8; p++) {
+                int distance = abs(alpha - palette[p]);
+                if (distance < best_distance) {
+                    best = p;
+                    best_distance = distance;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; i++) block[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+void compress_bc1_block(const unsigned char* rgba, unsigned char* block) {
+    compress_color_block(rgba,block);
+}
+
+void compress_bc3_block(const unsigned char* rgba, unsigned char* block) {
+    compress_alpha_block(rgba,block);
+    compress_color_block(rgba,block + 8);
+}
+
+//Compresses one RGBA level block by block; edge blocks repeat the last row and column
+static void compress_level(const unsigned char* rgba, int width, int height, bool alpha, unsigned char* out) {
+    unsigned char pixels[64];
+    for (int by = 0; by < height; by += 4) {
+        for (int bx = 0; bx < width; bx += 4) {
+            for (int y = 0; y < 4; y++) {
+                int row = by + y < height ? by + y : height - 1;
+                for (int x = 0; x < 4; x++) {
+                    int column = bx + x < width ? bx + x : width - 1;
+                    memcpy(pixels + (y * 4 + x) * 4,&rgba[((size_t)row * width + column) * 4],4);
+                }
+            }
+            if (alpha) {
+                compress_bc3_block(pixels,out);
+                out += BC3_BLOCK_BYTES;
+            }
+            else {
+                compress_bc1_block(pixels,out);
+                out += BC1_BLOCK_BYTES;
+            }
+        }
+    }
+}
+
+size_t write_compressed_texture(const std::string& path, const Texture_Image& image, bool flipped, const Mip_Options& options) {
+    if (image.data == NULL || image.compressed_format != 0 || image.mip_levels > 1 || image.channels < 1 || image.channels > 4) return 0;
+
+    //Expand to RGBA (gray images replicate into red, green and blue), then make its mip chain
+    Texture_Image rgba;
+    rgba.width = image.width;
+    rgba.height = image.height;
+    rgba.channels = 4;
+    rgba.data = (unsigned char*)malloc((size_t)image.width * image.height * 4);
+    if (rgba.data == NULL) return 0;
+    bool alpha = false;
+    for (size_t i = 0; i < (size_t)image.width * image.height; i++) {
+        const unsigned char* pixel = image.data + i * image.channels;
+        unsigned char* out = rgba.data + i * 4;
+        if (image.channels < 3) out[0] = out[1] = out[2] = pixel[0];
+        else memcpy(out,pixel,3);
+        out[3] = image.channels == 2 ? pixel[1] : image.channels == 4 ? pixel[3] : 255;
+        if (out[3] != 255) alpha = true;
+    }
+    if (!generate_mip_chain(rgba,options)) {
+        free(rgba.data);
+        return 0;
+    }
+
+    unsigned int format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    int levels = mip_level_count(image.width,image.height);
+    size_t bytes = compressed_chain_bytes(format,image.width,image.height,levels);
+    std::vector<unsigned char> blob(4 + sizeof(DDS_Header) + bytes,0);
+    uint32_t magic = DDS_MAGIC;
+    DDS_Header header;
+    memset(&header,0,sizeof(header));
+    header.size = sizeof(DDS_Header);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = image.height;
+    header.width = image.width;
+    header.linear_size = compressed_level_bytes(format,image.width,image.height);
+    header.mip_levels = levels;
+    header.reserved1[0] = DDS_POTX_MARKER;
+    header.reserved1[1] = flipped ? DDS_POTX_FLIPPED : 0;
+    header.format_size = 32;
+    header.format_flags = DDPF_FOURCC;
+    header.four_cc = alpha ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+    header.caps = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+    memcpy(&blob[0],&magic,4);
+    memcpy(&blob[4],&header,sizeof(header));
+
+    size_t offset = 4 + sizeof(DDS_Header);
+    const unsigned char* level = rgba.data;
+    int width = image.width, height = image.height;
+    for (int l = 0; l < levels; l++) {
+        compress_level(level,width,height,alpha,&blob[offset]);
+        offset += compressed_level_bytes(format,width,height);
+        level += (size_t)width * height * 4;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    free_texture_image(rgba);
+
+    //Written under a temporary name so a reader never sees half a file
+    std::string dds_path = compressed_texture_path(path);
+    std::string temp_path = dds_path + ".tmp";
+    FILE* file = fopen(temp_path.c_str(),"wb");
+    if (file == NULL) {
+        std::cout << "ERROR: Could not write compressed texture " << temp_path << std::endl;
+        return 0;
+    }
+    bool written = fwrite(&blob[0],1,blob.size(),file) == blob.size();
+    written = fclose(file) == 0 && written;
+    //rename() does not replace an existing file on Windows
+    remove(dds_path.c_str());
+    if (!written || rename(temp_path.c_str(),dds_path.c_str()) != 0) {
+        std::cout << "ERROR: Could not write compressed texture " << dds_path << std::endl;
+        remove(temp_path.c_str());
+        return 0;
+    }
+    return bytes;
+}
@@ -0,0 +1,58 @@
+#ifndef COMPRESSED_TEXTURE_HPP
+#define COMPRESSED_TEXTURE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "build_shapes.hpp"
+#include "mip_generator.hpp"
+
+//Block-compressed textures baked offline (tools/bake_textures.cpp) into a .dds file next to
+//each source image, e.g. textures/gold.jpg -> textures/gold.dds.  The file holds the whole mip
+//chain as BC1 (DXT1, opaque images) or BC3 (DXT5, images with alpha), so loading it is a file
+//read and one glCompressedTexImage2D per level: no decoding and no glGenerateMipmap.
+//
+//Layout: the standard "DDS " magic and 124-byte header with a DXT1/DXT5 FourCC, then every mip
+//level from the largest down to 1x1.  Two of the header's reserved words hold a "POTX" marker
+//and the row order: the game uploads 2D textures bottom row first (decode_texture flips them)
+//and cube map faces top row first, so each file is baked for one of the two and the loader
+//only takes a file baked for the orientation it asks for.
+
+//From EXT_texture_compression_s3tc, which core OpenGL does not name
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+//Bytes of one 4x4 block
+#define BC1_BLOCK_BYTES 8
+#define BC3_BLOCK_BYTES 16
+
+//The .dds path baked for an image path
+std::string compressed_texture_path(const std::string& path);
+
+//True if the context can sample S3TC textures.  Asks OpenGL once, so the first call must be
+//on the context thread; later calls (e.g. from workers) return the remembered answer.
+bool compressed_textures_supported();
+
+//Reads the .dds baked for path into image (compressed_format, mip_levels and data_bytes set).
+//Returns false, leaving image empty, if there is none, it is older than the source image, it
+//was baked for the other row order, or it is malformed.
+bool load_compressed_texture(const std::string& path, bool flipped, Texture_Image& image);
+
+//Bytes of a width x height level of the given compressed format
+size_t compressed_level_bytes(unsigned int format, int width, int height);
+
+//Compresses one 4x4 block of RGBA pixels (row by row, 64 bytes)
+void compress_bc1_block(const unsigned char* rgba, unsigned char* block);
+void compress_bc3_block(const unsigned char* rgba, unsigned char* block);
+
+//Builds the mip chain of decoded pixels with generate_mip_chain, compresses every level (BC3
+//if any pixel is not opaque, BC1 otherwise) and writes the .dds for path.  flipped records the
+//row order of the pixels.  Returns the bytes of the mip chain written (0 on failure).
+size_t write_compressed_texture(const std::string& path, const Texture_Image& image, bool flipped,
+                                const Mip_Options& options = Mip_Options());
+
+#endif //COMPRESSED_TEXTURE_HPP
@@ -8,6 +8,10 @@
 
 #include <iostream>
 
+#ifdef POWER_OUTAGE_BENCH
+#include <EGL/egl.h>
+#endif
+
 //callback used when the user resizes the window
 void framebuffer_size_callback(GLFWwindow* win, int width, int height) {
   glViewport(0,0,width,height);
@@ -49,4 +53,58 @@ GLFWwindow* initialize_environment(int width, int height, std::string title) {
   return window;
 }
 
+#ifdef POWER_OUTAGE_BENCH
+//Headless mode (see headless_bench.hpp): creates an OpenGL 3.3 core context on an offscreen
+//EGL pbuffer of width x height, with the depth and stencil bits a window would have, and
+//initializes GLAD.  The pbuffer is the default framebuffer, so the post processing pass draws
+//the finished frame into it.  Works with Mesa's llvmpipe; EGL_PLATFORM=surfaceless needs no
+//display server.  Returns false (after printing why) if no such context can be made.
+bool initialize_headless_environment(int width, int height) {
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display == EGL_NO_DISPLAY || !eglInitialize(display,NULL,NULL)) {
+    std::cout << "Failed to initialize EGL" << std::endl;
+    return false;
+  }
+  EGLint config_attributes[] = {
+    EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+    EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+    EGL_NONE
+  };
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display,config_attributes,&config,1,&num_configs) || num_configs == 0) {
+    std::cout << "Failed to find an EGL pbuffer config" << std::endl;
+    return false;
+  }
+  eglBindAPI(EGL_OPENGL_API);
+  EGLint context_attributes[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+  };
+  EGLContext context = eglCreateContext(display,config,EGL_NO_CONTEXT,context_attributes);
+  if (context == EGL_NO_CONTEXT) {
+    std::cout << "Failed to create an OpenGL 3.3 core context" << std::endl;
+    return false;
+  }
+  EGLint surface_attributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+  EGLSurface surface = eglCreatePbufferSurface(display,config,surface_attributes);
+  if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display,surface,surface,context)) {
+    std::cout << "Failed to create the offscreen surface" << std::endl;
+    return false;
+  }
+
+  //Get the function pointers for OpenGL
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return false;
+  }
+  glViewport(0,0,width,height);
+  return true;
+}
+#endif
+
 #endif //ENVIRONMENT_SETUP_HPP
\ No newline at end of file
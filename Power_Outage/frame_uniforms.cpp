@@ -0,0 +1,41 @@
+#include "frame_uniforms.hpp"
+#include <glad/glad.h>
+#include <string.h>
+
+unsigned int Frame_Uniforms::uploads = 0;
+
+void Frame_Uniforms::initialize() {
+    glGenBuffers(1, &this->camera_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Camera), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CAMERA_BINDING, this->camera_ubo);
+
+    glGenBuffers(1, &this->lights_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->lights_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame_Lights), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_LIGHTS_BINDING, this->lights_ubo);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    this->camera_valid = false;
+    this->lights_valid = false;
+}
+
+void Frame_Uniforms::update_camera(const Frame_Camera& camera) {
+    if (this->camera_valid && memcmp(&camera, &this->last_camera, sizeof(Frame_Camera)) == 0) return;
+    glBindBuffer(GL_UNIFORM_BUFFER, this->camera_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Camera), &camera);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    this->last_camera = camera;
+    this->camera_valid = true;
+    uploads++;
+}
+
+void Frame_Uniforms::update_lights(const Frame_Lights& lights) {
+    if (this->lights_valid && memcmp(&lights, &this->last_lights, sizeof(Frame_Lights)) == 0) return;
+    glBindBuffer(GL_UNIFORM_BUFFER, this->lights_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame_Lights), &lights);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    this->last_lights = lights;
+    this->lights_valid = true;
+    uploads++;
+}
@@ -0,0 +1,101 @@
+#ifndef FRAME_UNIFORMS_HPP
+#define FRAME_UNIFORMS_HPP
+
+#include <glm/glm.hpp>
+#include <stddef.h>
+
+//Binding points of the per-frame uniform blocks.  Shader binds any program that declares
+//the blocks to these points right after linking.
+#define FRAME_CAMERA_BINDING 0
+#define FRAME_LIGHTS_BINDING 1
+
+//C++ mirrors of the std140 uniform blocks declared in the shaders.  Each vec3 is followed by a
+//float (or the bool "on") so that no member needs hidden padding.  Keep them in sync with:
+//
+//  layout (std140) uniform FrameCamera {
+//    mat4 view; mat4 projection; mat4 lightSpaceMatrix; vec4 view_position; float time;
+//  };
+//  layout (std140) uniform FrameLights {
+//    PointLight point_light; SpotLight spot_light; DirLight dir_light;
+//  };
+struct Frame_Camera {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 light_space;
+    glm::vec4 view_position;
+    float time;
+    float pad[3];
+};
+
+struct Point_Light_Block {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    int on;
+};
+
+struct Spot_Light_Block {
+    glm::vec3 position;
+    float cutOff;
+    glm::vec3 direction;
+    float outerCutOff;
+    glm::vec3 ambient;
+    float constant;
+    glm::vec3 diffuse;
+    float linear;
+    glm::vec3 specular;
+    float quadratic;
+    int on;
+    float pad[3];
+};
+
+struct Dir_Light_Block {
+    glm::vec3 direction;
+    int on;
+    glm::vec3 ambient;
+    float pad0;
+    glm::vec3 diffuse;
+    float pad1;
+    glm::vec3 specular;
+    float pad2;
+};
+
+struct Frame_Lights {
+    Point_Light_Block point_light;
+    Spot_Light_Block spot_light;
+    Dir_Light_Block dir_light;
+};
+
+static_assert(sizeof(Frame_Camera) == 224 && offsetof(Frame_Camera, time) == 208, "Frame_Camera must match std140");
+static_assert(sizeof(Point_Light_Block) == 64, "Point_Light_Block must match std140");
+static_assert(sizeof(Spot_Light_Block) == 96 && offsetof(Spot_Light_Block, on) == 80, "Spot_Light_Block must match std140");
+static_assert(sizeof(Dir_Light_Block) == 64, "Dir_Light_Block must match std140");
+static_assert(offsetof(Frame_Lights, spot_light) == 64 && offsetof(Frame_Lights, dir_light) == 160,
+              "Frame_Lights must match std140");
+
+//Owns the two uniform buffers.  Each update uploads with one glBufferSubData, and only if
+//the contents changed since the last upload.
+class Frame_Uniforms {
+    public:
+        //Creates the buffers and attaches them to their binding points (needs the GL context).
+        void initialize();
+        void update_camera(const Frame_Camera& camera);
+        void update_lights(const Frame_Lights& lights);
+
+        //Number of glBufferSubData uploads since the last reset (counted like Shader::uniform_calls)
+        static unsigned int uploads;
+
+    private:
+        unsigned int camera_ubo = 0;
+        unsigned int lights_ubo = 0;
+        bool camera_valid = false;
+        bool lights_valid = false;
+        Frame_Camera last_camera;
+        Frame_Lights last_lights;
+};
+
+#endif //FRAME_UNIFORMS_HPP
@@ -0,0 +1,99 @@
+#include <math.h>
+#include "frustum.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRUSTUM_USE_SSE 1
+#endif
+
+Frustum extract_frustum(const glm::mat4& projection_view) {
+    //glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(projection_view[0][i],projection_view[1][i],projection_view[2][i],projection_view[3][i]);
+    }
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 plane(0.0f,0.0f,0.0f,1.0f);
+        if (i < 6) {
+            float length = glm::length(glm::vec3(frustum.planes[i]));
+            if (length > 0.0f) frustum.planes[i] = frustum.planes[i] * (1.0f / length);
+            plane = frustum.planes[i];
+        }
+        frustum.normal_x[i] = plane.x;
+        frustum.normal_y[i] = plane.y;
+        frustum.normal_z[i] = plane.z;
+        frustum.distance[i] = plane.w;
+    }
+    return frustum;
+}
+
+bool sphere_visible(const Frustum& frustum, const Bounding_Sphere& sphere) {
+    if (sphere.radius < 0.0f) return false;
+    for (int i = 0; i < 6; i++) {
+        const glm::vec4& plane = frustum.planes[i];
+        if (glm::dot(glm::vec3(plane),sphere.center) + plane.w < -sphere.radius) return false;
+    }
+    return true;
+}
+
+bool aabb_visible(const Frustum& frustum, const AABB& box) {
+    for (int i = 0; i < 6; i++) {
+        //The corner farthest along the plane's normal: if even it is behind, the box is outside
+        const glm::vec4& plane = frustum.planes[i];
+        float distance = plane.w;
+        distance += fmaxf(plane.x * box.min.x,plane.x * box.max.x);
+        distance += fmaxf(plane.y * box.min.y,plane.y * box.max.y);
+        distance += fmaxf(plane.z * box.min.z,plane.z * box.max.z);
+        if (distance < 0.0f) return false;
+    }
+    return true;
+}
+
+int cull_boxes_scalar(const Frustum& frustum, const AABB* boxes, int count, unsigned char* visible) {
+    int num_visible = 0;
+    for (int i = 0; i < count; i++) {
+        visible[i] = aabb_visible(frustum,boxes[i]) ? 1 : 0;
+        num_visible += visible[i];
+    }
+    return num_visible;
+}
+
+#ifdef FRUSTUM_USE_SSE
+int cull_boxes(const Frustum& frustum, const AABB* boxes, int count, unsigned char* visible) {
+    //Planes 0-3 in the first register of each set, 4-5 and two always-passing ones in the second
+    __m128 normal_x[2] = {_mm_load_ps(frustum.normal_x),_mm_load_ps(frustum.normal_x + 4)};
+    __m128 normal_y[2] = {_mm_load_ps(frustum.normal_y),_mm_load_ps(frustum.normal_y + 4)};
+    __m128 normal_z[2] = {_mm_load_ps(frustum.normal_z),_mm_load_ps(frustum.normal_z + 4)};
+    __m128 distance[2] = {_mm_load_ps(frustum.distance),_mm_load_ps(frustum.distance + 4)};
+    __m128 zero = _mm_setzero_ps();
+    int num_visible = 0;
+    for (int i = 0; i < count; i++) {
+        const AABB& box = boxes[i];
+        __m128 min_x = _mm_set1_ps(box.min.x), max_x = _mm_set1_ps(box.max.x);
+        __m128 min_y = _mm_set1_ps(box.min.y), max_y = _mm_set1_ps(box.max.y);
+        __m128 min_z = _mm_set1_ps(box.min.z), max_z = _mm_set1_ps(box.max.z);
+        int outside = 0;
+        for (int half = 0; half < 2; half++) {
+            __m128 d = distance[half];
+            d = _mm_add_ps(d,_mm_max_ps(_mm_mul_ps(normal_x[half],min_x),_mm_mul_ps(normal_x[half],max_x)));
+            d = _mm_add_ps(d,_mm_max_ps(_mm_mul_ps(normal_y[half],min_y),_mm_mul_ps(normal_y[half],max_y)));
+            d = _mm_add_ps(d,_mm_max_ps(_mm_mul_ps(normal_z[half],min_z),_mm_mul_ps(normal_z[half],max_z)));
+            outside |= _mm_movemask_ps(_mm_cmplt_ps(d,zero));
+        }
+        visible[i] = outside ? 0 : 1;
+        num_visible += visible[i];
+    }
+    return num_visible;
+}
+#else
+int cull_boxes(const Frustum& frustum, const AABB* boxes, int count, unsigned char* visible) {
+    return cull_boxes_scalar(frustum,boxes,count,visible);
+}
+#endif
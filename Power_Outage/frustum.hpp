@@ -0,0 +1,39 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+//Visible/culled draws since the last reset (counted by Render_Queue::cull)
+struct Cull_Stats {
+    unsigned int visible = 0;
+    unsigned int culled = 0;
+};
+
+//The six clip planes of a projection * view matrix, normalized so that
+//dot(normal, p) + d is the signed distance of p from the plane (positive inside).
+//The planes are also kept transposed (all x, then all y, ...) and padded to eight with an
+//always-passing plane, so cull_boxes can test four planes per SSE instruction.
+struct Frustum {
+    glm::vec4 planes[6];
+    alignas(16) float normal_x[8];
+    alignas(16) float normal_y[8];
+    alignas(16) float normal_z[8];
+    alignas(16) float distance[8];
+};
+
+//Gribb/Hartmann plane extraction: left, right, bottom, top, near, far.
+Frustum extract_frustum(const glm::mat4& projection_view);
+
+//False only if the sphere or box is entirely outside one of the planes (conservative: boxes near
+//a frustum corner may pass although they are outside).
+bool sphere_visible(const Frustum& frustum, const Bounding_Sphere& sphere);
+bool aabb_visible(const Frustum& frustum, const AABB& box);
+
+//Tests count boxes and writes 1 (visible) or 0 (culled) to visible[i].  Returns the number
+//visible.  Uses SSE where the compiler targets it, otherwise aabb_visible for each box.
+int cull_boxes(const Frustum& frustum, const AABB* boxes, int count, unsigned char* visible);
+//The plain one-box-at-a-time version of cull_boxes (for comparison in benchmarks)
+int cull_boxes_scalar(const Frustum& frustum, const AABB* boxes, int count, unsigned char* visible);
+
+#endif //FRUSTUM_HPP
@@ -0,0 +1,94 @@
+#include "gl_state_cache.hpp"
+
+//Marks a binding whose current value is not known (after invalidate)
+#define UNKNOWN_BINDING 0xFFFFFFFFu
+
+//A fresh context has everything unbound and GL_TEXTURE0 active
+GL_State_Stats GL_State_Cache::stats;
+unsigned int GL_State_Cache::program = 0;
+unsigned int GL_State_Cache::active_unit = 0;
+unsigned int GL_State_Cache::textures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGETS] = {};
+unsigned int GL_State_Cache::vao = 0;
+unsigned int GL_State_Cache::framebuffer = 0;
+
+void GL_State_Cache::use_program(unsigned int program) {
+    if (GL_State_Cache::program == program) {
+        stats.skipped++;
+        return;
+    }
+    glUseProgram(program);
+    GL_State_Cache::program = program;
+    stats.program_switches++;
+}
+
+void GL_State_Cache::active_texture(unsigned int unit) {
+    if (active_unit == unit) return;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    active_unit = unit;
+}
+
+void GL_State_Cache::bind_texture(unsigned int unit, GLenum target, unsigned int texture) {
+    int index = target_index(target);
+    if (unit >= GL_STATE_TEXTURE_UNITS || index < 0) {
+        //Not tracked: bind it, and forget what the unit held
+        active_texture(unit);
+        glBindTexture(target, texture);
+        stats.texture_binds++;
+        if (unit < GL_STATE_TEXTURE_UNITS) {
+            for (int i = 0; i < GL_STATE_TEXTURE_TARGETS; i++) textures[unit][i] = UNKNOWN_BINDING;
+        }
+        return;
+    }
+    if (textures[unit][index] == texture) {
+        stats.skipped++;
+        return;
+    }
+    active_texture(unit);
+    glBindTexture(target, texture);
+    textures[unit][index] = texture;
+    stats.texture_binds++;
+}
+
+void GL_State_Cache::bind_vertex_array(unsigned int vao) {
+    if (GL_State_Cache::vao == vao) {
+        stats.skipped++;
+        return;
+    }
+    glBindVertexArray(vao);
+    GL_State_Cache::vao = vao;
+    stats.vao_binds++;
+}
+
+void GL_State_Cache::bind_framebuffer(unsigned int framebuffer) {
+    if (GL_State_Cache::framebuffer == framebuffer) {
+        stats.skipped++;
+        return;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GL_State_Cache::framebuffer = framebuffer;
+    stats.framebuffer_binds++;
+}
+
+void GL_State_Cache::invalidate() {
+    program = UNKNOWN_BINDING;
+    active_unit = UNKNOWN_BINDING;
+    for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+        for (int i = 0; i < GL_STATE_TEXTURE_TARGETS; i++) textures[unit][i] = UNKNOWN_BINDING;
+    }
+    vao = UNKNOWN_BINDING;
+    framebuffer = UNKNOWN_BINDING;
+}
+
+void GL_State_Cache::reset_stats() {
+    stats = GL_State_Stats();
+}
+
+int GL_State_Cache::target_index(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_CUBE_MAP: return 1;
+        case GL_TEXTURE_BUFFER: return 2;
+        case GL_TEXTURE_2D_ARRAY: return 3;
+        default: return -1;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef GL_STATE_CACHE_HPP
+#define GL_STATE_CACHE_HPP
+
+#include <glad/glad.h>
+
+//Number of texture units the cache tracks (GL 3.3 guarantees at least 16 per stage)
+#define GL_STATE_TEXTURE_UNITS 16
+//Texture targets tracked per unit: 2D, cube map, buffer and 2D array
+#define GL_STATE_TEXTURE_TARGETS 4
+
+//Binds issued (and binds skipped because the object was already bound) since the last reset
+struct GL_State_Stats {
+    unsigned int program_switches = 0;
+    unsigned int texture_binds = 0;
+    unsigned int vao_binds = 0;
+    unsigned int framebuffer_binds = 0;
+    unsigned int skipped = 0;
+};
+
+//Remembers the currently bound program, textures, VAO and framebuffer and only calls into
+//OpenGL when a bind would change them.  The cache only works if every bind in the program
+//goes through it, so use these instead of glUseProgram/glActiveTexture/glBindTexture/
+//glBindVertexArray/glBindFramebuffer.  Call invalidate() after code that binds behind its back.
+class GL_State_Cache {
+    public:
+        static void use_program(unsigned int program);
+        //Makes GL_TEXTURE0 + unit the active unit.
+        static void active_texture(unsigned int unit);
+        //Binds a texture to a unit (and leaves that unit active).
+        static void bind_texture(unsigned int unit, GLenum target, unsigned int texture);
+        static void bind_vertex_array(unsigned int vao);
+        static void bind_framebuffer(unsigned int framebuffer);
+        //Forgets everything, so the next bind of each kind always reaches OpenGL.
+        static void invalidate();
+
+        static GL_State_Stats stats;
+        static void reset_stats();
+
+    private:
+        static int target_index(GLenum target);
+
+        static unsigned int program;
+        static unsigned int active_unit;
+        static unsigned int textures[GL_STATE_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGETS];
+        static unsigned int vao;
+        static unsigned int framebuffer;
+};
+
+#endif //GL_STATE_CACHE_HPP
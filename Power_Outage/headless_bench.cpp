@@ -0,0 +1,197 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gl_state_cache.hpp"
+#include "headless_bench.hpp"
+#include "png_writer.hpp"
+#include "profiler.hpp"
+
+static double bench_now_us() {
+  return std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void print_bench_usage(const char* program) {
+  std::cout << "Usage: " << program << " [--frames N] [--warmup N] [--capture-every K] [--capture-dir DIR]"
+            << " [--report FILE] [--path FILE] [--replay FILE] [--atlas 0|1] [--city N] [--instancing 0|1]" << std::endl;
+}
+
+bool parse_bench_options(int argc, char** argv, Bench_Options& options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cout << "ERROR: " << arg << " needs a value" << std::endl;
+      print_bench_usage(argv[0]);
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--frames") options.frames = atoi(value.c_str());
+    else if (arg == "--warmup") options.warmup_frames = atoi(value.c_str());
+    else if (arg == "--capture-every") options.capture_every = atoi(value.c_str());
+    else if (arg == "--capture-dir") options.capture_dir = value;
+    else if (arg == "--report") options.report_path = value;
+    else if (arg == "--path") options.camera_path = value;
+    else if (arg == "--replay") options.replay_path = value;
+    else if (arg == "--atlas") options.texture_atlas = atoi(value.c_str()) != 0;
+    else if (arg == "--city") options.city_buildings = atoi(value.c_str());
+    else if (arg == "--instancing") options.instancing = atoi(value.c_str()) != 0;
+    else {
+      std::cout << "ERROR: unknown option " << arg << std::endl;
+      print_bench_usage(argv[0]);
+      return false;
+    }
+  }
+  if (options.frames < 1 || options.warmup_frames < 0 || options.capture_every < 0 || options.city_buildings < 0) {
+    std::cout << "ERROR: --frames must be at least 1, --warmup, --capture-every and --city at least 0" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+Bench_Recorder::Bench_Recorder(const Bench_Options& options, int width, int height) {
+  this->options = options;
+  this->width = width;
+  this->height = height;
+  frame_ms.reserve(options.frames);
+}
+
+void Bench_Recorder::begin_frame() {
+  frame_start_us = bench_now_us();
+}
+
+void Bench_Recorder::end_frame(int frame) {
+  frame_ms.push_back((bench_now_us() - frame_start_us) / 1000.0);
+  program_switches += GL_State_Cache::stats.program_switches;
+  texture_binds += GL_State_Cache::stats.texture_binds;
+  vao_binds += GL_State_Cache::stats.vao_binds;
+  framebuffer_binds += GL_State_Cache::stats.framebuffer_binds;
+  check_gl_errors();
+  bool last = frame == options.frames - 1;
+  if (options.capture_every <= 0 || (frame % options.capture_every != 0 && !last)) return;
+
+  //The post processing pass draws the finished frame into the default framebuffer (bound
+  //through the cache after the frame's binds were counted, so the capture does not skew them)
+  std::vector<unsigned char> pixels((size_t)width * height * 4);
+  GL_State_Cache::bind_framebuffer(0);
+  glPixelStorei(GL_PACK_ALIGNMENT,1);
+  glReadPixels(0,0,width,height,GL_RGBA,GL_UNSIGNED_BYTE,pixels.data());
+  char name[32];
+  snprintf(name,sizeof(name),"frame_%05d.png",frame);
+  std::string path = options.capture_dir + "/" + name;
+  if (write_png(path,width,height,4,pixels.data(),true)) captures.push_back(path);
+}
+
+int Bench_Recorder::check_gl_errors() {
+  int errors = 0;
+  for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+    if (gl_errors + errors < 10) std::cout << "ERROR: OpenGL error 0x" << std::hex << error << std::dec << std::endl;
+    errors++;
+  }
+  gl_errors += errors;
+  return errors;
+}
+
+//Strings from the driver and file paths can hold anything
+static std::string json_string(const std::string& text) {
+  std::string quoted = "\"";
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') quoted += '\\';
+    if ((unsigned char)c < 0x20) quoted += ' ';
+    else quoted += c;
+  }
+  return quoted + "\"";
+}
+
+static std::string json_summary(const Profile_Summary& summary) {
+  char buffer[128];
+  snprintf(buffer,sizeof(buffer),"{\"min\":%.4f,\"avg\":%.4f,\"p99\":%.4f,\"samples\":%d}",
+           summary.min,summary.avg,summary.p99,summary.samples);
+  return buffer;
+}
+
+void Bench_Recorder::add_counter(const std::string& name, double per_frame) {
+  counters.push_back(std::make_pair(name,per_frame));
+}
+
+bool Bench_Recorder::finish(double setup_ms) {
+  std::vector<float> sorted(frame_ms);
+  std::sort(sorted.begin(),sorted.end());
+  double total = 0.0;
+  for (size_t i = 0; i < sorted.size(); i++) total += sorted[i];
+  double avg = sorted.empty() ? 0.0 : total / sorted.size();
+  //Nearest-rank percentiles, as the profiler computes them
+  float p50 = 0.0f, p99 = 0.0f;
+  if (!sorted.empty()) {
+    p50 = sorted[std::max((size_t)1,(size_t)(0.50 * sorted.size() + 0.999999)) - 1];
+    p99 = sorted[std::max((size_t)1,(size_t)(0.99 * sorted.size() + 0.999999)) - 1];
+  }
+
+  const char* renderer = (const char*)glGetString(GL_RENDERER);
+  const char* version = (const char*)glGetString(GL_VERSION);
+  std::ostringstream json;
+  char buffer[256];
+  json << "{\n";
+  json << "  \"renderer\": " << json_string(renderer ? renderer : "") << ",\n";
+  json << "  \"gl_version\": " << json_string(version ? version : "") << ",\n";
+  json << "  \"width\": " << width << ",\n";
+  json << "  \"height\": " << height << ",\n";
+  json << "  \"frames\": " << frame_ms.size() << ",\n";
+  snprintf(buffer,sizeof(buffer),"  \"setup_ms\": %.3f,\n",setup_ms);
+  json << buffer;
+  snprintf(buffer,sizeof(buffer),
+           "  \"frame_ms\": {\"min\":%.4f,\"avg\":%.4f,\"p50\":%.4f,\"p99\":%.4f,\"max\":%.4f},\n",
+           sorted.empty() ? 0.0f : sorted.front(),avg,p50,p99,sorted.empty() ? 0.0f : sorted.back());
+  json << buffer;
+  snprintf(buffer,sizeof(buffer),"  \"fps\": %.2f,\n",avg > 0.0 ? 1000.0 / avg : 0.0);
+  json << buffer;
+  json << "  \"frame_times_ms\": [";
+  for (size_t i = 0; i < frame_ms.size(); i++) {
+    snprintf(buffer,sizeof(buffer),"%s%.4f",i == 0 ? "" : ",",frame_ms[i]);
+    json << buffer;
+  }
+  json << "],\n";
+  //Per-phase times cover the profiler's history (the last PROFILER_HISTORY frames)
+  json << "  \"scopes\": [";
+  std::vector<std::string> names = Profiler::get_scope_names();
+  for (size_t i = 0; i < names.size(); i++) {
+    const Rolling_History* gpu = Profiler::get_gpu_history(names[i]);
+    json << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << json_string(names[i])
+         << ", \"cpu_ms\": " << json_summary(Profiler::get_cpu_history(names[i])->summary());
+    if (gpu->size() > 0) json << ", \"gpu_ms\": " << json_summary(gpu->summary());
+    json << "}";
+  }
+  json << "\n  ],\n";
+  //Binds that reached OpenGL, averaged over the measured frames
+  double frames = frame_ms.empty() ? 1.0 : frame_ms.size();
+  snprintf(buffer,sizeof(buffer),
+           "  \"gl_state_per_frame\": {\"program_switches\":%.1f,\"texture_binds\":%.1f,\"vao_binds\":%.1f,\"framebuffer_binds\":%.1f},\n",
+           program_switches / frames,texture_binds / frames,vao_binds / frames,framebuffer_binds / frames);
+  json << buffer;
+  json << "  \"counters_per_frame\": {";
+  for (size_t i = 0; i < counters.size(); i++) {
+    snprintf(buffer,sizeof(buffer),"%.1f",counters[i].second);
+    json << (i == 0 ? "" : ",") << json_string(counters[i].first) << ":" << buffer;
+  }
+  json << "},\n";
+  json << "  \"gpu_frames_dropped\": " << Profiler::dropped_gpu_frames << ",\n";
+  json << "  \"gl_errors\": " << gl_errors << ",\n";
+  json << "  \"captures\": [";
+  for (size_t i = 0; i < captures.size(); i++) json << (i == 0 ? "" : ", ") << json_string(captures[i]);
+  json << "]\n}\n";
+
+  bool ok = gl_errors == 0;
+  std::ofstream file(options.report_path.c_str());
+  if (!file.is_open()) {
+    std::cout << "ERROR: could not write " << options.report_path << std::endl;
+    ok = false;
+  }
+  else file << json.str();
+  std::cout << json.str();
+  return ok;
+}
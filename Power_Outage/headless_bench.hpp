@@ -0,0 +1,75 @@
+#ifndef HEADLESS_BENCH_HPP
+#define HEADLESS_BENCH_HPP
+
+//power_outage_bench: the game built with POWER_OUTAGE_BENCH renders offscreen (an EGL pbuffer,
+//so Mesa's llvmpipe works on machines without a GPU or display), flies the camera along a
+//scripted path (or replays a session recorded with --record, see input_replay.hpp) for a number
+//of frames and writes a JSON report of the frame times, the profiler's per-phase times, the
+//GL state changes per frame and the counters the game adds (the skybox's fill rate).  It can also save PNG captures of the finished frames.
+//The exit code is 0 unless setup failed or OpenGL reported errors.
+//
+//CMake target: power_outage_bench (built when EGL is found)
+//Run (from the Power_Outage directory; EGL_PLATFORM=surfaceless needs no display at all):
+//  EGL_PLATFORM=surfaceless ./build/release/power_outage_bench [--frames N] [--warmup N] [--capture-every K]
+//                                                              [--capture-dir DIR] [--report FILE] [--path FILE]
+//                                                              [--replay FILE] [--atlas 0|1] [--city N]
+//                                                              [--instancing 0|1]
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Bench_Options {
+  int frames = 300;
+  //Rendered before the measured frames and left out of the report
+  int warmup_frames = 3;
+  //Save every K-th frame as a PNG (0 = no captures).  The last frame is always saved when on.
+  int capture_every = 0;
+  std::string capture_dir = ".";
+  std::string report_path = "bench_report.json";
+  std::string camera_path = "levels/bench_camera_path.txt";
+  //Play this input recording instead of the camera path (frames = its frame count)
+  std::string replay_path;
+  //Draw the models' textures from the texture atlas (0 gives each its own texture, to compare)
+  bool texture_atlas = true;
+  //Extra buildings filling the city around the office (the game has only the four)
+  int city_buildings = 0;
+  //Draw the buildings with one instanced call (0 queues one draw per building, to compare)
+  bool instancing = true;
+};
+
+//Reads the options above from the command line; prints usage and returns false on a bad one
+bool parse_bench_options(int argc, char** argv, Bench_Options& options);
+
+//Collects the frame times and captures of a run and writes the report
+class Bench_Recorder {
+  public:
+    Bench_Recorder(const Bench_Options& options, int width, int height);
+    //Call around each frame.  end_frame() expects the frame to be finished (glFinish) and
+    //reads back the default framebuffer when the frame is due for a capture.
+    void begin_frame();
+    void end_frame(int frame);
+    //Counts errors OpenGL reports and returns how many there were
+    int check_gl_errors();
+    //Adds a named per-frame figure to the report's "counters_per_frame" (e.g. fragments shaded)
+    void add_counter(const std::string& name, double per_frame);
+    //Writes the report to options.report_path and to stdout; false if the run failed
+    bool finish(double setup_ms);
+
+  private:
+    Bench_Options options;
+    int width;
+    int height;
+    double frame_start_us = 0.0;
+    std::vector<float> frame_ms;
+    std::vector<std::string> captures;
+    std::vector<std::pair<std::string,double> > counters;
+    int gl_errors = 0;
+    //GL_State_Cache::stats summed over the measured frames
+    double program_switches = 0.0;
+    double texture_binds = 0.0;
+    double vao_binds = 0.0;
+    double framebuffer_binds = 0.0;
+};
+
+#endif //HEADLESS_BENCH_HPP
@@ -1,86 +1,333 @@
 #include "import_object.hpp"
 #include "build_shapes.hpp"
 #include <stdlib.h>
+#include <math.h>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <string.h>
+#include "mapped_file.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_cache.hpp"
+
+// Tokenizer helpers shared by the .OBJ and .MTL readers.  Mapped files are not
+// null-terminated, so every helper is bounded by an end pointer.
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char* find_line_end(const char* cur, const char* end) {
+    const char* lineEnd = (const char*)memchr(cur, '\n', end - cur);
+    return lineEnd != NULL ? lineEnd : end;
+}
+
+static const char* skip_spaces(const char* cur, const char* end) {
+    while (cur < end && is_space(*cur)) cur++;
+    return cur;
+}
+
+// True if the line starts with the keyword followed by whitespace (or the end of the line)
+static bool starts_with_token(const char* cur, const char* end, const char* keyword) {
+    size_t length = strlen(keyword);
+    if ((size_t)(end - cur) < length || memcmp(cur, keyword, length) != 0) return false;
+    return cur + length == end || is_space(cur[length]);
+}
+
+// Returns the rest of the line with surrounding whitespace trimmed (material names, texture paths)
+static void rest_of_line(const char* cur, const char* end, const char*& out, size_t& length) {
+    cur = skip_spaces(cur, end);
+    while (end > cur && is_space(end[-1])) end--;
+    out = cur;
+    length = end - cur;
+}
+
+// Decimal float parser (sign, digits, fraction, exponent).  Accumulates up to 19
+// significant digits in an integer and scales once, so it never allocates or
+// needs a terminating null like strtof does.
+static float parse_float(const char*& cur, const char* end) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    cur = skip_spaces(cur, end);
+    bool negative = false;
+    if (cur < end && (*cur == '-' || *cur == '+')) {
+        negative = (*cur == '-');
+        cur++;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    while (cur < end && is_digit(*cur)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*cur - '0');
+            if (mantissa != 0) digits++;
+        }
+        else exponent++;
+        cur++;
+    }
+    if (cur < end && *cur == '.') {
+        cur++;
+        while (cur < end && is_digit(*cur)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*cur - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            }
+            cur++;
+        }
+    }
+    if (cur < end && (*cur == 'e' || *cur == 'E')) {
+        cur++;
+        bool negativeExponent = false;
+        if (cur < end && (*cur == '-' || *cur == '+')) {
+            negativeExponent = (*cur == '-');
+            cur++;
+        }
+        int value = 0;
+        while (cur < end && is_digit(*cur)) {
+            if (value < 10000) value = value * 10 + (*cur - '0');
+            cur++;
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    double result = (double)mantissa;
+    while (exponent < -22) { result /= 1e22; exponent += 22; }
+    while (exponent > 22) { result *= 1e22; exponent -= 22; }
+    if (exponent < 0) result /= powers[-exponent];
+    else result *= powers[exponent];
+    return (float)(negative ? -result : result);
+}
+
+// Parses a face index.  Negative (relative) indices are resolved against the number
+// of elements read so far; a missing index maps to the placeholder at slot 0.
+static int parse_index(const char*& cur, const char* end, int count) {
+    bool negative = false;
+    if (cur < end && *cur == '-') {
+        negative = true;
+        cur++;
+    }
+    int value = 0;
+    while (cur < end && is_digit(*cur)) {
+        value = value * 10 + (*cur - '0');
+        cur++;
+    }
+    if (negative && value != 0) return count - value;
+    return value;
+}
+
+static glm::vec3 parse_vec3(const char* cur, const char* end) {
+    float x = parse_float(cur, end);
+    float y = parse_float(cur, end);
+    float z = parse_float(cur, end);
+    return glm::vec3(x, y, z);
+}
+
+static glm::vec2 parse_vec2(const char* cur, const char* end) {
+    // As parse_vec3, except only gets x and y
+    // Used primarily for vt coordinates
+    float x = parse_float(cur, end);
+    float y = parse_float(cur, end);
+    return glm::vec2(x, y);
+}
 
 
 ImportOBJ::ImportOBJ() {
 }
 
+ImportOBJ::~ImportOBJ() {
+    if (this->texture > 0) Texture_Cache::release(this->texture);
+}
+
 Shape_Struct ImportOBJ::loadFiles(std::string baseName) {
+    this->prepareFiles(baseName);
+    Shape_Struct shape_struct = this->uploadPrepared();
+    if (this->texture > 0) Texture_Cache::release(this->texture);
+    this->texture = -1;
+    if (!this->texturePath.empty()) {
+        this->texture = get_texture(this->texturePath);
+        std::cout<<this->texturePath<<" TEXTURE: "<<this->texture<<std::endl;
+    }
+
+    return shape_struct;
+}
+
+bool ImportOBJ::prepareFiles(std::string baseName) {
+    this->cache.close();
+    this->cacheOpen = this->useCache && this->openCache(baseName);
+    if (this->cacheOpen) return true;
+
+    bool parsed = this->parseFiles(baseName);
+    if (parsed && this->useCache) this->writeCache(baseName);
+    return parsed;
+}
+
+Shape_Struct ImportOBJ::uploadPrepared() {
+    if (!this->cacheOpen) return this->genShape_Struct();
+
+    const Mesh_Cache_Header& header = this->cache.header();
+    Shape_Struct shape_struct = this->genShape_Struct(this->cache.vertices(), header.num_vertices,
+                                                      this->cache.indices(), header.num_indices,
+                                                      header.index_bytes == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+    this->cache.close();
+    this->cacheOpen = false;
+    return shape_struct;
+}
+
+bool ImportOBJ::preparedFromCache() {
+    return this->cacheOpen;
+}
+
+bool ImportOBJ::writeCache(std::string baseName) {
+    Mesh_Source_Stamp stamp;
+    if (!get_mesh_source_stamp(baseName, stamp, true)) return false;
+    if (this->packVertices) {
+        return write_mesh_cache(mesh_cache_path(baseName, POMESH_LAYOUT_PACKED), stamp, POMESH_LAYOUT_PACKED,
+                                sizeof(PackedVertex), this->packedData.data(), this->packedData.size(), this->indices,
+                                this->matDiffuse, this->matSpecular, this->texturePath, &this->packParams);
+    }
+    return write_mesh_cache(mesh_cache_path(baseName), stamp, POMESH_LAYOUT_FLOAT, sizeof(CompleteVertex),
+                            this->combinedData.data(), this->combinedData.size(), this->indices,
+                            this->matDiffuse, this->matSpecular, this->texturePath);
+}
+
+/** Maps the .pomesh file if it is present and still matches the source .OBJ/.MTL files.
+  * The mapped vertex and index sections are later passed straight to glBufferData. */
+bool ImportOBJ::openCache(std::string baseName) {
+    uint32_t layout = this->packVertices ? POMESH_LAYOUT_PACKED : POMESH_LAYOUT_FLOAT;
+    uint32_t stride = this->packVertices ? sizeof(PackedVertex) : sizeof(CompleteVertex);
+    if (!this->cache.open(baseName, layout) || this->cache.header().vertex_stride != stride) {
+        this->cache.close();
+        return false;
+    }
+    this->reset();
+    const Mesh_Cache_Header& header = this->cache.header();
+    this->texturePath = this->cache.texture_path();
+    this->packParams = header.pack;
+    for (uint32_t i = 0; i < header.num_materials; i++) {
+        this->matDiffuse.push_back(this->cache.materials()[i * 2]);
+        this->matSpecular.push_back(this->cache.materials()[i * 2 + 1]);
+    }
+
+    if (debugOutput) {
+        std::cout << mesh_cache_path(baseName, layout) << " cache loaded.\n";
+        std::cout << header.num_vertices << " vertices, " << header.num_indices << " indices.\n";
+    }
+    return true;
+}
+
+bool ImportOBJ::parseFiles(std::string baseName) {
     this->reset();
     std::string matName = baseName + ".mtl";
     std::string objName = baseName + ".obj";
     this->readMTLFile(matName);
-    this->readOBJFile(objName);
-
-    return this->genShape_Struct();
+    if (!this->readOBJFile(objName)) return false;
+    if (this->packVertices) {
+        this->packData();
+        if (this->validatePacking) this->validatePackedData(baseName);
+    }
+    return true;
 }
 
 int ImportOBJ::getTexture() {
    return this->texture;
 }
 
+std::string ImportOBJ::getTexturePath() {
+    return this->texturePath;
+}
+
+const std::vector<ImportOBJ::CompleteVertex>& ImportOBJ::getCombinedData() {
+    return this->combinedData;
+}
+
 void ImportOBJ::readMTLFile(std::string fName) {
-    std::ifstream infile(fName.c_str());
-    if (infile.fail()) {
+    Mapped_File file;
+    if (!file.open(fName)) {
         std::cout << "ERROR: File " << fName << " does not exist.\n";
         return;
     }
 
-    std::string curLine;
+    const char* cur = file.data();
+    const char* end = cur + file.size();
     int matCount = 0;   // Index of next material to be added
 
-    while (std::getline(infile, curLine)) {
-        std::string linePrefix;
-        std::string curMatName;
-        std::istringstream iss(curLine, std::istringstream::in);
-        iss >> linePrefix;
-
+    while (cur < end) {
+        const char* lineEnd = find_line_end(cur, end);
+        cur = skip_spaces(cur, lineEnd);
 
-        if (linePrefix == "newmtl") {
-            curMatName = curLine.substr(7);
-            //std::cout << "Material: >>>" << curMatName << "<<< is mat " << matCount << "\n";
-            this->matAbbrev.insert(std::pair<std::string, int>(curMatName, matCount));
+        if (starts_with_token(cur, lineEnd, "newmtl")) {
+            const char* name;
+            size_t nameLength;
+            rest_of_line(cur + 6, lineEnd, name, nameLength);
+            this->matAbbrev.insert(std::pair<std::string, int>(std::string(name, nameLength), matCount));
             matCount += 1;
         }
 
         // Diffuse color
-        else if (linePrefix == "Kd") {
-            glm::vec3 color = getVec3(curLine);
-            this->matDiffuse.push_back(color);
-            //std::cout << "Kd is: " << curLine << "\n";
+        else if (starts_with_token(cur, lineEnd, "Kd")) {
+            this->matDiffuse.push_back(parse_vec3(cur + 2, lineEnd));
         }
 
         //Specular Color
-        else if (linePrefix == "Ks") {
-            glm::vec3 color = getVec3(curLine);
-            this->matSpecular.push_back(color);
+        else if (starts_with_token(cur, lineEnd, "Ks")) {
+            this->matSpecular.push_back(parse_vec3(cur + 2, lineEnd));
         }
 
-        //Texture
-        else if (linePrefix == "map_Kd") {
-            this->texture = get_texture(curLine.substr(7));
-            std::cout<<curLine.substr(7)<<" TEXTURE: "<<this->texture<<std::endl;
+        //Texture (loaded by loadFiles so that parsing never needs a GL context)
+        else if (starts_with_token(cur, lineEnd, "map_Kd")) {
+            const char* path;
+            size_t pathLength;
+            rest_of_line(cur + 6, lineEnd, path, pathLength);
+            this->texturePath.assign(path, pathLength);
         }
+
+        cur = lineEnd + 1;
     }
 }
 
 
-/** Loads .OBJ file into the ImportOBJ data structures */
-void ImportOBJ::readOBJFile(std::string fName) {
-    std::ifstream infile(fName.c_str());
-    if (infile.fail()) {
+/** Loads .OBJ file into the ImportOBJ data structures.
+  * The file is memory mapped and walked in place, so no per-line
+  * strings or streams are created. */
+bool ImportOBJ::readOBJFile(std::string fName) {
+    Mapped_File file;
+    if (!file.open(fName)) {
         std::cout << "ERROR: File " << fName << " does not exist.\n";
-        return;
+        return false;
     }
 
-    std::string curLine;
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    // Size the containers up front with a cheap prefix-only pass so
+    // the main pass never reallocates
+    size_t numVertices = 0, numNormals = 0, numTexCoords = 0, numCorners = 0;
+    for (const char* cur = begin; cur < end; ) {
+        const char* lineEnd = find_line_end(cur, end);
+        if (lineEnd - cur > 2 && cur[0] == 'v') {
+            if (cur[1] == ' ') numVertices++;
+            else if (cur[1] == 'n') numNormals++;
+            else if (cur[1] == 't') numTexCoords++;
+        }
+        else if (lineEnd - cur > 2 && cur[0] == 'f' && cur[1] == ' ') {
+            numCorners += 3;
+        }
+        cur = lineEnd + 1;
+    }
+    this->vertices.reserve(numVertices + 1);
+    this->normals.reserve(numNormals + 1);
+    this->textCoords.reserve(numTexCoords + 1);
+    this->indices.reserve(numCorners);
+    this->uniqueCorners.reserve(numCorners);
 
     // Push placeholder vec3s to our data structures
     // Allows index numbers to directly align with vertex# or
@@ -90,42 +337,40 @@ void ImportOBJ::readOBJFile(std::string fName) {
     this->textCoords.push_back(glm::vec2(-1.0, -1.0));
 
 
-    while (std::getline(infile, curLine)) {
+    for (const char* cur = begin; cur < end; ) {
         // .OBJ lines are prefixed to indicate what information they contain
-        // Designate an input string stream to capture it
-        std::string linePrefix;
-        std::istringstream iss(curLine, std::istringstream::in);
-        iss >> linePrefix;
-
-        // std::cout << "Reading file: " << linePrefix << " || " << curLine << "\n";
+        const char* lineEnd = find_line_end(cur, end);
+        cur = skip_spaces(cur, lineEnd);
 
         // Standard vertex coordinate
-        if (linePrefix == "v") {
-            this->vertices.push_back(this->getVec3(curLine));
+        if (starts_with_token(cur, lineEnd, "v")) {
+            this->vertices.push_back(parse_vec3(cur + 1, lineEnd));
         }
 
         // Vertex normal
-        else if (linePrefix == "vn") {
-            this->normals.push_back(this->getVec3(curLine));
+        else if (starts_with_token(cur, lineEnd, "vn")) {
+            this->normals.push_back(parse_vec3(cur + 2, lineEnd));
         }
 
         // Vertex texture
-        else if (linePrefix == "vt") {
-            this->textCoords.push_back(this->getVec2(curLine));
+        else if (starts_with_token(cur, lineEnd, "vt")) {
+            this->textCoords.push_back(parse_vec2(cur + 2, lineEnd));
         }
 
         // Changes the material being used
-        else if (linePrefix == "usemtl") {
-            std::string matName = curLine.substr(7);
-            //std::cout << "CHK rial: >>>" << matName << "<<< is " << this->matAbbrev.find(matName)->second << "\n";
-            this->curMat = this->matAbbrev.find(matName)->second;
-            //std::cout << "Now using material: " << matName << " is index " << this->curMat << this->matDiffuse.at(this->curMat).x << ", " << this->matDiffuse.at(this->curMat).y << ", " << this->matDiffuse.at(this->curMat).z << ")\n";
+        else if (starts_with_token(cur, lineEnd, "usemtl")) {
+            const char* name;
+            size_t nameLength;
+            rest_of_line(cur + 6, lineEnd, name, nameLength);
+            this->curMat = this->findMaterial(name, nameLength);
         }
 
         // Face
-        else if (linePrefix == "f") {
-            this->readLineFace(curLine);
+        else if (starts_with_token(cur, lineEnd, "f")) {
+            this->readFace(cur + 1, lineEnd);
         }
+
+        cur = lineEnd + 1;
     }
 
     if (debugOutput) {
@@ -137,16 +382,49 @@ void ImportOBJ::readOBJFile(std::string fName) {
         std::cout << matDiffuse.size() << " diffuse colors.\n";
         std::cout << matSpecular.size() << " specular colors.\n";
 
-        infile.close();
+        // Compare against uploading every face corner as its own vertex
+        size_t indexBytes = combinedData.size() <= 65536 ? sizeof(unsigned short) : sizeof(unsigned int);
+        size_t soupBytes = indices.size() * sizeof(CompleteVertex);
+        size_t indexedBytes = combinedData.size() * sizeof(CompleteVertex) + indices.size() * indexBytes;
+        double vertexReduction = indices.empty() ? 0.0 : 100.0 * (1.0 - (double)combinedData.size() / indices.size());
+        std::cout << indices.size() << " indices (" << indexBytes * 8 << "-bit), " << indices.size() << " -> "
+                  << combinedData.size() << " vertices (" << vertexReduction << "% fewer).\n";
+        std::cout << "VRAM: " << soupBytes << " bytes unindexed, " << indexedBytes << " bytes indexed ("
+                  << (long long)soupBytes - (long long)indexedBytes << " bytes saved).\n";
     }
+    this->uniqueCorners.clear();
+    return true;
 }
 
 int ImportOBJ::getNumCombined() {
     return this->combinedData.size();
 }
 
+int ImportOBJ::getNumIndices() {
+    return this->indices.size();
+}
+
+const std::vector<unsigned int>& ImportOBJ::getIndices() {
+    return this->indices;
+}
+
 /** Generates VAO from stored vertices and texture coordinates. */
 Shape_Struct ImportOBJ::genShape_Struct() {
+    const void* vertexData = this->packVertices ? (const void*)this->packedData.data() : (const void*)this->combinedData.data();
+    // Meshes that fit in 16-bit indices use half the index memory
+    if (this->combinedData.size() <= 65536) {
+        std::vector<unsigned short> shortIndices(this->indices.begin(), this->indices.end());
+        return this->genShape_Struct(vertexData, this->combinedData.size(),
+                                     shortIndices.data(), shortIndices.size(), GL_UNSIGNED_SHORT);
+    }
+    return this->genShape_Struct(vertexData, this->combinedData.size(),
+                                 this->indices.data(), this->indices.size(), GL_UNSIGNED_INT);
+}
+
+/** Generates VAO, VBO and EBO from raw CompleteVertex (or PackedVertex, if packVertices is set)
+  * and index data (either freshly parsed or mapped from a .pomesh cache). */
+Shape_Struct ImportOBJ::genShape_Struct(const void* vertexData, int numVertices,
+                                        const void* indexData, int numIndices, GLenum indexType) {
     Shape_Struct shape_struct;
 
     //unsigned int VBO, VAO;
@@ -156,13 +434,65 @@ Shape_Struct ImportOBJ::genShape_Struct() {
 
    shape_struct.clear_objs = true;
    shape_struct.EBO = 0;
-   shape_struct.num_indices = 0;
-   shape_struct.num_of_vertices = this->combinedData.size();
+   shape_struct.num_indices = numIndices;
+   shape_struct.num_of_vertices = numVertices;
    shape_struct.primitive = GL_TRIANGLES;
+   shape_struct.indexed = true;
+   shape_struct.index_type = indexType;
+
+    // Bounds for culling, from the same data the shader sees (packed positions decoded)
+    if (this->packVertices) {
+        const PackedVertex* packed = (const PackedVertex*)vertexData;
+        std::vector<glm::vec3> positions(numVertices);
+        for (int i = 0; i < numVertices; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                positions[i][axis] = this->packParams.pos_offset[axis] + packed[i].Position[axis] * this->packParams.pos_scale[axis];
+            }
+        }
+        compute_bounds(positions.data(), numVertices, sizeof(glm::vec3), 3, shape_struct.bounds, shape_struct.sphere);
+    }
+    else {
+        compute_bounds(vertexData, numVertices, sizeof(CompleteVertex), 3, shape_struct.bounds, shape_struct.sphere);
+    }
 
-    glBindVertexArray(shape_struct.VAO);
+    GL_State_Cache::bind_vertex_array(shape_struct.VAO);
     glBindBuffer(GL_ARRAY_BUFFER, shape_struct.VBO);
-    glBufferData(GL_ARRAY_BUFFER, this->combinedData.size() * sizeof(CompleteVertex), &this->combinedData[0], GL_STATIC_DRAW);
+    size_t vertexBytes = this->packVertices ? sizeof(PackedVertex) : sizeof(CompleteVertex);
+    glBufferData(GL_ARRAY_BUFFER, numVertices * vertexBytes, vertexData, GL_STATIC_DRAW);
+
+    // The EBO binding is recorded in the VAO, so upload it while the VAO is bound
+    size_t indexBytes = indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glGenBuffers(1, &(shape_struct.EBO));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shape_struct.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * indexBytes, indexData, GL_STATIC_DRAW);
+
+    if (this->packVertices) {
+        // The integers reach the shader unnormalized; pos_scale/uv_scale fold in the 1/32767 and
+        // 1/65535 so the result does not depend on the driver's snorm conversion rule.
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        glEnableVertexAttribArray(2);
+
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        glEnableVertexAttribArray(1);
+
+        glVertexAttribIPointer(5, 1, GL_UNSIGNED_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Material));
+        glEnableVertexAttribArray(5);
+
+        GL_State_Cache::bind_vertex_array(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
+
+        shape_struct.packed = true;
+        shape_struct.pos_offset = glm::vec3(this->packParams.pos_offset[0], this->packParams.pos_offset[1], this->packParams.pos_offset[2]);
+        shape_struct.pos_scale = glm::vec3(this->packParams.pos_scale[0], this->packParams.pos_scale[1], this->packParams.pos_scale[2]);
+        shape_struct.uv_offset = glm::vec2(this->packParams.uv_offset[0], this->packParams.uv_offset[1]);
+        shape_struct.uv_scale = glm::vec2(this->packParams.uv_scale[0], this->packParams.uv_scale[1]);
+        this->genMaterialBuffer(shape_struct);
+        return shape_struct;
+    }
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompleteVertex), (void*)0);
     glEnableVertexAttribArray(0);
@@ -179,8 +509,8 @@ Shape_Struct ImportOBJ::genShape_Struct() {
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(CompleteVertex), (void*)offsetof(CompleteVertex, sColor));
     glEnableVertexAttribArray(4);
 
+    GL_State_Cache::bind_vertex_array(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
 
     return shape_struct;
@@ -193,31 +523,77 @@ void ImportOBJ::reset() {
     this->normals.clear();
     this->textCoords.clear();
     this->combinedData.clear();
+    this->indices.clear();
+    this->combinedMaterial.clear();
+    this->packedData.clear();
+    memset(&this->packParams, 0, sizeof(this->packParams));
+    this->uniqueCorners.clear();
     this->matAbbrev.clear();
     this->matDiffuse.clear();
     this->matSpecular.clear();
+    this->texturePath.clear();
 }
 
-/** Only works with faces broken down into triangles */
-void ImportOBJ::readLineFace(std::string line) {
-    int firstVertexStart = 2;
-    int secondVertexStart = line.find(" ", firstVertexStart) + 1;
-    int thirdVertexStart = line.find(" ", secondVertexStart) + 1;
+/** Returns the index of the named material, or -1 if the .MTL file did not define it */
+int ImportOBJ::findMaterial(const char* name, size_t length) {
+    for (std::map<std::string, int>::iterator it = this->matAbbrev.begin(); it != this->matAbbrev.end(); ++it) {
+        if (it->first.size() == length && memcmp(it->first.data(), name, length) == 0) {
+            return it->second;
+        }
+    }
+    return -1;
+}
+
+// Given the rest of an "f" line in any of the formats
+// v  v/vt  v//vn  v/vt/vn  (one group per corner), emits triangles.
+// Polygons with more than three corners are split into a fan.
+void ImportOBJ::readFace(const char* cur, const char* end) {
+    int first[3] = {0, 0, 0};
+    int prev[3] = {0, 0, 0};
+    int numCorners = 0;
+
+    while (true) {
+        cur = skip_spaces(cur, end);
+        if (cur >= end) break;
+
+        int corner[3] = {0, 0, 0};
+        corner[0] = parse_index(cur, end, (int)this->vertices.size());
+        for (int i = 1; i < 3 && cur < end && *cur == '/'; i++) {
+            cur++;
+            corner[i] = parse_index(cur, end, i == 1 ? (int)this->textCoords.size() : (int)this->normals.size());
+        }
+        // Skip anything we did not understand so a malformed token cannot stall the loop
+        while (cur < end && !is_space(*cur)) cur++;
 
-    this->readFace(line.substr(firstVertexStart, secondVertexStart - 1));
-    this->readFace(line.substr(secondVertexStart, thirdVertexStart - 1));
-    this->readFace(line.substr(thirdVertexStart));
+        if (numCorners == 0) {
+            memcpy(first, corner, sizeof(first));
+        }
+        else if (numCorners >= 2) {
+            this->pushCorner(first[0], first[1], first[2]);
+            this->pushCorner(prev[0], prev[1], prev[2]);
+            this->pushCorner(corner[0], corner[1], corner[2]);
+        }
+        memcpy(prev, corner, sizeof(prev));
+        numCorners++;
+    }
 }
 
-// Given a string in the format:
-// xx/yy/zz returns a ivec3 of (xx, yy, zz)
-void ImportOBJ::readFace(std::string lineSegment) {
-    int indexY = lineSegment.find("/", 0) + 1;
-    int indexZ = lineSegment.find("/", indexY) + 1;
+size_t ImportOBJ::CornerHash::operator()(const CornerKey& key) const {
+    size_t hash = (size_t)key.v * 73856093u;
+    hash ^= (size_t)key.vt * 19349663u;
+    hash ^= (size_t)key.vn * 83492791u;
+    hash ^= (size_t)(key.mat + 1) * 2654435761u;
+    return hash;
+}
 
-    int x = strtol(lineSegment.substr(0, indexY - 1).c_str(), NULL, 10);
-    int y = strtol(lineSegment.substr(indexY, indexZ - 1).c_str(), NULL, 10);
-    int z = strtol(lineSegment.substr(indexZ).c_str(), NULL, 10);
+// Appends the index of the vertex described by the (position, texture, normal)
+// indices, adding the vertex only the first time that corner is seen
+void ImportOBJ::pushCorner(int x, int y, int z) {
+    CornerKey key = {x, y, z, this->curMat};
+    std::pair<std::unordered_map<CornerKey, unsigned int, CornerHash>::iterator, bool> found =
+        this->uniqueCorners.insert(std::make_pair(key, (unsigned int)this->combinedData.size()));
+    this->indices.push_back(found.first->second);
+    if (!found.second) return;
 
     CompleteVertex newVert;
     newVert.Position = this->vertices.at(x);
@@ -228,37 +604,187 @@ void ImportOBJ::readFace(std::string lineSegment) {
     if (this->curMat == -1) newVert.Color = glm::vec3(1.0, 1.0, 1.0);
 
     this->combinedData.push_back(newVert);
+    this->combinedMaterial.push_back(this->curMat);
 }
 
-glm::vec3 ImportOBJ::getVec3(std::string line) {
-    // Line format, where _ is a space and XX designates the info on the line
-    // mtllib = file name for materials
-    // v = vertex coordinate
-    // vn = vertex normal
-    // vt = vertex texture coordinate
-    // <x>, <y>, <z> are the x, y, and z coordinates
+const std::vector<ImportOBJ::PackedVertex>& ImportOBJ::getPackedData() {
+    return this->packedData;
+}
 
-    // XX_<x>_<y>_<z>
+Mesh_Pack_Params ImportOBJ::getPackParams() {
+    return this->packParams;
+}
 
-    // Finds index of start of x, y, and z coordinates
-    int indexX = line.find(" ", 0) + 1;
-    int indexY = line.find(" ", indexX) + 1;
-    int indexZ = line.find(" ", indexY) + 1;
-    float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
-    float y = strtof(line.substr(indexY, indexZ-1).c_str(), NULL);
-    float z = strtof(line.substr(indexZ).c_str(), NULL);
-    return glm::vec3(x, y, z);
+static float sign_not_zero(float value) {
+    return value < 0.0f ? -1.0f : 1.0f;
 }
 
-glm::vec2 ImportOBJ::getVec2(std::string line) {
-    // As getVec3, except only gets x and y
-    // Used primarily for vt coordinates
-    int indexX = line.find(" ", 0) + 1;
-    int indexY = line.find(" ", indexX) + 1;
-    float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
-    float y = strtof(line.substr(indexY).c_str(), NULL);
-    return glm::vec2(x, y);
+// Maps a unit vector onto the octahedron |x|+|y|+|z| = 1 and unfolds the lower half
+// into the corners of the [-1,1] square, giving two snorm16 components.
+static void oct_encode(glm::vec3 n, short out[2]) {
+    float length = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+    if (length == 0.0f) {
+        out[0] = 0;
+        out[1] = 0;
+        return;
+    }
+    float x = n.x / length;
+    float y = n.y / length;
+    if (n.z < 0.0f) {
+        float foldedX = (1.0f - fabsf(y)) * sign_not_zero(x);
+        float foldedY = (1.0f - fabsf(x)) * sign_not_zero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = (short)lroundf(fminf(fmaxf(x, -1.0f), 1.0f) * 32767.0f);
+    out[1] = (short)lroundf(fminf(fmaxf(y, -1.0f), 1.0f) * 32767.0f);
 }
 
+// Inverse of oct_encode (mirrors oct_decode in importVertexShader.glsl)
+static glm::vec3 oct_decode(const short in[2]) {
+    float x = in[0] / 32767.0f;
+    float y = in[1] / 32767.0f;
+    glm::vec3 n(x, y, 1.0f - fabsf(x) - fabsf(y));
+    if (n.z < 0.0f) {
+        n.x = (1.0f - fabsf(y)) * sign_not_zero(x);
+        n.y = (1.0f - fabsf(x)) * sign_not_zero(y);
+    }
+    float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+    return glm::vec3(n.x / length, n.y / length, n.z / length);
+}
 
+// Quantizes value (inside [offset - range, offset + range]) to a signed 16-bit integer
+static short quantize_snorm(float value, float offset, float range) {
+    if (range <= 0.0f) return 0;
+    float unit = fminf(fmaxf((value - offset) / range, -1.0f), 1.0f);
+    return (short)lroundf(unit * 32767.0f);
+}
+
+// Quantizes value (inside [offset, offset + range]) to an unsigned 16-bit integer
+static unsigned short quantize_unorm(float value, float offset, float range) {
+    if (range <= 0.0f) return 0;
+    float unit = fminf(fmaxf((value - offset) / range, 0.0f), 1.0f);
+    return (unsigned short)lroundf(unit * 65535.0f);
+}
 
+/** Builds packedData and packParams from combinedData.  Positions are stored relative to the
+  * mesh bounding box and UVs relative to the mesh UV range, so both use the full 16 bits. */
+void ImportOBJ::packData() {
+    this->packedData.clear();
+    memset(&this->packParams, 0, sizeof(this->packParams));
+    if (this->combinedData.empty()) return;
+
+    glm::vec3 minPos = this->combinedData[0].Position;
+    glm::vec3 maxPos = minPos;
+    glm::vec2 minUV = this->combinedData[0].TexCoords;
+    glm::vec2 maxUV = minUV;
+    for (size_t i = 1; i < this->combinedData.size(); i++) {
+        const CompleteVertex& v = this->combinedData[i];
+        for (int axis = 0; axis < 3; axis++) {
+            minPos[axis] = fminf(minPos[axis], v.Position[axis]);
+            maxPos[axis] = fmaxf(maxPos[axis], v.Position[axis]);
+        }
+        for (int axis = 0; axis < 2; axis++) {
+            minUV[axis] = fminf(minUV[axis], v.TexCoords[axis]);
+            maxUV[axis] = fmaxf(maxUV[axis], v.TexCoords[axis]);
+        }
+    }
+
+    float center[3], halfExtent[3], uvRange[2];
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = 0.5f * (minPos[axis] + maxPos[axis]);
+        halfExtent[axis] = 0.5f * (maxPos[axis] - minPos[axis]);
+        this->packParams.pos_offset[axis] = center[axis];
+        this->packParams.pos_scale[axis] = halfExtent[axis] / 32767.0f;
+    }
+    for (int axis = 0; axis < 2; axis++) {
+        uvRange[axis] = maxUV[axis] - minUV[axis];
+        this->packParams.uv_offset[axis] = minUV[axis];
+        this->packParams.uv_scale[axis] = uvRange[axis] / 65535.0f;
+    }
+
+    this->packedData.resize(this->combinedData.size());
+    for (size_t i = 0; i < this->combinedData.size(); i++) {
+        const CompleteVertex& v = this->combinedData[i];
+        PackedVertex& packed = this->packedData[i];
+        for (int axis = 0; axis < 3; axis++) {
+            packed.Position[axis] = quantize_snorm(v.Position[axis], center[axis], halfExtent[axis]);
+        }
+        for (int axis = 0; axis < 2; axis++) {
+            packed.TexCoords[axis] = quantize_unorm(v.TexCoords[axis], minUV[axis], uvRange[axis]);
+        }
+        oct_encode(v.Normal, packed.Normal);
+        int mat = this->combinedMaterial[i];
+        packed.Material = mat < 0 ? 0xFFFF : (unsigned short)mat;
+    }
+}
+
+/** Decodes packedData the way importVertexShader.glsl does and reports the largest
+  * difference from the float vertices for each attribute. */
+void ImportOBJ::validatePackedData(std::string baseName) {
+    const Mesh_Pack_Params& p = this->packParams;
+    float maxPosError = 0.0f, maxUVError = 0.0f, maxNormalError = 0.0f, maxExtent = 0.0f;
+    int colorMismatches = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        maxExtent = fmaxf(maxExtent, 2.0f * p.pos_scale[axis] * 32767.0f);
+    }
+
+    for (size_t i = 0; i < this->packedData.size(); i++) {
+        const CompleteVertex& v = this->combinedData[i];
+        const PackedVertex& packed = this->packedData[i];
+        for (int axis = 0; axis < 3; axis++) {
+            float decoded = p.pos_offset[axis] + packed.Position[axis] * p.pos_scale[axis];
+            maxPosError = fmaxf(maxPosError, fabsf(decoded - v.Position[axis]));
+        }
+        for (int axis = 0; axis < 2; axis++) {
+            float decoded = p.uv_offset[axis] + packed.TexCoords[axis] * p.uv_scale[axis];
+            maxUVError = fmaxf(maxUVError, fabsf(decoded - v.TexCoords[axis]));
+        }
+        float length = sqrtf(v.Normal.x * v.Normal.x + v.Normal.y * v.Normal.y + v.Normal.z * v.Normal.z);
+        if (length > 0.0f) {
+            glm::vec3 decoded = oct_decode(packed.Normal);
+            float cosine = (decoded.x * v.Normal.x + decoded.y * v.Normal.y + decoded.z * v.Normal.z) / length;
+            maxNormalError = fmaxf(maxNormalError, acosf(fminf(fmaxf(cosine, -1.0f), 1.0f)) * 57.29578f);
+        }
+        // Vertices without a material only define Color (white) in the float path
+        glm::vec3 color = glm::vec3(1.0, 1.0, 1.0);
+        if (packed.Material != 0xFFFF) {
+            color = this->matDiffuse.at(packed.Material);
+            if (this->matSpecular.at(packed.Material) != v.sColor) colorMismatches++;
+        }
+        if (color != v.Color) colorMismatches++;
+    }
+
+    size_t floatBytes = this->combinedData.size() * sizeof(CompleteVertex);
+    size_t packedBytes = this->packedData.size() * sizeof(PackedVertex);
+    std::cout << baseName << " packed: " << this->packedData.size() << " vertices, " << floatBytes << " -> "
+              << packedBytes << " bytes (" << (packedBytes ? (double)floatBytes / packedBytes : 0.0) << "x less vertex bandwidth).\n";
+    std::cout << "  max position error " << maxPosError << " (" << (maxExtent > 0.0f ? 100.0f * maxPosError / maxExtent : 0.0f)
+              << "% of the bounding box), max normal error " << maxNormalError << " degrees, max UV error "
+              << maxUVError << ", " << colorMismatches << " material color mismatches.\n";
+}
+
+/** Uploads the Kd/Ks table (two RGBA32F texels per material) into a texture buffer that
+  * the packed vertex shader indexes with the per-vertex material index */
+void ImportOBJ::genMaterialBuffer(Shape_Struct& shape_struct) {
+    size_t numMaterials = this->matDiffuse.size() < this->matSpecular.size() ? this->matDiffuse.size() : this->matSpecular.size();
+    if (numMaterials == 0) return;
+
+    std::vector<float> texels;
+    texels.reserve(numMaterials * 8);
+    for (size_t i = 0; i < numMaterials; i++) {
+        const glm::vec3& kd = this->matDiffuse[i];
+        const glm::vec3& ks = this->matSpecular[i];
+        float material[8] = {kd.x, kd.y, kd.z, 1.0f, ks.x, ks.y, ks.z, 1.0f};
+        texels.insert(texels.end(), material, material + 8);
+    }
+
+    glGenBuffers(1, &(shape_struct.material_buffer));
+    glBindBuffer(GL_TEXTURE_BUFFER, shape_struct.material_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(float), texels.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &(shape_struct.material_texture));
+    GL_State_Cache::bind_texture(0, GL_TEXTURE_BUFFER, shape_struct.material_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, shape_struct.material_buffer);
+    GL_State_Cache::bind_texture(0, GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
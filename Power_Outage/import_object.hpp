@@ -4,8 +4,10 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include "shape.hpp"
+#include "mesh_cache.hpp"
 
 
 
@@ -13,45 +15,125 @@
 class ImportOBJ{
     public:
         ImportOBJ();
+        /** Releases the texture loadFiles acquired */
+        ~ImportOBJ();
+
+        struct CompleteVertex {
+            glm::vec3 Position;
+            glm::vec3 Normal;
+            glm::vec2 TexCoords;
+            glm::vec3 Color;
+            glm::vec3 sColor;
+        };
+
+        // Compact 16-byte alternative to CompleteVertex (56 bytes), used when packVertices is set.
+        // The integers are dequantized in importVertexShader.glsl with the mesh's Mesh_Pack_Params.
+        struct PackedVertex {
+            short Position[3];            // snorm16 inside the mesh bounding box
+            unsigned short Material;      // Kd/Ks index into the material buffer (0xFFFF for none)
+            short Normal[2];              // octahedral-encoded unit normal
+            unsigned short TexCoords[2];  // unorm16 inside the mesh UV range
+        };
 
         /** Returns a new Shape object after loading the .OBJ/.MTL files
           * Only provide the base name (without .OBJ/.MTL extension) */
         Shape_Struct loadFiles(std::string name_without_file_extension);
-        bool debugOutput = true;
 
+        /** Parses the .OBJ/.MTL files into the combined vertex stream without
+          * touching OpenGL (no texture load, no buffer upload).
+          * Returns false if the .OBJ file could not be opened. */
+        bool parseFiles(std::string name_without_file_extension);
+
+        /** CPU half of loadFiles: maps a fresh .pomesh cache, or parses the .OBJ/.MTL files
+          * (and rewrites the cache).  Makes no OpenGL calls, so it may run on a worker thread.
+          * Returns false if the .OBJ file could not be opened. */
+        bool prepareFiles(std::string name_without_file_extension);
+
+        /** GL half of loadFiles: uploads the mesh from the last prepareFiles call.
+          * Must run on the thread that owns the OpenGL context.  Does not load the texture. */
+        Shape_Struct uploadPrepared();
+
+        /** True if the last prepareFiles call was served from a .pomesh cache */
+        bool preparedFromCache();
+
+        /** Writes the parsed mesh to a binary cache (<base name>.pomesh) next to the model.
+          * Call after parseFiles. */
+        bool writeCache(std::string name_without_file_extension);
+
+        bool debugOutput = true;
+        //If true, loadFiles uploads straight from a fresh .pomesh cache when one exists
+        //and (re)writes the cache after parsing otherwise.
+        bool useCache = true;
+        //If true, meshes are stored and uploaded as PackedVertex (see Shape_Struct::packed)
+        bool packVertices = false;
+        //If true, every freshly packed mesh is decoded on the CPU exactly as the shader would
+        //and diffed against the float vertices; the largest errors are printed.
+        bool validatePacking = false;
+
+        //Number of unique vertices (after deduplication)
         int getNumCombined();
+        //Number of indices (three per triangle)
+        int getNumIndices();
         int getTexture();
+        std::string getTexturePath();
+        const std::vector<CompleteVertex>& getCombinedData();
+        const std::vector<unsigned int>& getIndices();
+        const std::vector<PackedVertex>& getPackedData();
+        Mesh_Pack_Params getPackParams();
 
     private:
-        struct CompleteVertex {
-            glm::vec3 Position;
-            glm::vec3 Normal;
-            glm::vec2 TexCoords;
-            glm::vec3 Color;
-            glm::vec3 sColor;
-        };
+        // Copies would release the same texture twice
+        ImportOBJ(const ImportOBJ&);
+        ImportOBJ& operator=(const ImportOBJ&);
 
         void readMTLFile(std::string fName);
-        void readOBJFile(std::string fName);
+        bool readOBJFile(std::string fName);
         Shape_Struct genShape_Struct();
+        Shape_Struct genShape_Struct(const void* vertexData, int numVertices,
+                                     const void* indexData, int numIndices, GLenum indexType);
+        bool openCache(std::string baseName);
+        void packData();
+        void validatePackedData(std::string baseName);
+        void genMaterialBuffer(Shape_Struct& shape_struct);
         void reset();
 
         int curMat = -1;
         int texture = -1;
+        std::string texturePath;
+        // Mapped by prepareFiles when a fresh cache exists, released by uploadPrepared
+        Mesh_Cache_File cache;
+        bool cacheOpen = false;
 
 
         std::vector<glm::vec3> vertices;
         std::vector<glm::vec3> normals;
         std::vector<glm::vec2> textCoords;
         std::vector<CompleteVertex> combinedData;
+        std::vector<unsigned int> indices;
+        // Material of each combinedData entry (-1 for none), used for packing
+        std::vector<int> combinedMaterial;
+        std::vector<PackedVertex> packedData;
+        Mesh_Pack_Params packParams;
         std::map<std::string, int> matAbbrev;
         std::vector<glm::vec3> matDiffuse;
         std::vector<glm::vec3> matSpecular;
 
-        void readLineFace(std::string line);
-        void readFace(std::string lineSegment);
-        glm::vec3 getVec3(std::string line);
-        glm::vec2 getVec2(std::string line);
+        // A face corner: (position, texture, normal, material) indices.
+        // Corners with equal keys share one entry in combinedData.
+        struct CornerKey {
+            int v, vt, vn, mat;
+            bool operator==(const CornerKey& other) const {
+                return v == other.v && vt == other.vt && vn == other.vn && mat == other.mat;
+            }
+        };
+        struct CornerHash {
+            size_t operator()(const CornerKey& key) const;
+        };
+        std::unordered_map<CornerKey, unsigned int, CornerHash> uniqueCorners;
+
+        int findMaterial(const char* name, size_t length);
+        void readFace(const char* cur, const char* end);
+        void pushCorner(int v, int vt, int vn);
 };
 
 
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <string.h>
+#include "input_replay.hpp"
+
+//Every key the game reads (World, Text_Display, Post_Processor, the door, key and plate)
+static const int GAME_KEYS[] = {
+    GLFW_KEY_ESCAPE, GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_TAB,
+    GLFW_KEY_LEFT_SHIFT, GLFW_KEY_R, GLFW_KEY_F, GLFW_KEY_P, GLFW_KEY_E, GLFW_KEY_C,
+    GLFW_KEY_SPACE, GLFW_KEY_F3, GLFW_KEY_F4, GLFW_KEY_1, GLFW_KEY_2, GLFW_KEY_3,
+    GLFW_KEY_4, GLFW_KEY_5, GLFW_KEY_6, GLFW_KEY_7
+};
+static_assert(sizeof(Input_Frame) == 16, "Input_Frame is written to recordings as is");
+static const char INPUT_REPLAY_MAGIC[4] = {'P','O','I','N'};
+
+Input_Mode Input_Replay::mode = INPUT_LIVE;
+std::ofstream Input_Replay::record_file;
+std::vector<Input_Frame> Input_Replay::frames;
+std::vector<int> Input_Replay::recorded_keys;
+Input_Start Input_Replay::start;
+int Input_Replay::frame_index = 0;
+uint32_t Input_Replay::keys = 0;
+glm::vec2 Input_Replay::pending_mouse = glm::vec2(0.0f);
+
+bool Input_Replay::start_recording(const std::string& path, Input_Start start) {
+    stop();
+    record_file.open(path.c_str(),std::ios::binary);
+    if (!record_file.is_open()) {
+        std::cout << "ERROR: could not write input recording " << path << std::endl;
+        return false;
+    }
+    recorded_keys.assign(GAME_KEYS,GAME_KEYS + sizeof(GAME_KEYS)/sizeof(GAME_KEYS[0]));
+    uint32_t version = INPUT_REPLAY_VERSION;
+    uint32_t num_keys = recorded_keys.size();
+    record_file.write(INPUT_REPLAY_MAGIC,4);
+    record_file.write((const char*)&version,sizeof(version));
+    record_file.write((const char*)&num_keys,sizeof(num_keys));
+    for (size_t i = 0; i < recorded_keys.size(); i++) {
+        int32_t key = recorded_keys[i];
+        record_file.write((const char*)&key,sizeof(key));
+    }
+    float camera[5] = {start.position.x,start.position.y,start.position.z,start.yaw,start.pitch};
+    record_file.write((const char*)camera,sizeof(camera));
+    Input_Replay::start = start;
+    frame_index = 0;
+    mode = INPUT_RECORD;
+    return true;
+}
+
+bool Input_Replay::start_playback(const std::string& path) {
+    stop();
+    std::ifstream file(path.c_str(),std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR: could not open input recording " << path << std::endl;
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0, num_keys = 0;
+    file.read(magic,4);
+    file.read((char*)&version,sizeof(version));
+    file.read((char*)&num_keys,sizeof(num_keys));
+    if (!file || memcmp(magic,INPUT_REPLAY_MAGIC,4) != 0 || version != INPUT_REPLAY_VERSION || num_keys > 32) {
+        std::cout << "ERROR: " << path << " is not a version " << INPUT_REPLAY_VERSION << " input recording" << std::endl;
+        return false;
+    }
+    recorded_keys.clear();
+    for (uint32_t i = 0; i < num_keys; i++) {
+        int32_t key = 0;
+        file.read((char*)&key,sizeof(key));
+        recorded_keys.push_back(key);
+    }
+    float camera[5];
+    file.read((char*)camera,sizeof(camera));
+    if (!file) {
+        std::cout << "ERROR: input recording " << path << " is cut short" << std::endl;
+        return false;
+    }
+    start.position = glm::vec3(camera[0],camera[1],camera[2]);
+    start.yaw = camera[3];
+    start.pitch = camera[4];
+
+    frames.clear();
+    Input_Frame frame;
+    //A frame cut off by a crash while recording is dropped
+    while (file.read((char*)&frame,sizeof(frame))) frames.push_back(frame);
+    frame_index = 0;
+    keys = 0;
+    mode = INPUT_PLAYBACK;
+    return true;
+}
+
+void Input_Replay::stop() {
+    if (record_file.is_open()) record_file.close();
+    mode = INPUT_LIVE;
+    keys = 0;
+}
+
+Input_Mode Input_Replay::get_mode() {
+    return mode;
+}
+
+Input_Start Input_Replay::get_start() {
+    return start;
+}
+
+bool Input_Replay::begin_frame(GLFWwindow* win, float measured_delta, Input_Frame& frame) {
+    if (mode == INPUT_PLAYBACK) {
+        //The recording is the only input while it plays
+        pending_mouse = glm::vec2(0.0f);
+        if (frame_index >= (int)frames.size()) return false;
+        frame = frames[frame_index++];
+        keys = frame.keys;
+        return true;
+    }
+
+    frame.delta_time = measured_delta;
+    frame.mouse_x = pending_mouse.x;
+    frame.mouse_y = pending_mouse.y;
+    frame.keys = 0;
+    pending_mouse = glm::vec2(0.0f);
+    if (mode == INPUT_RECORD) {
+        //Sample every key once, so the frame uses exactly what is written
+        for (size_t i = 0; i < recorded_keys.size(); i++) {
+            if (glfwGetKey(win,recorded_keys[i]) == GLFW_PRESS) frame.keys |= 1u << i;
+        }
+        keys = frame.keys;
+        record_file.write((const char*)&frame,sizeof(frame));
+        frame_index++;
+    }
+    return true;
+}
+
+int Input_Replay::key_bit(int key) {
+    for (size_t i = 0; i < recorded_keys.size(); i++) {
+        if (recorded_keys[i] == key) return i;
+    }
+    return -1;
+}
+
+int Input_Replay::get_key(GLFWwindow* win, int key) {
+    if (mode == INPUT_LIVE) return glfwGetKey(win,key);
+    int bit = key_bit(key);
+    if (bit < 0) return GLFW_RELEASE;
+    return (keys >> bit) & 1 ? GLFW_PRESS : GLFW_RELEASE;
+}
+
+void Input_Replay::add_mouse_movement(float x, float y) {
+    pending_mouse.x += x;
+    pending_mouse.y += y;
+}
+
+int Input_Replay::get_frame_index() {
+    return frame_index;
+}
+
+int Input_Replay::get_frame_count() {
+    return mode == INPUT_PLAYBACK ? (int)frames.size() : frame_index;
+}
@@ -0,0 +1,84 @@
+#ifndef INPUT_REPLAY_HPP
+#define INPUT_REPLAY_HPP
+
+#include <glad/glad.h> //GLAD must be BEFORE GLFW
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//Recording file: "POIN", version, the key codes the bits of Input_Frame::keys stand for, the
+//camera the recording started from, then one Input_Frame per frame until the end of the file.
+#define INPUT_REPLAY_VERSION 1
+
+enum Input_Mode {
+    INPUT_LIVE,      //keys and mouse come straight from GLFW
+    INPUT_RECORD,    //live, and every frame's input is written to a file
+    INPUT_PLAYBACK   //keys, mouse and frame times come from a recording
+};
+
+//Everything the game reads from the player during one frame (16 bytes in the file)
+struct Input_Frame {
+    float delta_time = 0.0f;
+    //Mouse movement since the previous frame, as mouse_callback measures it
+    float mouse_x = 0.0f;
+    float mouse_y = 0.0f;
+    //Bit i is set while the i-th recorded key is held
+    uint32_t keys = 0;
+};
+
+//Where the camera was when a recording started
+struct Input_Start {
+    glm::vec3 position = glm::vec3(0.0f);
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+};
+
+//Records the player's input frame by frame and plays it back, so that a run can be repeated
+//exactly: every key the game reads goes through get_key(), mouse movement goes through
+//add_mouse_movement() and is applied once per frame, and during playback the frame times are
+//the recorded ones instead of the clock's.  The game's state only depends on those, so the
+//camera, door, key and plate do what they did in the recorded run regardless of frame rate.
+class Input_Replay {
+    public:
+        //Start writing every frame's input to path (false if it cannot be written)
+        static bool start_recording(const std::string& path, Input_Start start);
+        //Load a recording and play it from its first frame (false if it cannot be read)
+        static bool start_playback(const std::string& path);
+        //Back to live input (closes a recording)
+        static void stop();
+        static Input_Mode get_mode();
+        //Where the loaded recording started (set the camera there before playing)
+        static Input_Start get_start();
+
+        //Call once at the start of each frame with the measured frame time.  Fills in this
+        //frame's delta time and mouse movement: the live ones (recorded when recording) or the
+        //next recorded ones.  Returns false once playback has run out of frames.
+        static bool begin_frame(GLFWwindow* win, float measured_delta, Input_Frame& frame);
+        //glfwGetKey for this frame.  While recording or playing only the keys the game uses
+        //are known; anything else reads as released.
+        static int get_key(GLFWwindow* win, int key);
+        //Called from the cursor callback with the movement since the last call
+        static void add_mouse_movement(float x, float y);
+
+        //Frames played (or recorded) so far and frames in the loaded recording
+        static int get_frame_index();
+        static int get_frame_count();
+
+    private:
+        static int key_bit(int key);
+
+        static Input_Mode mode;
+        static std::ofstream record_file;
+        static std::vector<Input_Frame> frames;
+        //Key code of each bit in the loaded recording's frames
+        static std::vector<int> recorded_keys;
+        static Input_Start start;
+        static int frame_index;
+        static uint32_t keys;
+        static glm::vec2 pending_mouse;
+};
+
+#endif //INPUT_REPLAY_HPP
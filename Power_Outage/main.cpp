@@ -6,19 +6,36 @@
 #include "camera.hpp"
 #include "Font.hpp"
 #include "import_object.hpp"
+#include "asset_loader.hpp"
 #include <map>
 #include "world_state.hpp"
+#include "render_queue.hpp"
 #include "post_processor.hpp"
 #include "text_display.hpp"
 #include "skybox.hpp"
 #include "moving_door.hpp"
 #include "moving_plate.hpp"
 #include "moving_key.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_cache.hpp"
+#include "texture_streamer.hpp"
+#include "texture_atlas.hpp"
+#include "profiler.hpp"
+#include "input_replay.hpp"
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+#ifdef POWER_OUTAGE_BENCH
+#include <chrono>
+#include "camera_path.hpp"
+#include "headless_bench.hpp"
+#endif
 
 //Constants
 #define WIN_WIDTH 960
 #define WIN_HEIGHT 720
 #define FPS 60.0
+#define UNIFORM_STATS_SECONDS 0.0 //how often to print the per-frame uniform counters (0 = only once)
 
 //Create the world state object
 World world(WIN_WIDTH,WIN_HEIGHT);
@@ -46,13 +63,24 @@ Camera camera(glm::vec3(20.0f,-3.0f,0.0f),glm::vec3(0.0f,1.0f,0.0f),180.0f, 0.0f
 //Function Prototypes
 void mouse_callback (GLFWwindow* win, double xpos, double ypos);
 void enforceFrameRate(double last_frame_time); //fights rendering lag
-
-int main() {
+bool same_mesh(const Shape_Struct& a, const Shape_Struct& b); //true if two models have the same geometry
+
+int main(int argc, char** argv) {
+#ifdef POWER_OUTAGE_BENCH
+  //Headless benchmark: no window, the frames go to an offscreen surface (see headless_bench.hpp)
+  Bench_Options bench_options;
+  if (!parse_bench_options(argc,argv,bench_options)) return 2;
+  std::chrono::steady_clock::time_point setup_start = std::chrono::steady_clock::now();
+  if (!initialize_headless_environment(WIN_WIDTH,WIN_HEIGHT)) {
+    return -1; //error msg already printed to screen.
+  }
+#else
   //Initialize the environment
   GLFWwindow* window = initialize_environment(WIN_WIDTH,WIN_HEIGHT,"Power Outage");
   if (window == NULL) {
     return -1; //error msg already printed to screen.
   }
+#endif
 
   //Initialize world camera
   world.camera = &camera;
@@ -64,22 +92,73 @@ int main() {
   //The font must be initialized -after- the environment.
   arialFont.initialize();
 
-  //Import objects
-  ImportOBJ new_importer;
+  //Import objects: every .OBJ/.MTL parse runs on worker threads, then load_all() uploads the
+  //meshes here on the context thread.  The models' textures are packed into one texture atlas,
+  //so their draws never rebind a texture; the other textures stream in over the first frames
+  //instead (they draw a gray placeholder until then).  Both are deleted before the context goes away.
+  Texture_Streamer* texture_streamer = new Texture_Streamer();
+  Texture_Atlas* texture_atlas = new Texture_Atlas();
+  Asset_Loader loader;
+  loader.streamer = texture_streamer;
+  loader.atlas = texture_atlas;
+  //Extra buildings filling the city, and whether they are drawn instanced (the bench's --city
+  //and --instancing options; the game itself only has the four)
+  int city_buildings = 0;
+  bool instanced_buildings = true;
+#ifdef POWER_OUTAGE_BENCH
+  //--atlas 0 measures the separate textures instead
+  if (!bench_options.texture_atlas) loader.atlas = NULL;
+  city_buildings = bench_options.city_buildings;
+  instanced_buildings = bench_options.instancing;
+#endif
+  int officeFloor_id = loader.add_model("models/office/floor");
+  int walls_id = loader.add_model("models/office/walls");
+  //The two largest meshes use the compact packed vertex layout
+  int furniture_id = loader.add_model("models/office/furniture",true);
+  //The four portals share their geometry and only differ in the color of their first
+  //material, so one packed model is drawn instanced with color overrides
+  int portal_id = loader.add_model("models/portals/portal1",true);
+  //The four buildings.  Not every checkout has their models; a missing one is neither drawn
+  //nor collided with.
+  std::string building_models[4] = {"models/buildings/building1","models/buildings/building2",
+                                    "models/buildings/building3","models/buildings/building4"};
+  int building_ids[4];
+  for (int i = 0; i < 4; i++) {
+    building_ids[i] = -1;
+    if (std::ifstream((building_models[i] + ".obj").c_str()).good()) building_ids[i] = loader.add_model(building_models[i],true);
+  }
+  //The city's extra buildings repeat building1
+  int city_id = building_ids[0];
+#ifdef POWER_OUTAGE_BENCH
+  //The bench needs some geometry to measure the city with; a portal stands in for a missing
+  //building1 (loaded again, since the instances live in the VAO)
+  if (city_id < 0 && city_buildings > 0) city_id = loader.add_model("models/portals/portal1",true);
+#endif
+  int keyhole_id = loader.add_model("models/keyhole");
+  int lamppost_id = loader.add_model("models/lamppost",true);
+  int pressurePlate_id = loader.add_model("models/pressurePlate");
+  int door_id = loader.add_model("models/door");
+  int key_id = loader.add_model("models/key");
+  int bricks_id = loader.add_texture("images/bricks.jpg");
+  loader.load_all();
+  loader.print_timings();
+  Texture_Cache::print_report();
+  if (loader.atlas != NULL) texture_atlas->print_report();
+  world.atlas_texture = loader.atlas != NULL ? texture_atlas->get_texture() : 0;
 
   //Office Scene setup
   //Office Floor
-  Shape_Struct new_officeFloor = new_importer.loadFiles("models/office/floor");
-  Shape officeFloor(new_officeFloor);
-  unsigned int officeFloor_texture = new_importer.getTexture();
+  Shape officeFloor(loader.get_shape(officeFloor_id));
+  unsigned int officeFloor_texture = loader.get_model_texture(officeFloor_id);
+  Atlas_Region officeFloor_region = loader.get_model_region(officeFloor_id);
   //Office Walls
-  Shape_Struct new_walls = new_importer.loadFiles("models/office/walls");
-  Shape walls(new_walls);
-  unsigned int walls_texture = new_importer.getTexture();
+  Shape walls(loader.get_shape(walls_id));
+  unsigned int walls_texture = loader.get_model_texture(walls_id);
+  Atlas_Region walls_region = loader.get_model_region(walls_id);
   //Office Furniture
-  Shape_Struct new_furniture = new_importer.loadFiles("models/office/furniture");
-  Shape furniture(new_furniture);
-  unsigned int furniture_texture = new_importer.getTexture();
+  Shape furniture(loader.get_shape(furniture_id));
+  unsigned int furniture_texture = loader.get_model_texture(furniture_id);
+  Atlas_Region furniture_region = loader.get_model_region(furniture_id);
   //Material Cubes
   Shape cube1,cube2;
   set_basic_cube(&cube1);    
@@ -87,53 +166,97 @@ int main() {
   set_basic_cube(&cube2);
   cube2.set_material(pearl);
 
-  //Portals setup
-  Shape_Struct new_portal1 = new_importer.loadFiles("models/portals/portal1");
-  Shape portal1(new_portal1); //Red
-  Shape_Struct new_portal2 = new_importer.loadFiles("models/portals/portal2");
-  Shape portal2(new_portal2); //Blue
-  Shape_Struct new_portal3 = new_importer.loadFiles("models/portals/portal3");
-  Shape portal3(new_portal3); //Green
-  Shape_Struct new_portal4 = new_importer.loadFiles("models/portals/portal4");
-  Shape portal4(new_portal4); //Pink
-
-  //Buildings setup
-  Shape_Struct new_building1 = new_importer.loadFiles("models/buildings/building1");
-  Shape building1(new_building1); //Red
-  Shape_Struct new_building2 = new_importer.loadFiles("models/buildings/building2");
-  Shape building2(new_building2); //Blue
-  Shape_Struct new_building3 = new_importer.loadFiles("models/buildings/building3");
-  Shape building3(new_building3); //Green
-  Shape_Struct new_building4 = new_importer.loadFiles("models/buildings/building4");
-  Shape building4(new_building4); //Pink
+  //Portals setup (red, blue, green, pink)
+  Shape portal(loader.get_shape(portal_id));
+  glm::vec3 portal_positions[4] = {glm::vec3(10.0f,-3.99f,7.5f),glm::vec3(20.0f,-3.99f,7.5f),
+                                   glm::vec3(10.0f,-3.99f,-7.5f),glm::vec3(20.0f,-3.99f,-7.5f)};
+  glm::vec3 portal_colors[4] = {glm::vec3(0.8f,0.011057f,0.023033f),glm::vec3(0.004297f,0.003582f,0.8f),
+                                glm::vec3(0.07209f,0.8f,0.016184f),glm::vec3(1.0f,0.0f,0.977162f)};
+  std::vector<Instance_Data> portal_instances(4);
+  for (int i = 0; i < 4; i++) {
+    portal_instances[i].model = place_model(portal_positions[i],0.0f,glm::vec3(0.6f,0.6f,0.6f));
+    portal_instances[i].color_override = glm::vec4(portal_colors[i],1.0f);
+    portal_instances[i].override_material = 0;
+  }
+  portal.set_instances(portal_instances);
+
+  //Buildings setup (red, blue, green, pink roofs)
+  Shape building1(building_ids[0] >= 0 ? loader.get_shape(building_ids[0]) : Shape_Struct());
+  Shape building2(building_ids[1] >= 0 ? loader.get_shape(building_ids[1]) : Shape_Struct());
+  Shape building3(building_ids[2] >= 0 ? loader.get_shape(building_ids[2]) : Shape_Struct());
+  Shape building4(building_ids[3] >= 0 ? loader.get_shape(building_ids[3]) : Shape_Struct());
+  Shape* buildings[4] = {&building1,&building2,&building3,&building4};
+  Shape city_stand_in(city_id >= 0 && city_id != building_ids[0] ? loader.get_shape(city_id) : Shape_Struct());
+  Shape& city_building_shape = city_id == building_ids[0] ? building1 : city_stand_in;
+  glm::vec3 building_positions[4] = {glm::vec3(-80.0f,-3.99f,20.0f),glm::vec3(38.0f,-3.99f,20.0f),
+                                     glm::vec3(-7.5f,-3.99f,-20.0f),glm::vec3(110.0f,-3.99f,-15.0f)};
+  float building_rotations[4] = {-90.0f,-90.0f,90.0f,90.0f};
+  glm::vec3 roof_colors[4] = {glm::vec3(0.8f,0.011f,0.023001f),glm::vec3(0.004f,0.004f,0.8f),
+                              glm::vec3(0.072f,0.8f,0.016f),glm::vec3(1.0f,0.0f,0.997f)};
+  //building1's mesh draws all four, with their roof colors, only if the others have the same
+  //geometry; otherwise each building is its own draw
+  bool buildings_match = true;
+  for (int i = 0; i < 4; i++) {
+    buildings_match = buildings_match && building_ids[i] >= 0 && same_mesh(loader.get_shape(building_ids[0]),loader.get_shape(building_ids[i]));
+  }
+  //Placements drawn with city_building_shape's mesh: the four buildings if they match, then
+  //the city
+  std::vector<Instance_Data> building_instances;
+  for (int i = 0; buildings_match && i < 4; i++) {
+    Instance_Data instance;
+    instance.model = place_model(building_positions[i],building_rotations[i],glm::vec3(0.6f,0.6f,0.6f));
+    instance.color_override = glm::vec4(roof_colors[i],1.0f);
+    instance.override_material = 0;
+    building_instances.push_back(instance);
+  }
+  size_t first_city_building = building_instances.size();
+  //City: a grid of extra buildings over the ground around the office and the portals, still
+  //one draw call when instanced
+  if (city_buildings > 0 && city_id >= 0) {
+    float spacing = sqrtf((300.0f * 300.0f - 80.0f * 60.0f) / city_buildings);
+    int columns = (int)(300.0f / spacing);
+    for (int cell = 0, placed = 0; placed < city_buildings; cell++) {
+      glm::vec3 position(-150.0f + (cell % columns + 0.5f) * spacing,-3.99f,-150.0f + (cell / columns + 0.5f) * spacing);
+      if (fabsf(position.x) < 40.0f && fabsf(position.z) < 30.0f) continue;
+      Instance_Data city_building;
+      city_building.model = place_model(position,(placed % 4) * 90.0f,glm::vec3(0.6f,0.6f,0.6f));
+      city_building.color_override = glm::vec4(roof_colors[placed % 4],1.0f);
+      city_building.override_material = 0;
+      building_instances.push_back(city_building);
+      placed++;
+    }
+  }
+  if (instanced_buildings && !building_instances.empty()) city_building_shape.set_instances(building_instances);
 
   //Keyhole
-  Shape_Struct new_keyhole = new_importer.loadFiles("models/keyhole");
-  Shape keyhole(new_keyhole);
-  unsigned int keyhole_texture = new_importer.getTexture();
+  Shape keyhole(loader.get_shape(keyhole_id));
+  unsigned int keyhole_texture = loader.get_model_texture(keyhole_id);
+  Atlas_Region keyhole_region = loader.get_model_region(keyhole_id);
 
   //Lamppost
-  Shape_Struct new_lamppost = new_importer.loadFiles("models/lamppost");
-  Shape lamppost(new_lamppost);
+  Shape lamppost(loader.get_shape(lamppost_id));
 
   //Pressure Plate
-  MovingPlate pressure_plate(new_importer.loadFiles("models/pressurePlate"),
+  MovingPlate pressure_plate(loader.get_shape(pressurePlate_id),
                             glm::vec3(0.5,0.5,0.5),glm::vec3(1.2,-3.99,-0.8),0.0f);
-  pressure_plate.set_texture(new_importer.getTexture());
+  pressure_plate.set_texture(loader.get_model_texture(pressurePlate_id));
+  pressure_plate.set_atlas_region(loader.get_model_region(pressurePlate_id));
   
   //Door
-  MovingDoor door(new_importer.loadFiles("models/door"),
+  MovingDoor door(loader.get_shape(door_id),
                   glm::vec3(0.638,0.638,0.638),glm::vec3(5.0,-3.99,3.41),0.0f);
-  door.set_texture(new_importer.getTexture());
+  door.set_texture(loader.get_model_texture(door_id));
+  door.set_atlas_region(loader.get_model_region(door_id));
 
   //Key
-  MovingKey office_key(new_importer.loadFiles("models/key"),
+  MovingKey office_key(loader.get_shape(key_id),
                   glm::vec3(0.25,0.25,0.25),glm::vec3(-67.0,-3.99,-47.0),0.0f);
-  office_key.set_texture(new_importer.getTexture());
+  office_key.set_texture(loader.get_model_texture(key_id));
+  office_key.set_atlas_region(loader.get_model_region(key_id));
   
   //Brick floor
   Shape worldFloor;
-  world.floor_texture = get_texture("images/bricks.jpg");
+  unsigned int floor_texture = loader.get_texture(bricks_id);
   set_texture_rectangle(&worldFloor,glm::vec3(-1.0,-1.0,0.0f),2.0f,2.0f,false,false,100.0f);
   
   //Initialize shader programs
@@ -142,60 +265,90 @@ int main() {
   Shader outline_program("shaders/vertexShader.glsl","shaders/outlineFragmentShader.glsl");
   Shader font_program ("shaders/fontVertexShader.glsl","shaders/fontFragmentShader.glsl");
   Shader import_program("shaders/importVertexShader.glsl","shaders/importFragmentShader.glsl");
+  Shader instanced_program("shaders/importInstancedVertexShader.glsl","shaders/importFragmentShader.glsl");
   Shader depth_program("shaders/depthVertexShader.glsl","shaders/depthFragmentShader.glsl");
   Shader skybox_program("shaders/skyboxVertexShader.glsl","shaders/skyboxFragmentShader.glsl");
   Shader post_process_program("shaders/postVertexShader.glsl","shaders/postFragmentShader.glsl");
 
-  //Map structure setup to pass objects to render scene function
-  std::map<std::string,Draw_Data> draw_map;
-  //Add floor to map
-  draw_map["worldFloor"].shape = &worldFloor;
-  draw_map["worldFloor"].shader = &texture_program;
-  //Add officeFloor to map
-  draw_map["officeFloor"].shape = &officeFloor;
-  draw_map["officeFloor"].shader = &import_program;
-  draw_map["officeFloor"].texture = officeFloor_texture;
-  //Add walls to map
-  draw_map["walls"].shape = &walls;
-  draw_map["walls"].shader = &import_program;
-  draw_map["walls"].texture = walls_texture;
-  //Add furniture to map
-  draw_map["furniture"].shape = &furniture;
-  draw_map["furniture"].shader = &import_program;
-  draw_map["furniture"].texture = furniture_texture;
-  //Add keyhole to map
-  draw_map["keyhole"].shape = &keyhole;
-  draw_map["keyhole"].shader = &import_program;
-  draw_map["keyhole"].texture = keyhole_texture;
-  //Add lampost to map
-  draw_map["lamppost"].shape = &lamppost;
-  draw_map["lamppost"].shader = &import_program;
-  //Add portals to map
-  draw_map["portal1"].shape = &portal1;
-  draw_map["portal1"].shader = &import_program;
-  draw_map["portal2"].shape = &portal2;
-  draw_map["portal2"].shader = &import_program;
-  draw_map["portal3"].shape = &portal3;
-  draw_map["portal3"].shader = &import_program;
-  draw_map["portal4"].shape = &portal4;
-  draw_map["portal4"].shader = &import_program;
-  //Add buildings to map
-  draw_map["building1"].shape = &building1;
-  draw_map["building1"].shader = &import_program;
-  draw_map["building2"].shape = &building2;
-  draw_map["building2"].shader = &import_program;
-  draw_map["building3"].shape = &building3;
-  draw_map["building3"].shader = &import_program;
-  draw_map["building4"].shape = &building4;
-  draw_map["building4"].shader = &import_program;
-  //Add cubes to map
-  draw_map["cube1"].shape = &cube1;
-  draw_map["cube1"].shader = &fill_program;
-  draw_map["cube2"].shape = &cube2;
-  draw_map["cube2"].shader = &fill_program;
-  //Add shaders for stencil program to reference
-  draw_map["stencil_fill"].shader = &fill_program;
-  draw_map["stencil_import"].shader = &import_program;
+  //Register the static objects with the render queue (drawn in this order)
+  Render_Queue render_queue;
+  Draw_Item item;
+  //Floor
+  item.shape = &worldFloor;
+  item.shader = &texture_program;
+  item.texture = floor_texture;
+  item.model = glm::translate(glm::mat4(1.0f),glm::vec3(0.0,-4.0,0.0));
+  item.model = glm::scale(item.model,glm::vec3(150.0f,150.0f,150.0f));
+  item.model = glm::rotate(item.model,glm::radians(-90.0f),glm::vec3(1.0,0.0,0.0));
+  item.flags = DRAW_RESET_TRANSFORM;
+  render_queue.add(item);
+  //Office floor and walls
+  item.shader = &import_program;
+  item.flags = DRAW_USE_TEXTURE;
+  item.shape = &officeFloor;
+  item.texture = officeFloor_texture;
+  item.atlas_region = officeFloor_region;
+  item.model = place_model(glm::vec3(0.0f,-3.99f,0.0f),0.0f,glm::vec3(0.5f,0.5f,0.5f));
+  render_queue.add(item);
+  item.shape = &walls;
+  item.texture = walls_texture;
+  item.atlas_region = walls_region;
+  item.model = place_model(glm::vec3(0.0f,-3.99f,0.0f),0.0f,glm::vec3(1.0f,1.0f,1.0f));
+  render_queue.add(item);
+  //Furniture, keyhole and lamppost cast shadows through the depth shader
+  item.flags = DRAW_USE_TEXTURE|DRAW_SHADOW_SHADER;
+  item.shape = &furniture;
+  item.texture = furniture_texture;
+  item.atlas_region = furniture_region;
+  item.model = place_model(glm::vec3(0.0f,-3.99f,0.0f),0.0f,glm::vec3(0.5f,0.5f,0.5f));
+  render_queue.add(item);
+  item.shape = &keyhole;
+  item.texture = keyhole_texture;
+  item.atlas_region = keyhole_region;
+  item.model = place_model(glm::vec3(5.159f,-3.7f,0.0f),-90.0f,glm::vec3(0.25f,0.25f,0.25f));
+  render_queue.add(item);
+  item.flags = DRAW_SHADOW_SHADER;
+  item.shape = &lamppost;
+  item.texture = 0;
+  item.atlas_region = Atlas_Region();
+  item.model = place_model(glm::vec3(15.0f,-3.99f,0.0f),-90.0f,glm::vec3(0.2f,0.2f,0.2f));
+  render_queue.add(item);
+  //Portals and buildings (one instanced draw each)
+  item.shader = &instanced_program;
+  item.flags = DRAW_INSTANCED;
+  item.model = glm::mat4(1.0f);
+  item.shape = &portal;
+  render_queue.add(item);
+  if (instanced_buildings && !building_instances.empty()) {
+    item.shape = &city_building_shape;
+    render_queue.add(item);
+  }
+  //One queued draw per building (their materials instead of the roof colors)
+  item.shader = &import_program;
+  item.flags = 0;
+  for (size_t i = 0; !instanced_buildings && i < building_instances.size(); i++) {
+    item.shape = &city_building_shape;
+    item.model = building_instances[i].model;
+    render_queue.add(item);
+  }
+  for (int i = 0; !buildings_match && i < 4; i++) {
+    if (building_ids[i] < 0) continue;
+    item.shape = buildings[i];
+    item.model = place_model(building_positions[i],building_rotations[i],glm::vec3(0.6f,0.6f,0.6f));
+    render_queue.add(item);
+  }
+  //Cubes (silver and pearl)
+  item.shader = &fill_program;
+  item.flags = DRAW_SHADOW_SHADER|DRAW_RESET_TRANSFORM|DRAW_USE_MATERIAL;
+  item.shape = &cube1;
+  item.model = place_model(glm::vec3(-1.0f,-3.35f,1.0f),0.0f,glm::vec3(0.25f,0.25f,0.25f));
+  render_queue.add(item);
+  item.shape = &cube2;
+  item.model = place_model(glm::vec3(-1.05f,-3.35f,-1.0f),0.0f,glm::vec3(0.25f,0.25f,0.25f));
+  render_queue.add(item);
+  //Shaders for the stencil outlines
+  world.stencil_fill_program = &fill_program;
+  world.stencil_import_program = &import_program;
 
   //Set shaders for moving objects
   pressure_plate.set_shader(&import_program);
@@ -205,70 +358,58 @@ int main() {
   world.pressure_plate = &pressure_plate;
   world.door = &door;
   world.office_key = &office_key;
+  world.index_scene(render_queue);
+  world.setup_triggers("levels/office_triggers.txt");
+
+  //Collision geometry: one box per object, placed like the drawn models.  The walls come from
+  //a collision-only file that leaves the doorways open.
+  world.collision_world.load_obj("levels/office_walls_collision.obj",place_model(glm::vec3(0.0f,-3.99f,0.0f),0.0f,glm::vec3(1.0f,1.0f,1.0f)));
+  world.door_collider = world.collision_world.find("door");
+  world.collision_world.load_obj("models/office/furniture.obj",place_model(glm::vec3(0.0f,-3.99f,0.0f),0.0f,glm::vec3(0.5f,0.5f,0.5f)));
+  world.collision_world.load_obj("models/lamppost.obj",place_model(glm::vec3(15.0f,-3.99f,0.0f),-90.0f,glm::vec3(0.2f,0.2f,0.2f)));
+  for (int i = 0; i < 4; i++) {
+    std::vector<Collision_Object> building_objects;
+    if (building_ids[i] < 0 || !read_collision_objects(building_models[i] + ".obj",building_objects)) continue;
+    world.collision_world.add_objects(building_objects,place_model(building_positions[i],building_rotations[i],glm::vec3(0.6f,0.6f,0.6f)));
+    //The city repeats building1 (not the bench's stand-in)
+    for (size_t j = first_city_building; i == 0 && j < building_instances.size(); j++) {
+      world.collision_world.add_objects(building_objects,building_instances[j].model);
+    }
+  }
   
   //Shader initialization
   std::vector<Shader*> shaders = {&fill_program,&outline_program,&texture_program,
-                                  &import_program,&depth_program,&skybox_program,&post_process_program};
+                                  &import_program,&instanced_program,&depth_program,&skybox_program,&post_process_program};
   glm::mat4 identity(1.0f);
   glm::mat4 model = identity;
-  glm::mat4 view = identity;
-  view = camera.get_view_matrix();
-  glm::mat4 projection = glm::perspective(glm::radians(45.0f),(float)WIN_WIDTH/(float)WIN_HEIGHT,0.1f,100.0f);
+  world.projection = glm::perspective(glm::radians(45.0f),(float)WIN_WIDTH/(float)WIN_HEIGHT,0.1f,100.0f);
+  //Camera and light uniforms live in the shared FrameCamera/FrameLights blocks
+  world.frame_uniforms.initialize();
   for (int i = 0; i < shaders.size(); i++) {
     shaders[i]->use();
     shaders[i]->setMat4("transform",identity);
     shaders[i]->setMat4("model",model);
-    shaders[i]->setMat4("view",view);
-    shaders[i]->setMat4("projection",projection);
     shaders[i]->setFloat("ambient_strength",0.1);
     shaders[i]->setFloat("specular_strength",1.0f);
-    shaders[i]->setVec4("view_position",glm::vec4(world.camera->get_position(),0.0f));
-    //Point Light
-    glm::vec3 wp = world.point_light_position;
-    shaders[i]->setVec3("point_light.position",glm::vec3(wp.x,wp.y,wp.z));
-    shaders[i]->setVec3("point_light.ambient",0.8f*world.point_light_color);
-    shaders[i]->setVec3("point_light.diffuse",world.point_light_color);
-    shaders[i]->setVec3("point_light.specular",world.point_light_color);
-    shaders[i]->setBool("point_light.on",world.point_light_on);
-    shaders[i]->setFloat("point_light.constant",1.0);
-    shaders[i]->setFloat("point_light.linear",0.14);
-    shaders[i]->setFloat("point_light.quadratic",0.07);
     shaders[i]->setFloat("shininess",2);
-    //Spot Light
-    shaders[i]->setVec3("spot_light.position",world.camera->get_position());
-    shaders[i]->setVec3("spot_light.direction",world.camera->get_front());
-    shaders[i]->setFloat("spot_light.cutOff",glm::cos(glm::radians(12.5f)));
-    shaders[i]->setFloat("spot_light.outerCutOff",glm::cos(glm::radians(17.5f)));
-    shaders[i]->setVec3("spot_light.ambient",world.spot_light_ambient);
-    shaders[i]->setVec3("spot_light.diffuse",world.spot_light_diffuse);
-    shaders[i]->setVec3("spot_light.specular",world.spot_light_specular);
-    shaders[i]->setFloat("spot_light.constant",1.0f);
-    shaders[i]->setFloat("spot_light.linear",0.09f);
-    shaders[i]->setFloat("spot_light.quadratic",0.032f);
-    shaders[i]->setBool("spot_light.on",world.spot_light_on);
-    //Directional Light
-    shaders[i]->setVec3("dir_light.direction",world.dir_light_direction);
-    shaders[i]->setVec3("dir_light.ambient",0.2f*world.dir_light_color);
-    shaders[i]->setVec3("dir_light.diffuse",world.dir_light_color);
-    shaders[i]->setVec3("dir_light.specular",world.dir_light_color);
-    shaders[i]->setBool("dir_light.on",world.dir_light_on);
-    shaders[i]->setFloat("time",glfwGetTime());
+    //Shadow map setup
+    shaders[i]->setInt("texture_image",0);
+    shaders[i]->setInt("depth_image",1);
+    //Packed meshes read their materials from this unit (it must not alias texture_image)
+    shaders[i]->setInt("material_buffer",MATERIAL_BUFFER_UNIT);
+    shaders[i]->setInt("atlas_image",ATLAS_TEXTURE_UNIT);
   }
 
   //Text Display setup
   Display_Data display_data;
   display_data.fill_program = &fill_program;
   display_data.font_program = &font_program;
-  display_data.projection = projection;
-  display_data.view = view;
   display_data.font = &arialFont;
   Text_Display text_display(display_data);
   world.text_display = &text_display;
   world.text_display->initialize();
 
   //Skybox setup
-  Shape skybox_cube;
-  set_basic_cube(&skybox_cube);
   std::vector<std::string> faces {
     "skybox/right.jpg",
     "skybox/left.jpg",
@@ -278,7 +419,7 @@ int main() {
     "skybox/back.jpg"
   };
   unsigned int cubemapTexture = get_cube_map(faces,false);
-  Skybox skybox(&skybox_program,skybox_cube,cubemapTexture);
+  Skybox skybox(&skybox_program,cubemapTexture);
   world.skybox = &skybox;
 
   //font_program shader setup
@@ -289,13 +430,14 @@ int main() {
   font_program.setFloat("alpha", text_display.get_alpha_value());
   font_program.setInt("texture1", 0);
 
+#ifndef POWER_OUTAGE_BENCH
   //Cursor setup
   glfwSetInputMode(window,GLFW_CURSOR,GLFW_CURSOR_DISABLED);
   glfwSetCursorPosCallback(window,mouse_callback);
+#endif
 
   //Enable depth testing to avoid managing ordering of 3D objects
   glEnable(GL_DEPTH_TEST);
-  glPolygonMode(GL_BACK,GL_LINE);
 
   //Blending
   glEnable(GL_BLEND);
@@ -306,15 +448,15 @@ int main() {
   //Make framebuffer object
   unsigned int post_framebuffer;
   glGenFramebuffers(1, &post_framebuffer);
-  glBindFramebuffer(GL_FRAMEBUFFER, post_framebuffer); 
+  GL_State_Cache::bind_framebuffer(post_framebuffer); 
   //Create and bind a texture
   unsigned int texColorBuffer;
   glGenTextures(1, &texColorBuffer);
-  glBindTexture(GL_TEXTURE_2D, texColorBuffer);
+  GL_State_Cache::bind_texture(0, GL_TEXTURE_2D, texColorBuffer);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIN_WIDTH, WIN_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glBindTexture(GL_TEXTURE_2D, 0);
+  GL_State_Cache::bind_texture(0, GL_TEXTURE_2D, 0);
   //Attach texture to framebuffer object
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
   //Make renderbuffer object
@@ -328,7 +470,7 @@ int main() {
   //Check if framebuffer is complete
   if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	  std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GL_State_Cache::bind_framebuffer(0);
   world.post_buffer = post_framebuffer;
 
   /** Framebuffer (Shadows) **/
@@ -339,7 +481,7 @@ int main() {
   //Generate 2D texture to hold depth information
   unsigned int depthMap;
   glGenTextures(1, &depthMap);
-  glBindTexture(GL_TEXTURE_2D, depthMap);
+  GL_State_Cache::bind_texture(0, GL_TEXTURE_2D, depthMap);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT,
                0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -349,12 +491,12 @@ int main() {
   float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
   glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
   //Bind and attach the texture
-  glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+  GL_State_Cache::bind_framebuffer(depthMapFBO);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
   glDrawBuffer(GL_NONE);
   glReadBuffer(GL_NONE);
   //Reset to default
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  GL_State_Cache::bind_framebuffer(0);
   world.shadow_buffer = depthMapFBO;
   world.shadow_depthMap = depthMap;
 
@@ -363,36 +505,242 @@ int main() {
   glStencilOp(GL_KEEP,GL_KEEP,GL_REPLACE);
   glStencilFunc(GL_NOTEQUAL,1,0xFF);
   
+  //Frame-time profiler (F3 shows it, F4 writes a Chrome trace)
+  Profiler::init_gpu();
+
+  //Everything one frame draws, from the uniform blocks to the post processed image.  The game
+  //loop and the headless benchmark share it.
+  auto render_frame = [&]() {
+    Shader::resetCounters();
+    Frame_Uniforms::uploads = 0;
+    GL_State_Cache::reset_stats();
+    render_queue.cull_stats = Cull_Stats();
+    world.instance_cull_stats = Cull_Stats();
+    {
+      Profile_Scope scope("frame uniforms");
+      world.update_frame_uniforms();
+    }
+    {
+      Profile_Scope scope("shadow pass");
+      world.render_scene(render_queue,&depth_program); //Shadows
+    }
+    {
+      Profile_Scope scope("main pass");
+      world.render_scene(render_queue); //Primary rendering
+    }
+    {
+      Profile_Scope scope("post processing");
+      post_processor.render_effect(&post_process_program,texColorBuffer); //Render post processing effects last
+    }
+    if (text_display.profiler_activated) {
+      Profile_Scope scope("profiler overlay");
+      text_display.render_profiler(Profiler::summary_lines());
+    }
+  };
+
+#ifdef POWER_OUTAGE_BENCH
+  //Fly the scripted path in fixed steps, or play a recorded session back, so every run renders
+  //the same frames
+  Camera_Path camera_path;
+  bool replay = !bench_options.replay_path.empty();
+  if (replay) {
+    if (!Input_Replay::start_playback(bench_options.replay_path)) return 1;
+    bench_options.frames = Input_Replay::get_frame_count();
+    if (bench_options.frames < 1) {
+      std::cout << "ERROR: " << bench_options.replay_path << " holds no frames" << std::endl;
+      return 1;
+    }
+    Input_Start start = Input_Replay::get_start();
+    camera.set_position(start.position);
+    camera.set_orientation(start.yaw,start.pitch);
+  }
+  else if (!camera_path.load(bench_options.camera_path)) return 1;
+  //The report counts the fragments the sky shades against the pixels it covers
+  skybox.count_fragments = true;
+  //Every measured frame draws the real textures
+  texture_streamer->finish();
+  texture_streamer->print_report();
+  double setup_ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - setup_start).count();
+  Bench_Recorder recorder(bench_options,WIN_WIDTH,WIN_HEIGHT);
+  recorder.check_gl_errors(); //setup errors count too
+  float step = bench_options.frames > 1 ? camera_path.get_duration() / (bench_options.frames - 1) : 0.0f;
+  //Warm-up frames (first use of every program, texture and framebuffer) render the first
+  //key of the path (or the recording's starting view) and are left out of the report
+  double instances_drawn = 0.0, instances_culled = 0.0;
+  for (int frame = -bench_options.warmup_frames; frame < bench_options.frames; frame++) {
+    if (frame == 0) {
+      glFinish();
+      Profiler::clear();
+      skybox.reset_stats();
+    }
+    Profiler::begin_frame();
+    recorder.begin_frame();
+    {
+      Profile_Scope frame_scope("frame");
+      if (replay) {
+        //The recorded frame times drive the game, not how long these frames take
+        Input_Frame input;
+        if (frame >= 0 && Input_Replay::begin_frame(NULL,0.0f,input)) {
+          world.deltaTime = input.delta_time;
+          world.lastFrame += input.delta_time;
+          if (input.mouse_x != 0.0f || input.mouse_y != 0.0f) camera.process_mouse_movement(input.mouse_x,input.mouse_y);
+          world.process_input(NULL);
+        }
+      }
+      else {
+        float time = std::max(frame,0) * step;
+        world.deltaTime = time - world.lastFrame;
+        world.lastFrame = time;
+        Camera_Key key = camera_path.sample(time);
+        camera.set_position(key.position);
+        camera.set_orientation(key.yaw,key.pitch);
+        world.update_triggers();
+      }
+
+      glm::vec4 clr = world.clear_color;
+      glClearColor(clr.r,clr.g,clr.b,clr.a);
+      render_frame();
+      //Stands in for the buffer swap: the frame time includes finishing the GPU work
+      Profile_Scope scope("finish");
+      glFinish();
+    }
+    if (frame >= 0) {
+      recorder.end_frame(frame);
+      instances_drawn += world.instance_cull_stats.visible;
+      instances_culled += world.instance_cull_stats.culled;
+    }
+  }
+  //The GPU times of the last frames are read when their query sets come around again
+  for (int i = 0; i < PROFILER_GPU_FRAMES; i++) Profiler::begin_frame();
+  Skybox_Stats sky = skybox.get_stats();
+  double frames = bench_options.frames;
+  recorder.add_counter("skybox_draws",sky.draws / frames);
+  recorder.add_counter("skybox_pixels_covered",sky.pixels_covered / frames);
+  recorder.add_counter("skybox_fragments_shaded",sky.fragments_shaded / frames);
+  recorder.add_counter("skybox_fragments_rejected",(sky.pixels_covered - sky.fragments_shaded) / frames);
+  //Instances of the instanced draws, over both passes
+  recorder.add_counter("instances_drawn",instances_drawn / frames);
+  recorder.add_counter("instances_culled",instances_culled / frames);
+  delete texture_streamer;
+  delete texture_atlas;
+  return recorder.finish(setup_ms) ? 0 : 1;
+#else
+  //Per-frame uniform counters (see Shader::driver_lookups)
+  int frame_count = 0;
+  float last_stats_time = 0.0f;
+
+  //Input recording: --record FILE writes this session's input, --replay FILE plays one back
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "--record" || arg == "--replay") && i + 1 < argc) {
+      std::string path = argv[++i];
+      if (arg == "--replay") {
+        if (!Input_Replay::start_playback(path)) return 1;
+        Input_Start start = Input_Replay::get_start();
+        camera.set_position(start.position);
+        camera.set_orientation(start.yaw,start.pitch);
+        std::cout << "Replaying " << Input_Replay::get_frame_count() << " frames from " << path << std::endl;
+      }
+      else {
+        Input_Start start;
+        start.position = camera.get_position();
+        start.yaw = camera.get_yaw();
+        start.pitch = camera.get_pitch();
+        if (!Input_Replay::start_recording(path,start)) return 1;
+        std::cout << "Recording input to " << path << std::endl;
+      }
+    }
+    else {
+      std::cout << "ERROR: unknown option " << arg << " (use --record FILE or --replay FILE)" << std::endl;
+      return 2;
+    }
+  }
+  //Frame times measured while replaying, to compare runs of the same recording
+  double last_clock = 0.0;
+  double replay_seconds = 0.0;
+  double replay_worst = 0.0;
+  bool textures_reported = false;
+
   //glfwWindowShouldClose checks if GLFW has been instructed to close
   while(!glfwWindowShouldClose(window)) {
+    Profiler::begin_frame();
+    Profile_Scope frame_scope("frame");
     float currentFrame = glfwGetTime();
-    world.deltaTime = currentFrame - world.lastFrame;
-    world.lastFrame = currentFrame;
+    double measured = currentFrame - last_clock;
+    last_clock = currentFrame;
+    //Frame time and mouse movement come from the recording during playback
+    Input_Frame input;
+    if (!Input_Replay::begin_frame(window,measured,input)) {
+      int frames = Input_Replay::get_frame_count();
+      std::cout << "Replay finished: " << frames << " frames, " << replay_seconds * 1000.0 / std::max(frames,1)
+                << " ms per frame on average, " << replay_worst * 1000.0 << " ms at worst" << std::endl;
+      break;
+    }
+    if (Input_Replay::get_mode() == INPUT_PLAYBACK && Input_Replay::get_frame_index() > 1) {
+      //The first frame's time includes loading
+      replay_seconds += measured;
+      replay_worst = std::max(replay_worst,measured);
+    }
+    world.deltaTime = input.delta_time;
+    world.lastFrame += input.delta_time;
 
     //Set the clear color
     glm::vec4 clr = world.clear_color;
     glClearColor(clr.r,clr.g,clr.b,clr.a);
 
+    //Textures decoded since the last frame, within the per-frame upload budget
+    {
+      Profile_Scope scope("texture streaming",false);
+      texture_streamer->update();
+      if (!textures_reported && texture_streamer->idle()) {
+        texture_streamer->print_report();
+        Texture_Cache::print_report();
+        textures_reported = true;
+      }
+    }
+
     //1. Process Input
-    world.process_input(window);
+    {
+      Profile_Scope scope("input",false);
+      if (input.mouse_x != 0.0f || input.mouse_y != 0.0f) camera.process_mouse_movement(input.mouse_x,input.mouse_y);
+      world.process_input(window);
+    }
 
     //2. Render Scene
-    world.render_scene(draw_map,&depth_program); //Shadows
-    world.render_scene(draw_map); //Primary rendering
-    post_processor.render_effect(&post_process_program,texColorBuffer); //Render post processing effects last
+    render_frame();
+    frame_count++;
+    //The first frame still resolves the per-shape packed uniforms, so report the second
+    if (frame_count == 2 || (UNIFORM_STATS_SECONDS > 0.0 && currentFrame - last_stats_time > UNIFORM_STATS_SECONDS)) {
+      std::cout<<"Uniforms this frame: "<<Shader::driver_lookups<<" driver lookups, "
+               <<Shader::uniform_calls<<" glUniform calls, "<<Frame_Uniforms::uploads<<" uniform block uploads"<<std::endl;
+      std::cout<<"GL state this frame: "<<GL_State_Cache::stats.program_switches<<" program switches, "
+               <<GL_State_Cache::stats.texture_binds<<" texture binds, "<<GL_State_Cache::stats.vao_binds<<" VAO binds, "
+               <<GL_State_Cache::stats.framebuffer_binds<<" framebuffer binds ("<<GL_State_Cache::stats.skipped<<" redundant skipped)"<<std::endl;
+      std::cout<<"Culling this frame (shadow + main pass): "<<render_queue.cull_stats.visible<<" draws visible, "
+               <<render_queue.cull_stats.culled<<" culled; "<<world.instance_cull_stats.visible<<" instances drawn, "
+               <<world.instance_cull_stats.culled<<" culled"<<std::endl;
+      last_stats_time = currentFrame;
+    }
     
     //3. Poll for events
     glfwPollEvents();
     
     //4. Swap Buffers
-    glfwSwapBuffers(window);
+    {
+      Profile_Scope scope("swap buffers");
+      glfwSwapBuffers(window);
+    }
 
     //5. Prevent rendering lag
     //enforceFrameRate(currentFrame);
   }
 
+  Input_Replay::stop();
+  delete texture_streamer;
+  delete texture_atlas;
   glfwTerminate();
   return 0;
+#endif
 }
 
 void mouse_callback(GLFWwindow* win, double xpos, double ypos) {
@@ -411,9 +759,14 @@ void mouse_callback(GLFWwindow* win, double xpos, double ypos) {
   world.lastX = xpos;
   world.lastY = ypos;
 
-  camera.process_mouse_movement(offsetx,offsety);
+  //Applied at the start of the next frame, so recordings hold it
+  Input_Replay::add_mouse_movement(offsetx,offsety);
 }
 
 void enforceFrameRate(double last_frame_time) {
   while (glfwGetTime() >= last_frame_time+(1.0/FPS));
-}
\ No newline at end of file
+}
+bool same_mesh(const Shape_Struct& a, const Shape_Struct& b) {
+  return a.num_of_vertices == b.num_of_vertices && a.num_indices == b.num_indices &&
+         a.bounds.min == b.bounds.min && a.bounds.max == b.bounds.max;
+}
@@ -0,0 +1,114 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+Mapped_File::Mapped_File(): bytes(NULL), num_bytes(0), opened(false) {
+#ifdef _WIN32
+    this->file_handle = NULL;
+    this->mapping_handle = NULL;
+#endif
+}
+
+Mapped_File::Mapped_File(std::string path): bytes(NULL), num_bytes(0), opened(false) {
+#ifdef _WIN32
+    this->file_handle = NULL;
+    this->mapping_handle = NULL;
+#endif
+    this->open(path);
+}
+
+Mapped_File::~Mapped_File() {
+    this->close();
+}
+
+bool Mapped_File::open(std::string path) {
+    this->close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    this->file_handle = file;
+    this->num_bytes = (size_t)file_size.QuadPart;
+    //Zero-length files cannot be mapped, but they are still valid (empty) files.
+    if (this->num_bytes > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            this->close();
+            return false;
+        }
+        this->mapping_handle = mapping;
+        this->bytes = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (this->bytes == NULL) {
+            this->close();
+            return false;
+        }
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    this->num_bytes = (size_t)info.st_size;
+    if (this->num_bytes > 0) {
+        void* view = mmap(NULL, this->num_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            ::close(fd);
+            this->num_bytes = 0;
+            return false;
+        }
+        //The whole file is read front to back exactly once.
+        madvise(view, this->num_bytes, MADV_SEQUENTIAL);
+        this->bytes = (const char*)view;
+    }
+    //The mapping keeps its own reference to the file.
+    ::close(fd);
+#endif
+    this->opened = true;
+    return true;
+}
+
+void Mapped_File::close() {
+#ifdef _WIN32
+    if (this->bytes != NULL) UnmapViewOfFile(this->bytes);
+    if (this->mapping_handle != NULL) CloseHandle((HANDLE)this->mapping_handle);
+    if (this->file_handle != NULL) CloseHandle((HANDLE)this->file_handle);
+    this->mapping_handle = NULL;
+    this->file_handle = NULL;
+#else
+    if (this->bytes != NULL) munmap((void*)this->bytes, this->num_bytes);
+#endif
+    this->bytes = NULL;
+    this->num_bytes = 0;
+    this->opened = false;
+}
+
+bool Mapped_File::is_open() {
+    return this->opened;
+}
+
+const char* Mapped_File::data() {
+    return this->bytes;
+}
+
+size_t Mapped_File::size() {
+    return this->num_bytes;
+}
@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <stddef.h>
+
+//A read-only view of a file mapped into memory (mmap on Linux, MapViewOfFile on Windows).
+//The bytes stay valid until close() is called or the object is destroyed.
+class Mapped_File {
+    public:
+        Mapped_File();
+        //Maps the file at the given path (equivalent to calling open()).
+        Mapped_File(std::string path);
+        ~Mapped_File();
+
+        //Maps the file at the given path.  Returns false if the file could not be opened.
+        //An empty file opens successfully with size() == 0.
+        bool open(std::string path);
+
+        //Unmaps the file (safe to call more than once).
+        void close();
+
+        bool is_open();
+        const char* data();
+        size_t size();
+
+    private:
+        //Copying would unmap the same view twice.
+        Mapped_File(const Mapped_File&);
+        Mapped_File& operator=(const Mapped_File&);
+
+        const char* bytes;
+        size_t num_bytes;
+        bool opened;
+#ifdef _WIN32
+        void* file_handle;
+        void* mapping_handle;
+#endif
+};
+
+#endif //MAPPED_FILE_HPP
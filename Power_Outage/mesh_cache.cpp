@@ -0,0 +1,237 @@
+#include "mesh_cache.hpp"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <iostream>
+
+static const char POMESH_MAGIC[8] = {'P','O','M','E','S','H','\0','\0'};
+
+//The format is little-endian and written with plain memory copies, so caching is
+//simply disabled on big-endian hosts.
+static bool host_is_little_endian() {
+    uint16_t probe = 1;
+    return *(const unsigned char*)&probe == 1;
+}
+
+static uint64_t align16(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+static bool stat_file(std::string path, uint64_t& mtime, uint64_t& size) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        mtime = 0;
+        size = 0;
+        return false;
+    }
+    mtime = (uint64_t)info.st_mtime;
+    size = (uint64_t)info.st_size;
+    return true;
+}
+
+//FNV-1a over the file contents, continuing from the given hash
+static uint64_t hash_file(std::string path, uint64_t hash) {
+    Mapped_File file;
+    if (!file.open(path)) return hash;
+    const unsigned char* bytes = (const unsigned char*)file.data();
+    for (size_t i = 0; i < file.size(); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+//Rewrites the stat part of a cache's source stamp in place.  The four fields sit together,
+//so a torn write only costs the next open a hash.
+static bool restamp_mesh_cache(std::string path, const Mesh_Source_Stamp& stamp) {
+    uint64_t fields[4] = {stamp.obj_mtime, stamp.obj_size, stamp.mtl_mtime, stamp.mtl_size};
+    std::fstream file(path.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+    if (file.fail()) return false;
+    file.seekp(offsetof(Mesh_Cache_Header, obj_mtime));
+    file.write((const char*)fields, sizeof(fields));
+    return !file.fail();
+}
+
+std::string mesh_cache_path(std::string base_name, uint32_t vertex_layout) {
+    if (vertex_layout == POMESH_LAYOUT_PACKED) return base_name + ".packed.pomesh";
+    return base_name + ".pomesh";
+}
+
+bool get_mesh_source_stamp(std::string base_name, Mesh_Source_Stamp& stamp, bool with_hash) {
+    if (!stat_file(base_name + ".obj", stamp.obj_mtime, stamp.obj_size)) {
+        return false;
+    }
+    //A missing .mtl is legal (the stamp records it as zero)
+    stat_file(base_name + ".mtl", stamp.mtl_mtime, stamp.mtl_size);
+    stamp.has_hash = with_hash;
+    stamp.source_hash = 0;
+    if (with_hash) {
+        uint64_t hash = 14695981039346656037ull;
+        hash = hash_file(base_name + ".obj", hash);
+        hash = hash_file(base_name + ".mtl", hash);
+        stamp.source_hash = hash;
+    }
+    return true;
+}
+
+bool write_mesh_cache(std::string path, Mesh_Source_Stamp stamp, uint32_t vertex_layout,
+                      uint32_t vertex_stride, const void* vertices, uint32_t num_vertices,
+                      const std::vector<unsigned int>& indices,
+                      const std::vector<glm::vec3>& diffuse, const std::vector<glm::vec3>& specular,
+                      std::string texture_path, const Mesh_Pack_Params* pack) {
+    if (!host_is_little_endian() || !stamp.has_hash) {
+        return false;
+    }
+
+    Mesh_Cache_Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, POMESH_MAGIC, sizeof(POMESH_MAGIC));
+    header.version = POMESH_VERSION;
+    header.header_bytes = sizeof(Mesh_Cache_Header);
+    header.obj_mtime = stamp.obj_mtime;
+    header.obj_size = stamp.obj_size;
+    header.mtl_mtime = stamp.mtl_mtime;
+    header.mtl_size = stamp.mtl_size;
+    header.source_hash = stamp.source_hash;
+    header.vertex_layout = vertex_layout;
+    header.vertex_stride = vertex_stride;
+    header.num_vertices = num_vertices;
+    header.num_indices = indices.size();
+    header.index_bytes = num_vertices <= 65536 ? 2 : 4;
+    header.num_materials = diffuse.size() < specular.size() ? diffuse.size() : specular.size();
+    header.texture_path_bytes = texture_path.size();
+    if (pack != NULL) header.pack = *pack;
+
+    header.vertex_offset = align16(sizeof(Mesh_Cache_Header));
+    header.index_offset = align16(header.vertex_offset + (uint64_t)num_vertices * vertex_stride);
+    header.material_offset = align16(header.index_offset + (uint64_t)header.num_indices * header.index_bytes);
+    header.texture_path_offset = align16(header.material_offset + (uint64_t)header.num_materials * 6 * sizeof(float));
+    uint64_t total_bytes = header.texture_path_offset + header.texture_path_bytes;
+
+    //Assemble the file in memory, then write it in one go
+    std::vector<char> blob(total_bytes, 0);
+    memcpy(&blob[0], &header, sizeof(header));
+    if (num_vertices > 0) {
+        memcpy(&blob[header.vertex_offset], vertices, (size_t)num_vertices * vertex_stride);
+    }
+    for (uint32_t i = 0; i < header.num_indices; i++) {
+        if (header.index_bytes == 2) {
+            uint16_t value = (uint16_t)indices[i];
+            memcpy(&blob[header.index_offset + i * 2], &value, 2);
+        }
+        else {
+            uint32_t value = indices[i];
+            memcpy(&blob[header.index_offset + i * 4], &value, 4);
+        }
+    }
+    for (uint32_t i = 0; i < header.num_materials; i++) {
+        float material[6] = {diffuse[i].x, diffuse[i].y, diffuse[i].z,
+                             specular[i].x, specular[i].y, specular[i].z};
+        memcpy(&blob[header.material_offset + i * sizeof(material)], material, sizeof(material));
+    }
+    if (!texture_path.empty()) {
+        memcpy(&blob[header.texture_path_offset], texture_path.data(), texture_path.size());
+    }
+
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (out.fail()) {
+            std::cout << "ERROR: Could not write mesh cache " << temp_path << std::endl;
+            return false;
+        }
+        out.write(&blob[0], blob.size());
+        if (out.fail()) {
+            std::cout << "ERROR: Could not write mesh cache " << temp_path << std::endl;
+            return false;
+        }
+    }
+    //rename() does not replace an existing file on Windows
+    remove(path.c_str());
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Mesh_Cache_File::open(std::string base_name, uint32_t vertex_layout) {
+    this->close();
+    if (!host_is_little_endian() || !this->file.open(mesh_cache_path(base_name, vertex_layout))) {
+        return false;
+    }
+
+    //Structural checks: magic, version, and every section inside the file
+    const Mesh_Cache_Header* header = (const Mesh_Cache_Header*)this->file.data();
+    uint64_t size = this->file.size();
+    if (size < sizeof(Mesh_Cache_Header) || memcmp(header->magic, POMESH_MAGIC, sizeof(POMESH_MAGIC)) != 0 ||
+        header->version != POMESH_VERSION || header->header_bytes != sizeof(Mesh_Cache_Header) ||
+        header->vertex_layout != vertex_layout ||
+        (header->index_bytes != 2 && header->index_bytes != 4) ||
+        header->vertex_offset + (uint64_t)header->num_vertices * header->vertex_stride > size ||
+        header->index_offset + (uint64_t)header->num_indices * header->index_bytes > size ||
+        header->material_offset + (uint64_t)header->num_materials * 6 * sizeof(float) > size ||
+        header->texture_path_offset + header->texture_path_bytes > size) {
+        this->close();
+        return false;
+    }
+
+    //Freshness: cheap stat first, content hash only if the stat disagrees
+    Mesh_Source_Stamp stamp;
+    if (!get_mesh_source_stamp(base_name, stamp, false)) {
+        this->close();
+        return false;
+    }
+    bool fresh = stamp.obj_mtime == header->obj_mtime && stamp.obj_size == header->obj_size &&
+                 stamp.mtl_mtime == header->mtl_mtime && stamp.mtl_size == header->mtl_size;
+    if (!fresh) {
+        get_mesh_source_stamp(base_name, stamp, true);
+        fresh = stamp.source_hash == header->source_hash;
+        //Same contents under a new stat (a touch or a checkout): re-stamp the header so later
+        //opens take the stat path again.  The view is dropped first since Windows does not
+        //allow writing a mapped file.
+        if (fresh) {
+            this->file.close();
+            restamp_mesh_cache(mesh_cache_path(base_name, vertex_layout), stamp);
+            if (!this->file.open(mesh_cache_path(base_name, vertex_layout)) || this->file.size() != size) {
+                this->close();
+                return false;
+            }
+            header = (const Mesh_Cache_Header*)this->file.data();
+        }
+    }
+    if (!fresh) {
+        this->close();
+        return false;
+    }
+
+    this->head = header;
+    return true;
+}
+
+void Mesh_Cache_File::close() {
+    this->file.close();
+    this->head = NULL;
+}
+
+const Mesh_Cache_Header& Mesh_Cache_File::header() {
+    return *this->head;
+}
+
+const void* Mesh_Cache_File::vertices() {
+    return this->file.data() + this->head->vertex_offset;
+}
+
+const void* Mesh_Cache_File::indices() {
+    return this->file.data() + this->head->index_offset;
+}
+
+const glm::vec3* Mesh_Cache_File::materials() {
+    return (const glm::vec3*)(this->file.data() + this->head->material_offset);
+}
+
+std::string Mesh_Cache_File::texture_path() {
+    return std::string(this->file.data() + this->head->texture_path_offset, this->head->texture_path_bytes);
+}
@@ -0,0 +1,107 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+
+//Binary baked-mesh cache (.pomesh) written next to each imported model.
+//
+//Layout (little-endian, every section starts on a 16-byte boundary):
+//  Mesh_Cache_Header
+//  vertex data       num_vertices * vertex_stride bytes, ready for glBufferData
+//  index data        num_indices * index_bytes bytes (2 or 4), ready for glBufferData
+//  material table    num_materials * (Kd, Ks) as 6 floats
+//  texture path      texture_path_bytes chars (no terminator)
+#define POMESH_VERSION 2
+
+//Vertex layouts a cache can hold (each is stored in its own file, see mesh_cache_path)
+#define POMESH_LAYOUT_FLOAT 0   //ImportOBJ::CompleteVertex
+#define POMESH_LAYOUT_PACKED 1  //ImportOBJ::PackedVertex
+
+//Dequantization constants of a packed mesh (zero for the float layout):
+//  position = pos_offset + stored * pos_scale, uv = uv_offset + stored * uv_scale
+struct Mesh_Pack_Params {
+    float pos_offset[3];
+    float pos_scale[3];
+    float uv_offset[2];
+    float uv_scale[2];
+};
+
+struct Mesh_Cache_Header {
+    char magic[8];              //"POMESH\0\0"
+    uint32_t version;
+    uint32_t header_bytes;
+    //Source stamp the cache was built from
+    uint64_t obj_mtime;
+    uint64_t obj_size;
+    uint64_t mtl_mtime;
+    uint64_t mtl_size;
+    uint64_t source_hash;
+    //Geometry
+    uint32_t vertex_layout;
+    uint32_t vertex_stride;
+    uint32_t num_vertices;
+    uint32_t num_indices;
+    uint32_t index_bytes;
+    uint32_t num_materials;
+    uint32_t texture_path_bytes;
+    uint32_t reserved;
+    //Section offsets from the start of the file
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint64_t material_offset;
+    uint64_t texture_path_offset;
+    Mesh_Pack_Params pack;
+};
+
+//Identifies the .obj/.mtl pair a cache was baked from.  The modification times and
+//sizes are checked first; the content hash is only computed when they disagree
+//(e.g. after a fresh checkout touched every file), and a hash match re-stamps the cache.
+struct Mesh_Source_Stamp {
+    uint64_t obj_mtime = 0;
+    uint64_t obj_size = 0;
+    uint64_t mtl_mtime = 0;
+    uint64_t mtl_size = 0;
+    uint64_t source_hash = 0;
+    bool has_hash = false;
+};
+
+//Returns "<base name>.pomesh" for the float layout and "<base name>.packed.pomesh" for the packed one
+std::string mesh_cache_path(std::string base_name, uint32_t vertex_layout = POMESH_LAYOUT_FLOAT);
+
+//Reads the modification times and sizes of the model's .obj/.mtl files (and their FNV-1a
+//content hash if requested).  Returns false if the .obj file does not exist.
+bool get_mesh_source_stamp(std::string base_name, Mesh_Source_Stamp& stamp, bool with_hash);
+
+//Writes a cache file (to a temporary name first, so a crash never leaves a torn cache).
+bool write_mesh_cache(std::string path, Mesh_Source_Stamp stamp, uint32_t vertex_layout,
+                      uint32_t vertex_stride, const void* vertices, uint32_t num_vertices,
+                      const std::vector<unsigned int>& indices,
+                      const std::vector<glm::vec3>& diffuse, const std::vector<glm::vec3>& specular,
+                      std::string texture_path, const Mesh_Pack_Params* pack = NULL);
+
+//A memory-mapped, validated cache file.  The section pointers point straight into the
+//mapping and stay valid until the object is closed or destroyed.
+class Mesh_Cache_File {
+    public:
+        //Maps the cache for the given model and checks it against the model's source files
+        //and the requested vertex layout.  Returns false if the cache is missing or stale.
+        bool open(std::string base_name, uint32_t vertex_layout);
+        void close();
+
+        const Mesh_Cache_Header& header();
+        const void* vertices();
+        const void* indices();
+        //num_materials (Kd, Ks) pairs
+        const glm::vec3* materials();
+        std::string texture_path();
+
+    private:
+        Mapped_File file;
+        const Mesh_Cache_Header* head = NULL;
+};
+
+#endif //MESH_CACHE_HPP
@@ -0,0 +1,268 @@
+#include "mip_generator.hpp"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_USE_SSE 1
+#endif
+
+//Taps of the Kaiser filter (at -2.5 .. 2.5 source texels from the output texel's center)
+#define KAISER_TAPS 6
+//Levels with fewer texels than this are not worth starting threads for
+#define MIP_THREAD_MIN_TEXELS (256 * 256)
+
+//Lookup tables shared by every call (built once, on first use)
+struct Mip_Tables {
+    float to_linear[256];         //sRGB byte -> linear value
+    unsigned char to_srgb[4096];  //linear value * 4095 -> sRGB byte
+    float kaiser[KAISER_TAPS];
+
+    Mip_Tables() {
+        for (int i = 0; i < 256; i++) {
+            float value = i / 255.0f;
+            to_linear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f,2.4f);
+        }
+        for (int i = 0; i < 4096; i++) {
+            float value = i / 4095.0f;
+            value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value,1.0f / 2.4f) - 0.055f;
+            to_srgb[i] = (unsigned char)(value * 255.0f + 0.5f);
+        }
+        //sinc(t) * I0(beta * sqrt(1 - (t / radius)^2)) / I0(beta), t in output texels
+        const double pi = 3.14159265358979323846, beta = 4.0, radius = 1.5;
+        double sum = 0.0, weights[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            double t = (k - 2.5) * 0.5;
+            double sinc = sin(pi * t) / (pi * t);
+            weights[k] = sinc * bessel_i0(beta * sqrt(1.0 - (t / radius) * (t / radius))) / bessel_i0(beta);
+            sum += weights[k];
+        }
+        for (int k = 0; k < KAISER_TAPS; k++) kaiser[k] = (float)(weights[k] / sum);
+    }
+
+    static double bessel_i0(double x) {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 25; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+};
+
+static const Mip_Tables& tables() {
+    static Mip_Tables shared;
+    return shared;
+}
+
+int mip_level_count(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+size_t mip_chain_bytes(int width, int height, int channels) {
+    size_t bytes = 0;
+    while (true) {
+        bytes += (size_t)width * height * channels;
+        if (width == 1 && height == 1) break;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+//Runs rows(begin, end) over [0, count) on up to num_threads threads, the caller being one
+static void parallel_rows(int count, int texels, int num_threads, const std::function<void(int,int)>& rows) {
+    if (num_threads > count) num_threads = count;
+    if (num_threads <= 1 || texels < MIP_THREAD_MIN_TEXELS) {
+        rows(0,count);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; t++) {
+        threads.push_back(std::thread(rows,count * t / num_threads,count * (t + 1) / num_threads));
+    }
+    rows(0,count / num_threads);
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+}
+
+//Level 0 as linear RGBA floats (gray images fill red, green and blue)
+static void load_linear(const Texture_Image& image, bool srgb, float* out, int begin, int end) {
+    const float* to_linear = tables().to_linear;
+    int channels = image.channels;
+    for (size_t i = (size_t)begin * image.width; i < (size_t)end * image.width; i++) {
+        const unsigned char* texel = image.data + i * channels;
+        float* value = out + i * 4;
+        for (int c = 0; c < 3; c++) {
+            unsigned char byte = texel[channels < 3 ? 0 : c];
+            value[c] = srgb ? to_linear[byte] : byte / 255.0f;
+        }
+        value[3] = channels == 2 ? texel[1] / 255.0f : channels == 4 ? texel[3] / 255.0f : 1.0f;
+    }
+}
+
+//Rows [begin, end) of the level below source by the box filter
+static void box_rows(const float* source, int width, int height, float* out, int out_width, int begin, int end, bool simd) {
+    for (int y = begin; y < end; y++) {
+        const float* row0 = source + (size_t)(y * 2 < height ? y * 2 : height - 1) * width * 4;
+        const float* row1 = source + (size_t)(y * 2 + 1 < height ? y * 2 + 1 : height - 1) * width * 4;
+        float* target = out + (size_t)y * out_width * 4;
+        for (int x = 0; x < out_width; x++) {
+            int x0 = (x * 2 < width ? x * 2 : width - 1) * 4, x1 = (x * 2 + 1 < width ? x * 2 + 1 : width - 1) * 4;
+#ifdef MIP_USE_SSE
+            if (simd) {
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0),_mm_loadu_ps(row0 + x1)),
+                                        _mm_add_ps(_mm_loadu_ps(row1 + x0),_mm_loadu_ps(row1 + x1)));
+                _mm_storeu_ps(target + x * 4,_mm_mul_ps(sum,_mm_set1_ps(0.25f)));
+                continue;
+            }
+#endif
+            for (int c = 0; c < 4; c++) {
+                //Summed in the same order as the SSE version, so both give the same bytes
+                target[x * 4 + c] = ((row0[x0 + c] + row0[x1 + c]) + (row1[x0 + c] + row1[x1 + c])) * 0.25f;
+            }
+        }
+    }
+}
+
+//One axis of the Kaiser filter over rows [begin, end).  Halves the texels at stride apart
+//(4 floats along a row, a row's floats down a column); a side of 1 is copied.
+static void kaiser_rows(const float* source, int length, size_t stride, size_t row_stride, float* out, int out_length,
+                        size_t out_stride, size_t out_row_stride, int begin, int end, bool simd) {
+    const float* weights = tables().kaiser;
+    for (int row = begin; row < end; row++) {
+        const float* line = source + row * row_stride;
+        float* target = out + row * out_row_stride;
+        for (int i = 0; i < out_length; i++) {
+            int taps[KAISER_TAPS];
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                int tap = length == 1 ? 0 : i * 2 - 2 + k;
+                taps[k] = tap < 0 ? 0 : tap >= length ? length - 1 : tap;
+            }
+            float* texel = target + i * out_stride;
+#ifdef MIP_USE_SSE
+            if (simd) {
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < KAISER_TAPS; k++) {
+                    sum = _mm_add_ps(sum,_mm_mul_ps(_mm_loadu_ps(line + taps[k] * stride),_mm_set1_ps(weights[k])));
+                }
+                _mm_storeu_ps(texel,sum);
+                continue;
+            }
+#endif
+            for (int c = 0; c < 4; c++) {
+                float sum = 0.0f;
+                for (int k = 0; k < KAISER_TAPS; k++) sum += line[taps[k] * stride + c] * weights[k];
+                texel[c] = sum;
+            }
+        }
+    }
+}
+
+//Rows [begin, end) of a linear level back to bytes of the image's channel count
+static void store_rows(const float* level, int width, int channels, bool srgb, unsigned char* out, int begin, int end, bool simd) {
+    const unsigned char* to_srgb = tables().to_srgb;
+    float color_scale = srgb ? 4095.0f : 255.0f;
+    for (size_t i = (size_t)begin * width; i < (size_t)end * width; i++) {
+        int value[4];
+#ifdef MIP_USE_SSE
+        if (simd) {
+            __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(level + i * 4),_mm_setzero_ps()),_mm_set1_ps(1.0f));
+            __m128 scaled = _mm_add_ps(_mm_mul_ps(clamped,_mm_setr_ps(color_scale,color_scale,color_scale,255.0f)),_mm_set1_ps(0.5f));
+            _mm_storeu_si128((__m128i*)value,_mm_cvttps_epi32(scaled));
+        }
+        else
+#endif
+        {
+            for (int c = 0; c < 4; c++) {
+                float clamped = level[i * 4 + c] < 0.0f ? 0.0f : level[i * 4 + c] > 1.0f ? 1.0f : level[i * 4 + c];
+                value[c] = (int)(clamped * (c == 3 ? 255.0f : color_scale) + 0.5f);
+            }
+        }
+        if (srgb) {
+            for (int c = 0; c < 3; c++) value[c] = to_srgb[value[c]];
+        }
+        unsigned char* texel = out + i * channels;
+        if (channels < 3) {
+            texel[0] = (unsigned char)value[0];
+            if (channels == 2) texel[1] = (unsigned char)value[3];
+        }
+        else {
+            for (int c = 0; c < channels; c++) texel[c] = (unsigned char)value[c];
+        }
+    }
+}
+
+static bool generate(Texture_Image& image, const Mip_Options& options, bool simd) {
+    if (image.data == NULL || image.compressed_format != 0 || image.mip_levels > 1 ||
+        image.channels < 1 || image.channels > 4) {
+        return false;
+    }
+    tables();
+    int channels = image.channels, threads = options.num_threads;
+    int width = image.width, height = image.height;
+    size_t bytes = mip_chain_bytes(width,height,channels);
+    unsigned char* chain = (unsigned char*)malloc(bytes);
+    if (chain == NULL) return false;
+    memcpy(chain,image.data,(size_t)width * height * channels);
+
+    std::vector<float> level((size_t)width * height * 4), next, pass;
+    parallel_rows(height,width * height,threads,[&](int begin, int end) {
+        load_linear(image,options.srgb,&level[0],begin,end);
+    });
+    size_t offset = (size_t)width * height * channels;
+    int levels = mip_level_count(width,height);
+    for (int l = 1; l < levels; l++) {
+        int out_width = width > 1 ? width / 2 : 1, out_height = height > 1 ? height / 2 : 1;
+        next.resize((size_t)out_width * out_height * 4);
+        if (options.filter == MIP_FILTER_KAISER) {
+            //Along the rows into pass (out_width x height), then down the columns into next
+            pass.resize((size_t)out_width * height * 4);
+            parallel_rows(height,out_width * height,threads,[&](int begin, int end) {
+                kaiser_rows(&level[0],width,4,(size_t)width * 4,&pass[0],out_width,4,(size_t)out_width * 4,begin,end,simd);
+            });
+            parallel_rows(out_width,out_width * out_height,threads,[&](int begin, int end) {
+                kaiser_rows(&pass[0],height,(size_t)out_width * 4,4,&next[0],out_height,(size_t)out_width * 4,4,begin,end,simd);
+            });
+        }
+        else {
+            parallel_rows(out_height,out_width * out_height,threads,[&](int begin, int end) {
+                box_rows(&level[0],width,height,&next[0],out_width,begin,end,simd);
+            });
+        }
+        parallel_rows(out_height,out_width * out_height,threads,[&](int begin, int end) {
+            store_rows(&next[0],out_width,channels,options.srgb,chain + offset,begin,end,simd);
+        });
+        offset += (size_t)out_width * out_height * channels;
+        level.swap(next);
+        width = out_width;
+        height = out_height;
+    }
+
+    free_texture_image(image);
+    image.data = chain;
+    image.mip_levels = levels;
+    image.data_bytes = bytes;
+    return true;
+}
+
+bool generate_mip_chain(Texture_Image& image, const Mip_Options& options) {
+#ifdef MIP_USE_SSE
+    return generate(image,options,true);
+#else
+    return generate(image,options,false);
+#endif
+}
+
+bool generate_mip_chain_scalar(Texture_Image& image, const Mip_Options& options) {
+    return generate(image,options,false);
+}
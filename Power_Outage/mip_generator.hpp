@@ -0,0 +1,36 @@
+#ifndef MIP_GENERATOR_HPP
+#define MIP_GENERATOR_HPP
+
+#include <stddef.h>
+#include "build_shapes.hpp"
+
+//Downsampling filters of the mip generator:
+//  MIP_FILTER_BOX     each texel averages the 2x2 texels above it (what glGenerateMipmap does)
+//  MIP_FILTER_KAISER  a separable 6-tap Kaiser-windowed sinc per axis, sharper than the box
+//                     (the edges repeat the last row and column)
+enum Mip_Filter {MIP_FILTER_BOX, MIP_FILTER_KAISER};
+
+struct Mip_Options {
+    Mip_Filter filter = MIP_FILTER_BOX;
+    //Treat the color channels as sRGB: filter in linear light and convert back, so darker
+    //levels do not drift darker than the image (alpha is always linear)
+    bool srgb = true;
+    //Threads sharing the rows of each large level (1 = the calling thread only).  Callers
+    //that already spread images over workers (Asset_Loader) keep this at 1.
+    int num_threads = 1;
+};
+
+//Levels of a full chain for a width x height image, down to 1x1
+int mip_level_count(int width, int height);
+//Bytes of the whole chain of 8-bit texels with the given channel count, levels back to back
+size_t mip_chain_bytes(int width, int height, int channels);
+
+//Replaces the decoded pixels of image with its full mip chain: every level from the image
+//itself down to 1x1, back to back with no row padding (mip_levels and data_bytes are set).
+//Levels are computed in floating point from the level above.  Uses SSE where the compiler
+//targets it.  Returns false (leaving image as it was) for compressed or empty images.
+bool generate_mip_chain(Texture_Image& image, const Mip_Options& options = Mip_Options());
+//The plain one-channel-at-a-time version (for comparison in benchmarks)
+bool generate_mip_chain_scalar(Texture_Image& image, const Mip_Options& options = Mip_Options());
+
+#endif //MIP_GENERATOR_HPP
@@ -1,28 +1,42 @@
 #include "moving_key.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_cache.hpp"
+#include "input_replay.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 
-MovingKey::MovingKey(Shape_Struct s,glm::vec3 scale,glm::vec3 pos,float orient) : Shape(s) {
-    this->position = pos;
-    this->scale_vec = scale;
-    this->orientation = orient;
-    this->rotation = 0.0f;
+MovingKey::MovingKey(Shape_Struct s,glm::vec3 scale,glm::vec3 pos,float orient)
+    : Shape(s), transform(pos,glm::vec3(0.0f),scale,orient) {
+}
+
+MovingKey::~MovingKey() {
+    Texture_Cache::release(this->texture);
 }
 
 void MovingKey::set_texture(unsigned int texture) {
+    Texture_Cache::retain(texture);
+    Texture_Cache::release(this->texture);
     this->texture = texture;
 }
 
+void MovingKey::set_atlas_region(const Atlas_Region& region) {
+    atlas_region = region;
+}
+
 void MovingKey::set_shader(Shader* shader_program) {
     this->shader_program = shader_program;
     original_shader = shader_program;
 }
 
 void MovingKey::set_scale(glm::vec3 scale_vec) {
-    this->scale_vec = scale_vec;
+    transform.set_scale(scale_vec);
 }
 
 glm::vec3 MovingKey::get_position() {
-    return position;
+    return transform.get_position();
+}
+
+AABB MovingKey::get_world_bounds() {
+    return aabb_transform(get_bounds(),transform.get_world_matrix());
 }
 
 void MovingKey::draw(Shader *optional_shader) {
@@ -31,67 +45,52 @@ void MovingKey::draw(Shader *optional_shader) {
     //Draw key to default position until collected
     if (!collected && !first_collect) {
         shader_program->use();
-        glm::mat4 shape_trans(1.0f);
-        shape_trans = glm::translate(shape_trans, this->position);
-        shape_trans = glm::rotate(shape_trans,glm::radians(this->rotation),glm::vec3(0.0,1.0,0.0));
-        shape_trans = glm::scale(shape_trans,this->scale_vec);
-        shape_trans = glm::rotate(shape_trans,glm::radians(this->orientation),glm::vec3(0.0,1.0,0.0));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D,texture);
-        shader_program->setMat4("model",shape_trans);
-        shader_program->setBool("use_texture",true);
-        Shape::draw(shader_program->ID);
-        shader_program->setBool("use_texture",false);
+        if (atlas_region.layer >= 0) set_atlas_uniforms(shader_program,atlas_region);
+        else GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,texture);
+        shader_program->setMat4(shader_program->draw_uniforms.model,transform.get_world_matrix());
+        shader_program->setBool(shader_program->draw_uniforms.use_texture,true);
+        Shape::draw(shader_program);
+        shader_program->setBool(shader_program->draw_uniforms.use_texture,false);
+        if (atlas_region.layer >= 0) shader_program->setBool(shader_program->draw_uniforms.use_atlas,false);
     }
     //Once collected, do not draw key again until inserted
     if (inserted) {
-        position = glm::vec3(6.14f,-2.85f,0.0f);
+        //Standing in the keyhole (no-ops after the first frame, so the matrix stays cached)
+        transform.set_position(glm::vec3(6.14f,-2.85f,0.0f));
+        transform.set_rotation(glm::vec3(90.0f,-90.0f,0.0f));
         shader_program->use();
-        glm::mat4 shape_trans(1.0f);
-        shape_trans = glm::translate(shape_trans, this->position);
-        shape_trans = glm::rotate(shape_trans,glm::radians(90.0f),glm::vec3(1.0,0.0,0.0));
-        shape_trans = glm::rotate(shape_trans,glm::radians(-90.0f),glm::vec3(0.0,1.0,0.0));
-        shape_trans = glm::scale(shape_trans,this->scale_vec);
-        shape_trans = glm::rotate(shape_trans,glm::radians(this->orientation),glm::vec3(0.0,1.0,0.0));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D,texture);
-        shader_program->setMat4("model",shape_trans);
-        shader_program->setBool("use_texture",true);
-        Shape::draw(shader_program->ID);
-        shader_program->setBool("use_texture",false);
+        if (atlas_region.layer >= 0) set_atlas_uniforms(shader_program,atlas_region);
+        else GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,texture);
+        shader_program->setMat4(shader_program->draw_uniforms.model,transform.get_world_matrix());
+        shader_program->setBool(shader_program->draw_uniforms.use_texture,true);
+        Shape::draw(shader_program);
+        shader_program->setBool(shader_program->draw_uniforms.use_texture,false);
+        if (atlas_region.layer >= 0) shader_program->setBool(shader_program->draw_uniforms.use_atlas,false);
     }
 }
 
-void MovingKey::process_input(GLFWwindow *win, glm::vec3 camera_pos) {
+void MovingKey::process_input(GLFWwindow *win, bool near_key, bool near_keyhole) {
     //Only pick up key if close enough
     if (!collected || inserted) {
-        float dist_to_key = glm::length(camera_pos-this->position);
-        bool within_range1 = false;
-        if (dist_to_key < key_range) within_range1 = true;
-
         //Press 'K' to collect key
-        if (glfwGetKey(win,GLFW_KEY_C)==GLFW_PRESS && within_range1 && collect_flag) {
+        if (Input_Replay::get_key(win,GLFW_KEY_C)==GLFW_PRESS && near_key && collect_flag) {
             first_collect = true;
             collect_flag = false;
             collected = true;
             inserted = false;
         }
-        if (glfwGetKey(win,GLFW_KEY_C)==GLFW_RELEASE) {
+        if (Input_Replay::get_key(win,GLFW_KEY_C)==GLFW_RELEASE) {
             collect_flag = true;
         }
     }
     if (collected && !inserted) {
-        float dist_to_keyhole = glm::length(camera_pos-glm::vec3(5.7f,-3.7f,2.1f));
-        bool within_range2 = false;
-        if (dist_to_keyhole < keyhole_range) within_range2 = true;
-
         //Press 'K' to insert key
-        if (glfwGetKey(win,GLFW_KEY_C)==GLFW_PRESS && within_range2 && insert_flag) {
+        if (Input_Replay::get_key(win,GLFW_KEY_C)==GLFW_PRESS && near_keyhole && insert_flag) {
             insert_flag = false;
             inserted = true;
             collected = false;
         }
-        if (glfwGetKey(win,GLFW_KEY_C)==GLFW_RELEASE) {
+        if (Input_Replay::get_key(win,GLFW_KEY_C)==GLFW_RELEASE) {
             insert_flag = true;
         }
     }
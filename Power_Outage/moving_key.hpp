@@ -8,31 +8,34 @@
 #include <iostream>
 #include <vector>
 #include "shape.hpp"
+#include "texture_atlas.hpp"
+#include "transform.hpp"
 
 class MovingKey: public Shape {
     protected:
-        //rotation about the y-axis
-        float rotation;
-        //initial orientation (ensures we start at right point)
-        float orientation;
-        //scale vector
-        glm::vec3 scale_vec;
-        //position vector
-        glm::vec3 position;
-        //plate texture
-        unsigned int texture;
+        //position, rotation about the y-axis, scale and initial orientation (ensures we start
+        //at right point); the model matrix is only rebuilt when one of them changes
+        Transform transform;
+        //key texture (the object holds a Texture_Cache reference to it)
+        unsigned int texture = 0;
+        //region of the models' atlas drawn instead of texture (layer -1: none)
+        Atlas_Region atlas_region;
         //shader program
         Shader* shader_program;
     public:
         MovingKey(Shape_Struct s, glm::vec3 scale, glm::vec3 pos, float orient);
-        void process_input(GLFWwindow *win, glm::vec3 camera_pos);
+        ~MovingKey();
+        //near_key/near_keyhole: the player is inside the key's or the keyhole's trigger
+        //(see World::setup_triggers)
+        void process_input(GLFWwindow *win, bool near_key, bool near_keyhole);
         void draw(Shader *optional_shader);
         glm::vec3 get_position();
+        //World-space box around the shape where it is currently placed
+        AABB get_world_bounds();
         void set_texture(unsigned int texture);
+        void set_atlas_region(const Atlas_Region& region);
         void set_shader(Shader* shader_program);
         void set_scale(glm::vec3 scale_vec);
-        float key_range = 2.5f;
-        float keyhole_range = 4.0f;
         bool first_collect = false;
         bool collected = false;
         bool inserted = false;
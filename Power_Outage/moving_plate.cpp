@@ -1,30 +1,40 @@
 #include "moving_plate.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_cache.hpp"
+#include "input_replay.hpp"
 #include <glm/gtc/matrix_transform.hpp>
 
 //Constants
 bool plate_press_once = true;
 
 MovingPlate::MovingPlate(Shape_Struct s,glm::vec3 scale,glm::vec3 pos,float orient) : Shape(s) {
-    this->position = pos;
     this->original_position = pos;
-    this->scale_vec = scale;
-    this->orientation = orient;
-    this->rotation = 0.0f;
+    this->transform = Transform(pos,glm::vec3(0.0f),scale,orient);
     this->is_pressed = false;
     this->status_flag = false;
 }
 
+MovingPlate::~MovingPlate() {
+    Texture_Cache::release(this->texture);
+}
+
 void MovingPlate::set_texture(unsigned int texture) {
+    Texture_Cache::retain(texture);
+    Texture_Cache::release(this->texture);
     this->texture = texture;
 }
 
+void MovingPlate::set_atlas_region(const Atlas_Region& region) {
+    atlas_region = region;
+}
+
 void MovingPlate::set_shader(Shader* shader_program) {
     this->shader_program = shader_program;
     original_shader = shader_program;
 }
 
 void MovingPlate::set_scale(glm::vec3 scale_vec) {
-    this->scale_vec = scale_vec;
+    transform.set_scale(scale_vec);
 }
 
 bool MovingPlate::get_plate_status() {
@@ -32,42 +42,39 @@ bool MovingPlate::get_plate_status() {
 }
 
 glm::vec3 MovingPlate::get_position() {
-    return position;
+    return transform.get_position();
+}
+
+AABB MovingPlate::get_world_bounds() {
+    return aabb_transform(get_bounds(),transform.get_world_matrix());
 }
 
 void MovingPlate::draw(Shader *optional_shader) {
     if (optional_shader != NULL) this->shader_program = optional_shader;
     else this->shader_program = original_shader;
     shader_program->use();
-    glm::mat4 shape_trans(1.0f);
-    shape_trans = glm::translate(shape_trans, this->position);
-    shape_trans = glm::rotate(shape_trans,glm::radians(this->rotation),glm::vec3(0.0,1.0,0.0));
-    shape_trans = glm::scale(shape_trans,this->scale_vec);
-    shape_trans = glm::rotate(shape_trans,glm::radians(this->orientation),glm::vec3(0.0,1.0,0.0));
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D,texture);
-    shader_program->setMat4("model",shape_trans);
-    shader_program->setBool("use_texture",true);
-    Shape::draw(shader_program->ID);
-    shader_program->setBool("use_texture",false);
+    if (atlas_region.layer >= 0) set_atlas_uniforms(shader_program,atlas_region);
+    else GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,texture);
+    shader_program->setMat4(shader_program->draw_uniforms.model,transform.get_world_matrix());
+    shader_program->setBool(shader_program->draw_uniforms.use_texture,true);
+    Shape::draw(shader_program);
+    shader_program->setBool(shader_program->draw_uniforms.use_texture,false);
+    if (atlas_region.layer >= 0) shader_program->setBool(shader_program->draw_uniforms.use_atlas,false);
 }
 
-void MovingPlate::process_input(GLFWwindow *win, glm::vec3 camera_pos) {
+void MovingPlate::process_input(GLFWwindow *win, bool within_range) {
     //Only turn on light if standing on pressure plate
-    float dist_to_plate = glm::length(camera_pos-this->position);
-    bool within_range = false;
-    if (dist_to_plate < range) within_range = true;
-
     //Step over plate to turn on light; press space to keep it pressed
     if (within_range) {
         this->is_pressed = true;
-        if (glfwGetKey(win,GLFW_KEY_SPACE)==GLFW_PRESS && plate_press_once) {
+        if (Input_Replay::get_key(win,GLFW_KEY_SPACE)==GLFW_PRESS && plate_press_once) {
             this->status_flag = !this->status_flag;
             plate_press_once = false;
         }
-        if (glfwGetKey(win,GLFW_KEY_SPACE)==GLFW_RELEASE) plate_press_once = true;
+        if (Input_Replay::get_key(win,GLFW_KEY_SPACE)==GLFW_RELEASE) plate_press_once = true;
     }
     if (!within_range && !status_flag) this->is_pressed = false;    
-    if (this->is_pressed) this->position = glm::vec3(this->position.x,-4.03,this->position.z);
-    else this->position = this-> original_position;
+    //Only a change of state rebuilds the model matrix
+    if (this->is_pressed) transform.set_position(glm::vec3(original_position.x,-4.03,original_position.z));
+    else transform.set_position(original_position);
 }
\ No newline at end of file
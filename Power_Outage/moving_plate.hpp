@@ -8,37 +8,40 @@
 #include <iostream>
 #include <vector>
 #include "shape.hpp"
+#include "texture_atlas.hpp"
+#include "transform.hpp"
 
 class MovingPlate: public Shape {
     protected:
-        //rotation about the y-axis
-        float rotation;
-        //initial orientation (ensures we start at right point)
-        float orientation;
-        //scale vector
-        glm::vec3 scale_vec;
-        //position vector
-        glm::vec3 position;
+        //position, rotation about the y-axis, scale and initial orientation (ensures we start
+        //at right point); the model matrix is only rebuilt when one of them changes
+        Transform transform;
         //original position vector
         glm::vec3 original_position;
         //boolean: if plate is pressed
         bool is_pressed;
         //boolean: plate's static status (default is off)
         bool status_flag;
-        //plate texture
-        unsigned int texture;
+        //plate texture (the object holds a Texture_Cache reference to it)
+        unsigned int texture = 0;
+        //region of the models' atlas drawn instead of texture (layer -1: none)
+        Atlas_Region atlas_region;
         //shader program
         Shader* shader_program;
     public:
         MovingPlate(Shape_Struct s, glm::vec3 scale, glm::vec3 pos, float orient);
-        void process_input(GLFWwindow *win, glm::vec3 camera_pos);
+        ~MovingPlate();
+        //within_range: the player is inside the plate's trigger (see World::setup_triggers)
+        void process_input(GLFWwindow *win, bool within_range);
         void draw(Shader *optional_shader);
         bool get_plate_status();
         glm::vec3 get_position();
+        //World-space box around the shape where it is currently placed
+        AABB get_world_bounds();
         void set_texture(unsigned int texture);
+        void set_atlas_region(const Atlas_Region& region);
         void set_shader(Shader* shader_program);
         void set_scale(glm::vec3 scale_vec);
-        double range = 1.2;
         Shader* original_shader;
 };
 
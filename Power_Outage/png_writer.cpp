@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+#include "png_writer.hpp"
+
+//Largest stored (uncompressed) deflate block
+#define DEFLATE_STORED_MAX 65535
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+  static uint32_t table[256];
+  static bool table_ready = false;
+  if (!table_ready) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    table_ready = true;
+  }
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void put_u32(std::vector<unsigned char>& out, uint32_t value) {
+  out.push_back(value >> 24);
+  out.push_back(value >> 16);
+  out.push_back(value >> 8);
+  out.push_back(value);
+}
+
+static void write_chunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+  std::vector<unsigned char> chunk;
+  put_u32(chunk,data.size());
+  chunk.insert(chunk.end(),type,type + 4);
+  chunk.insert(chunk.end(),data.begin(),data.end());
+  //The CRC covers the type and the data, not the length
+  put_u32(chunk,crc32(chunk.data() + 4,chunk.size() - 4));
+  file.write((const char*)chunk.data(),chunk.size());
+}
+
+bool write_png(const std::string& path, int width, int height, int channels,
+               const unsigned char* pixels, bool flip_y) {
+  if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+    std::cout << "ERROR: cannot write a " << width << "x" << height << "x" << channels << " PNG" << std::endl;
+    return false;
+  }
+  std::ofstream file(path.c_str(),std::ios::binary);
+  if (!file.is_open()) {
+    std::cout << "ERROR: could not write " << path << std::endl;
+    return false;
+  }
+
+  //Every row starts with its filter type (0, none)
+  size_t row_size = (size_t)width * channels;
+  std::vector<unsigned char> raw;
+  raw.reserve((row_size + 1) * height);
+  for (int y = 0; y < height; y++) {
+    const unsigned char* row = pixels + row_size * (flip_y ? height - 1 - y : y);
+    raw.push_back(0);
+    raw.insert(raw.end(),row,row + row_size);
+  }
+
+  //zlib stream of stored deflate blocks
+  std::vector<unsigned char> idat;
+  idat.push_back(0x78);
+  idat.push_back(0x01);
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < raw.size(); i++) {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  for (size_t start = 0; start < raw.size() || start == 0; start += DEFLATE_STORED_MAX) {
+    size_t size = std::min((size_t)DEFLATE_STORED_MAX,raw.size() - start);
+    bool last = start + size >= raw.size();
+    idat.push_back(last ? 1 : 0);
+    idat.push_back(size & 0xFF);
+    idat.push_back(size >> 8);
+    idat.push_back(~size & 0xFF);
+    idat.push_back((~size >> 8) & 0xFF);
+    idat.insert(idat.end(),raw.begin() + start,raw.begin() + start + size);
+    if (last) break;
+  }
+  put_u32(idat,(b << 16) | a);
+
+  std::vector<unsigned char> header;
+  put_u32(header,width);
+  put_u32(header,height);
+  header.push_back(8);                      //bit depth
+  header.push_back(channels == 4 ? 6 : 2);  //color type: RGBA or RGB
+  header.push_back(0);                      //deflate
+  header.push_back(0);                      //adaptive filtering
+  header.push_back(0);                      //no interlace
+
+  static const unsigned char signature[8] = {0x89,'P','N','G','\r','\n',0x1A,'\n'};
+  file.write((const char*)signature,8);
+  write_chunk(file,"IHDR",header);
+  write_chunk(file,"IDAT",idat);
+  write_chunk(file,"IEND",std::vector<unsigned char>());
+  if (!file.good()) {
+    std::cout << "ERROR: could not write " << path << std::endl;
+    return false;
+  }
+  return true;
+}
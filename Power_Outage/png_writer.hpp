@@ -0,0 +1,13 @@
+#ifndef PNG_WRITER_HPP
+#define PNG_WRITER_HPP
+
+#include <string>
+
+//Writes 8-bit RGB or RGBA pixels (channels 3 or 4, rows packed) as a PNG.  The image data is
+//stored uncompressed, which keeps the writer small at the cost of file size; it is meant for
+//frame captures, not assets.  flip_y writes the rows bottom-up, as glReadPixels returns them.
+//Prints an error and returns false if the file cannot be written.
+bool write_png(const std::string& path, int width, int height, int channels,
+               const unsigned char* pixels, bool flip_y = false);
+
+#endif //PNG_WRITER_HPP
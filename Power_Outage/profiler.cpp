@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include "profiler.hpp"
+
+bool Profiler::enabled = true;
+unsigned int Profiler::dropped_gpu_frames = 0;
+bool Profiler::gpu_timing = false;
+unsigned long long Profiler::frame_index = 0;
+Profiler::Frame_Data Profiler::frames[PROFILER_GPU_FRAMES];
+std::vector<Profiler::Series> Profiler::series;
+std::map<std::string,int> Profiler::series_index;
+std::vector<int> Profiler::open_scopes;
+std::vector<int> Profiler::open_gpu_scopes;
+bool Profiler::segment_open = false;
+std::vector<Profiler::Trace_Event> Profiler::trace;
+size_t Profiler::trace_start = 0;
+
+void Rolling_History::add(float value) {
+  if ((int)values.size() < PROFILER_HISTORY) {
+    values.push_back(value);
+    return;
+  }
+  values[next] = value;
+  next = (next + 1) % PROFILER_HISTORY;
+}
+
+Profile_Summary Rolling_History::summary() const {
+  Profile_Summary summary;
+  if (values.empty()) return summary;
+  std::vector<float> sorted(values);
+  std::sort(sorted.begin(),sorted.end());
+  double total = 0.0;
+  for (size_t i = 0; i < sorted.size(); i++) total += sorted[i];
+  summary.min = sorted.front();
+  summary.avg = total / sorted.size();
+  //Nearest-rank percentile
+  size_t rank = (size_t)(0.99 * sorted.size() + 0.999999);
+  summary.p99 = sorted[std::max((size_t)1,rank) - 1];
+  summary.samples = sorted.size();
+  return summary;
+}
+
+int Rolling_History::size() const {
+  return values.size();
+}
+
+void Rolling_History::clear() {
+  values.clear();
+  next = 0;
+}
+
+double Profiler::now_us() {
+  static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::init_gpu() {
+  //GL_TIME_ELAPSED is core since 3.3; anything older reports a version we can check
+  GLint major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION,&major);
+  glGetIntegerv(GL_MINOR_VERSION,&minor);
+  gpu_timing = major > 3 || (major == 3 && minor >= 3);
+  if (!gpu_timing) std::cout << "ERROR: Profiler needs OpenGL 3.3 timer queries, GPU times are off" << std::endl;
+}
+
+void Profiler::begin_frame() {
+  if (!open_scopes.empty()) {
+    std::cout << "ERROR: Profiler frame started with " << open_scopes.size() << " scopes open" << std::endl;
+    open_scopes.clear();
+    open_gpu_scopes.clear();
+    if (segment_open) end_segment();
+  }
+  frame_index++;
+  Frame_Data& frame = frames[frame_index % PROFILER_GPU_FRAMES];
+  if (gpu_timing) resolve(frame);
+  frame.records.clear();
+  frame.segments.clear();
+  frame.queries_used = 0;
+}
+
+int Profiler::find_series(const char* name, int depth) {
+  std::map<std::string,int>::iterator found = series_index.find(name);
+  if (found != series_index.end()) return found->second;
+  Series entry;
+  entry.name = name;
+  entry.depth = depth;
+  series.push_back(entry);
+  series_index[name] = series.size() - 1;
+  return series.size() - 1;
+}
+
+void Profiler::start_segment(int record) {
+  Frame_Data& frame = frames[frame_index % PROFILER_GPU_FRAMES];
+  if (frame.queries_used == (int)frame.queries.size()) {
+    unsigned int query;
+    glGenQueries(1,&query);
+    frame.queries.push_back(query);
+  }
+  Gpu_Segment segment;
+  segment.query = frame.queries[frame.queries_used++];
+  segment.record = record;
+  frame.segments.push_back(segment);
+  glBeginQuery(GL_TIME_ELAPSED,segment.query);
+  segment_open = true;
+}
+
+void Profiler::end_segment() {
+  glEndQuery(GL_TIME_ELAPSED);
+  segment_open = false;
+}
+
+int Profiler::begin_scope(const char* name, bool gpu) {
+  if (!enabled) return -1;
+  Frame_Data& frame = frames[frame_index % PROFILER_GPU_FRAMES];
+  Scope_Record record;
+  record.series = find_series(name,open_scopes.size());
+  record.parent = open_scopes.empty() ? -1 : open_scopes.back();
+  record.gpu = gpu && gpu_timing;
+  record.gpu_ms = 0.0;
+  record.end_us = 0.0;
+  frame.records.push_back(record);
+  int index = frame.records.size() - 1;
+  open_scopes.push_back(index);
+  if (record.gpu) {
+    if (segment_open) end_segment();
+    start_segment(index);
+    open_gpu_scopes.push_back(index);
+  }
+  //Read the clock last so the bookkeeping above is not charged to the scope
+  frame.records[index].start_us = now_us();
+  return index;
+}
+
+void Profiler::end_scope(int index) {
+  double end_us = now_us();
+  Frame_Data& frame = frames[frame_index % PROFILER_GPU_FRAMES];
+  if (index < 0 || index >= (int)frame.records.size() || open_scopes.empty() || open_scopes.back() != index) return;
+  open_scopes.pop_back();
+  Scope_Record& record = frame.records[index];
+  record.end_us = end_us;
+  float cpu_ms = (end_us - record.start_us) / 1000.0;
+  series[record.series].cpu.add(cpu_ms);
+  add_trace_event(record.series,0,record.start_us,end_us - record.start_us);
+  if (record.gpu) {
+    end_segment();
+    open_gpu_scopes.pop_back();
+    //The parent's query continues where the child's stopped
+    if (!open_gpu_scopes.empty()) start_segment(open_gpu_scopes.back());
+  }
+}
+
+void Profiler::resolve(Frame_Data& frame) {
+  if (frame.segments.empty()) return;
+  //Queries finish in order, so if the last one is done they all are
+  GLint available = 0;
+  glGetQueryObjectiv(frame.segments.back().query,GL_QUERY_RESULT_AVAILABLE,&available);
+  if (!available) {
+    dropped_gpu_frames++;
+    return;
+  }
+  for (size_t i = 0; i < frame.segments.size(); i++) {
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(frame.segments[i].query,GL_QUERY_RESULT,&nanoseconds);
+    double ms = nanoseconds / 1000000.0;
+    for (int r = frame.segments[i].record; r >= 0; r = frame.records[r].parent) {
+      if (frame.records[r].gpu) frame.records[r].gpu_ms += ms;
+    }
+  }
+  for (size_t i = 0; i < frame.records.size(); i++) {
+    const Scope_Record& record = frame.records[i];
+    if (!record.gpu || record.end_us == 0.0) continue;
+    series[record.series].gpu.add(record.gpu_ms);
+    add_trace_event(record.series,1,record.start_us,record.gpu_ms * 1000.0);
+  }
+}
+
+void Profiler::add_trace_event(int series, int track, double start_us, double duration_us) {
+  Trace_Event event;
+  event.series = series;
+  event.track = track;
+  event.start_us = start_us;
+  event.duration_us = duration_us;
+  if (trace.size() < PROFILER_TRACE_EVENTS) {
+    trace.push_back(event);
+    return;
+  }
+  trace[trace_start] = event;
+  trace_start = (trace_start + 1) % PROFILER_TRACE_EVENTS;
+}
+
+std::vector<std::string> Profiler::get_scope_names() {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < series.size(); i++) names.push_back(series[i].name);
+  return names;
+}
+
+const Rolling_History* Profiler::get_cpu_history(const std::string& name) {
+  std::map<std::string,int>::iterator found = series_index.find(name);
+  if (found == series_index.end()) return NULL;
+  return &series[found->second].cpu;
+}
+
+const Rolling_History* Profiler::get_gpu_history(const std::string& name) {
+  std::map<std::string,int>::iterator found = series_index.find(name);
+  if (found == series_index.end()) return NULL;
+  return &series[found->second].gpu;
+}
+
+std::vector<std::string> Profiler::summary_lines() {
+  std::vector<std::string> lines;
+  char buffer[160];
+  for (size_t i = 0; i < series.size(); i++) {
+    Profile_Summary cpu = series[i].cpu.summary();
+    std::string line(series[i].depth * 2,' ');
+    line += series[i].name;
+    snprintf(buffer,sizeof(buffer),"  cpu %.2f/%.2f/%.2f",cpu.min,cpu.avg,cpu.p99);
+    line += buffer;
+    if (series[i].gpu.size() > 0) {
+      Profile_Summary gpu = series[i].gpu.summary();
+      snprintf(buffer,sizeof(buffer),"  gpu %.2f/%.2f/%.2f",gpu.min,gpu.avg,gpu.p99);
+      line += buffer;
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+//Scope names are plain identifiers and phrases, but escape them anyway so the file always parses
+static std::string json_escape(const std::string& text) {
+  std::string escaped;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    }
+    else if ((unsigned char)c < 0x20) escaped += ' ';
+    else escaped += c;
+  }
+  return escaped;
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) {
+  std::ofstream file(path.c_str());
+  if (!file.is_open()) {
+    std::cout << "ERROR: Could not write profiler trace " << path << std::endl;
+    return false;
+  }
+  file << "{\"traceEvents\":[\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+  file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+  char buffer[64];
+  for (size_t i = 0; i < trace.size(); i++) {
+    const Trace_Event& event = trace[(trace_start + i) % trace.size()];
+    snprintf(buffer,sizeof(buffer),"\"ts\":%.3f,\"dur\":%.3f",event.start_us,event.duration_us);
+    file << ",\n{\"name\":\"" << json_escape(series[event.series].name) << "\",\"cat\":\""
+         << (event.track == 0 ? "cpu" : "gpu") << "\",\"ph\":\"X\"," << buffer
+         << ",\"pid\":1,\"tid\":" << event.track + 1 << "}";
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  std::cout << "Profiler trace written to " << path << " (" << trace.size() << " events)" << std::endl;
+  return true;
+}
+
+void Profiler::clear() {
+  for (size_t i = 0; i < series.size(); i++) {
+    series[i].cpu.clear();
+    series[i].gpu.clear();
+  }
+  trace.clear();
+  trace_start = 0;
+  dropped_gpu_frames = 0;
+  //Results still in flight belong to the frames being forgotten
+  for (int i = 0; i < PROFILER_GPU_FRAMES; i++) {
+    frames[i].records.clear();
+    frames[i].segments.clear();
+    frames[i].queries_used = 0;
+  }
+}
+
+Profile_Scope::Profile_Scope(const char* name, bool gpu) {
+  record = Profiler::begin_scope(name,gpu);
+}
+
+Profile_Scope::~Profile_Scope() {
+  Profiler::end_scope(record);
+}
@@ -0,0 +1,146 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//Frames of samples each scope keeps for its min/avg/p99
+#define PROFILER_HISTORY 240
+//Events kept for the Chrome trace (the oldest are dropped first)
+#define PROFILER_TRACE_EVENTS 200000
+//Sets of GPU queries in flight.  A frame's GL_TIME_ELAPSED results are read this many frames
+//later, by which time the GPU has finished them, so reading never stalls the pipeline.
+#define PROFILER_GPU_FRAMES 2
+
+//Milliseconds over the samples in a history
+struct Profile_Summary {
+    float min = 0.0f;
+    float avg = 0.0f;
+    float p99 = 0.0f;
+    int samples = 0;
+};
+
+//The last PROFILER_HISTORY samples of one value
+class Rolling_History {
+    public:
+        void add(float value);
+        Profile_Summary summary() const;
+        int size() const;
+        void clear();
+
+    private:
+        std::vector<float> values;
+        int next = 0;
+};
+
+//CPU and GPU time per named scope, over the last PROFILER_HISTORY frames.
+//
+//Scopes nest.  CPU time is wall-clock time between opening and closing the scope.  GPU time
+//comes from GL_TIME_ELAPSED queries, which cannot nest, so opening a child scope ends the
+//parent's query and closing it starts a new one: each query is charged to the innermost open
+//GPU scope and all of its parents.  Results are collected PROFILER_GPU_FRAMES frames later; a
+//frame whose queries are still not done is dropped from the GPU history instead of waited on.
+//
+//GPU timing is off until init_gpu() is called with a current context, so the profiler can also
+//be used from benchmarks and tools without one.
+class Profiler {
+    public:
+        //Turns GPU timing on if the context supports timer queries (GL 3.3 always does)
+        static void init_gpu();
+        //Starts a frame: collects the GPU results of the frame that used this query set.
+        //No scope may be open.
+        static void begin_frame();
+
+        //Use Profile_Scope rather than calling these directly.  name must outlive the profiler
+        //(a string literal).  Returns the scope's record for end_scope().
+        static int begin_scope(const char* name, bool gpu = true);
+        static void end_scope(int record);
+
+        //Every scope that has run, in the order they first ran
+        static std::vector<std::string> get_scope_names();
+        //History of the named scope (NULL if it never ran)
+        static const Rolling_History* get_cpu_history(const std::string& name);
+        static const Rolling_History* get_gpu_history(const std::string& name);
+        //One line per scope in the order they first ran, indented by nesting:
+        //  name  cpu min/avg/p99  gpu min/avg/p99 (ms)
+        static std::vector<std::string> summary_lines();
+
+        //Writes the recorded events in the Chrome trace event format (load it in
+        //chrome://tracing or Perfetto).  CPU scopes are on one track and GPU scopes on another;
+        //GPU events start when their scope was issued, since GL_TIME_ELAPSED only has durations.
+        static bool write_chrome_trace(const std::string& path);
+        //Forgets all history, trace events and GPU results still in flight (e.g. after
+        //warm-up frames).  No scope may be open.
+        static void clear();
+
+        static bool enabled;
+        //Frames whose GPU results were not ready in time
+        static unsigned int dropped_gpu_frames;
+
+    private:
+        struct Series {
+            std::string name;
+            int depth;
+            Rolling_History cpu;
+            Rolling_History gpu;
+        };
+        struct Scope_Record {
+            int series;
+            int parent;
+            double start_us;
+            double end_us;
+            bool gpu;
+            double gpu_ms;
+        };
+        //A GL_TIME_ELAPSED query charged to a scope record
+        struct Gpu_Segment {
+            unsigned int query;
+            int record;
+        };
+        //Everything one frame needs until its GPU results are in
+        struct Frame_Data {
+            std::vector<Scope_Record> records;
+            std::vector<Gpu_Segment> segments;
+            std::vector<unsigned int> queries;
+            int queries_used = 0;
+        };
+        struct Trace_Event {
+            int series;
+            int track;
+            double start_us;
+            double duration_us;
+        };
+
+        static double now_us();
+        static int find_series(const char* name, int depth);
+        static void start_segment(int record);
+        static void end_segment();
+        static void resolve(Frame_Data& frame);
+        static void add_trace_event(int series, int track, double start_us, double duration_us);
+
+        static bool gpu_timing;
+        static unsigned long long frame_index;
+        static Frame_Data frames[PROFILER_GPU_FRAMES];
+        static std::vector<Series> series;
+        static std::map<std::string,int> series_index;
+        static std::vector<int> open_scopes;
+        static std::vector<int> open_gpu_scopes;
+        static bool segment_open;
+        static std::vector<Trace_Event> trace;
+        static size_t trace_start;
+};
+
+//Times the enclosing block under a name (see Profiler), e.g.
+//  { Profile_Scope scope("shadow pass"); world.render_scene(...); }
+class Profile_Scope {
+    public:
+        Profile_Scope(const char* name, bool gpu = true);
+        ~Profile_Scope();
+
+    private:
+        int record;
+};
+
+#endif //PROFILER_HPP
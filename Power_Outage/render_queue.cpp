@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <iostream>
+#include "render_queue.hpp"
+#include "transform.hpp"
+
+int Render_Queue::add(Draw_Item item) {
+  if (item.shape == NULL || item.shader == NULL) {
+    std::cout << "ERROR: Render_Queue item needs a shape and a shader" << std::endl;
+    return -1;
+  }
+  items.push_back(item);
+  orders.clear();
+  world_bounds_valid = false;
+  return items.size() - 1;
+}
+
+Draw_Item* Render_Queue::get(int handle) {
+  if (handle < 0 || handle >= (int)items.size()) {
+    std::cout << "ERROR: Render_Queue has no item " << handle << std::endl;
+    return NULL;
+  }
+  //The caller may change the item's state, so sort again next time
+  orders.clear();
+  world_bounds_valid = false;
+  return &items[handle];
+}
+
+int Render_Queue::size() {
+  return items.size();
+}
+
+const std::vector<Draw_Item>& Render_Queue::get_items() {
+  return items;
+}
+
+uint64_t draw_sort_key(unsigned int framebuffer, unsigned int program, unsigned int texture, unsigned int vao) {
+  return ((uint64_t)(framebuffer & 0xFF) << 56) | ((uint64_t)(program & 0xFFFF) << 40) |
+         ((uint64_t)(texture & 0xFFFFF) << 20) | (uint64_t)(vao & 0xFFFFF);
+}
+
+const std::vector<int>& Render_Queue::get_order(unsigned int framebuffer, Shader* shadow_shader) {
+  for (size_t i = 0; i < orders.size(); i++) {
+    if (orders[i].framebuffer == framebuffer && orders[i].shadow_shader == shadow_shader) return orders[i].order;
+  }
+
+  std::vector<std::pair<uint64_t,int> > keyed;
+  std::vector<int> translucent;
+  for (size_t i = 0; i < items.size(); i++) {
+    const Draw_Item& item = items[i];
+    if (item.flags & DRAW_TRANSLUCENT) {
+      translucent.push_back(i);
+      continue;
+    }
+    Shader* shader = item.shader;
+    if (shadow_shader != NULL && (item.flags & DRAW_SHADOW_SHADER)) shader = shadow_shader;
+    keyed.push_back(std::make_pair(draw_sort_key(framebuffer,shader->ID,item.texture,item.shape->get_VAO()),(int)i));
+  }
+  //Ties keep registration order
+  std::stable_sort(keyed.begin(),keyed.end(),
+                   [](const std::pair<uint64_t,int>& a, const std::pair<uint64_t,int>& b) { return a.first < b.first; });
+
+  Pass_Order pass;
+  pass.framebuffer = framebuffer;
+  pass.shadow_shader = shadow_shader;
+  for (size_t i = 0; i < keyed.size(); i++) pass.order.push_back(keyed[i].second);
+  pass.order.insert(pass.order.end(),translucent.begin(),translucent.end());
+  orders.push_back(pass);
+  return orders.back().order;
+}
+
+void Render_Queue::update_world_bounds() {
+  world_bounds.resize(items.size());
+  for (size_t i = 0; i < items.size(); i++) {
+    const Draw_Item& item = items[i];
+    const AABB& local = (item.flags & DRAW_INSTANCED) ? item.shape->get_instance_bounds() : item.shape->get_bounds();
+    world_bounds[i] = aabb_empty(local) ? aabb_everything() : aabb_transform(local,item.model);
+  }
+  world_bounds_valid = true;
+}
+
+void Render_Queue::cull(const Frustum& frustum) {
+  if (!world_bounds_valid) update_world_bounds();
+  visible.resize(items.size());
+  if (items.empty()) return;
+  int num_visible = cull_boxes(frustum,world_bounds.data(),items.size(),visible.data());
+  cull_stats.visible += num_visible;
+  cull_stats.culled += items.size() - num_visible;
+}
+
+void Render_Queue::set_visible(const std::vector<int>& handles) {
+  visible.assign(items.size(),0);
+  int num_visible = 0;
+  for (size_t i = 0; i < handles.size(); i++) {
+    int handle = handles[i];
+    if (handle < 0 || handle >= (int)items.size() || visible[handle]) continue;
+    visible[handle] = 1;
+    num_visible++;
+  }
+  cull_stats.visible += num_visible;
+  cull_stats.culled += items.size() - num_visible;
+}
+
+const std::vector<AABB>& Render_Queue::get_world_bounds() {
+  if (!world_bounds_valid) update_world_bounds();
+  return world_bounds;
+}
+
+bool Render_Queue::is_visible(int handle) {
+  if (handle < 0 || handle >= (int)visible.size()) return true;
+  return visible[handle] != 0;
+}
+
+glm::mat4 place_model(glm::vec3 position, float y_rotation_degrees, glm::vec3 scale) {
+  Transform transform(position,glm::vec3(0.0f,y_rotation_degrees,0.0f),scale);
+  return transform.get_local_matrix();
+}
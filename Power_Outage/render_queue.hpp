@@ -0,0 +1,91 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+#include "shape.hpp"
+#include "Shader.hpp"
+#include "frustum.hpp"
+#include "texture_atlas.hpp"
+
+//Draw_Item flags
+//Sets use_texture to true for the draw (and back to false afterwards)
+#define DRAW_USE_TEXTURE 0x1
+//The shadow pass draws the item with the pass's depth shader instead of its own
+#define DRAW_SHADOW_SHADER 0x2
+//Resets the transform uniform to the identity before drawing
+#define DRAW_RESET_TRANSFORM 0x4
+//Uploads the shape's material (Shape::use_material) before drawing
+#define DRAW_USE_MATERIAL 0x8
+//Blended: drawn after every opaque item, in registration order, instead of being sorted by state
+#define DRAW_TRANSLUCENT 0x10
+//Draws every instance set on the shape (Shape::draw_instanced); model is applied to all of them
+#define DRAW_INSTANCED 0x20
+
+//Everything render_scene needs to draw one static object.  The model matrix is computed
+//once when the item is registered rather than every pass.
+struct Draw_Item {
+  Shape* shape = NULL;
+  Shader* shader = NULL;
+  //Bound to texture unit 0 before drawing (0 leaves the current binding alone)
+  unsigned int texture = 0;
+  //With DRAW_USE_TEXTURE, samples this region of the bound atlas instead (layer -1: not in one)
+  Atlas_Region atlas_region;
+  glm::mat4 model = glm::mat4(1.0f);
+  unsigned int flags = 0;
+};
+
+//Orders draws by the state they need, most expensive to change first:
+//framebuffer, program, texture, then VAO.  Ids wider than their field only cost sort quality.
+uint64_t draw_sort_key(unsigned int framebuffer, unsigned int program, unsigned int texture, unsigned int vao);
+
+//A flat array of draw items, registered once at setup.  Items are referred to by the
+//integer handle add() returns.
+class Render_Queue {
+  public:
+    //Registers an item and returns its handle.
+    int add(Draw_Item item);
+    //Returns the item for a handle (NULL if there is none), e.g. to move it or swap its texture.
+    Draw_Item* get(int handle);
+    int size();
+    const std::vector<Draw_Item>& get_items();
+
+    //Item indices in draw order for a pass into the given framebuffer: opaque items sorted by
+    //draw_sort_key (with the shadow shader substituted for DRAW_SHADOW_SHADER items), then the
+    //translucent ones.  The order is cached until the next add() or get().
+    const std::vector<int>& get_order(unsigned int framebuffer, Shader* shadow_shader = NULL);
+
+    //Tests every item's world-space box (its shape's bounds moved by its model matrix) against
+    //the frustum and counts the results in cull_stats.  is_visible() reports the latest result;
+    //items whose shape has no bounds are always visible.
+    void cull(const Frustum& frustum);
+    //Takes the visible items from elsewhere (e.g. a Spatial_Index query): exactly the given
+    //handles are visible.  Handles that are not items are ignored.
+    void set_visible(const std::vector<int>& handles);
+    bool is_visible(int handle);
+    //World-space boxes of the items, indexed by handle
+    const std::vector<AABB>& get_world_bounds();
+    Cull_Stats cull_stats;
+
+  private:
+    struct Pass_Order {
+      unsigned int framebuffer;
+      Shader* shadow_shader;
+      std::vector<int> order;
+    };
+
+    std::vector<Draw_Item> items;
+    std::vector<Pass_Order> orders;
+
+    //World-space boxes of the items, rebuilt after the next add() or get()
+    void update_world_bounds();
+    std::vector<AABB> world_bounds;
+    bool world_bounds_valid = false;
+    std::vector<unsigned char> visible;
+};
+
+//Builds the model matrix the scene uses for static objects: translate, then rotate about y, then scale.
+glm::mat4 place_model(glm::vec3 position, float y_rotation_degrees, glm::vec3 scale);
+
+#endif //RENDER_QUEUE_HPP
@@ -1,10 +1,24 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 lightSpaceMatrix;
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
+
 uniform mat4 model;
 
+//Packed vertices store integer positions inside the mesh bounding box
+uniform bool packed_vertices;
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
+
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
-}  
\ No newline at end of file
+    vec3 position = packed_vertices ? pos_offset + aPos * pos_scale : aPos;
+    gl_Position = lightSpaceMatrix * model * vec4(position, 1.0);
+}
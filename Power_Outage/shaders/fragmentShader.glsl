@@ -7,7 +7,6 @@ in vec3 normal_vector;
 in vec3 FragPos;
 in vec4 FragPosLightSpace;
 
-uniform vec4 view_position;
 uniform sampler2D depth_image;
 
 uniform bool use_set_color;
@@ -21,41 +20,53 @@ struct Material {
 
 struct PointLight {
   vec3 position;
+  float constant;
   vec3 ambient;
+  float linear;
   vec3 diffuse;
+  float quadratic;
   vec3 specular;
   bool on;
-  float constant;
-  float linear;
-  float quadratic;
 };
 
 struct SpotLight {
-  vec3 position;  
-  vec3 direction;
+  vec3 position;
   float cutOff;
+  vec3 direction;
   float outerCutOff;
   vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
   float constant;
+  vec3 diffuse;
   float linear;
+  vec3 specular;
   float quadratic;
   bool on;
 };
 
 struct DirLight {
   vec3 direction;
+  bool on;
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
-  bool on;
 };
 
 uniform Material material;
-uniform PointLight point_light;
-uniform SpotLight spot_light;
-uniform DirLight dir_light;
+//Per-frame lights shared by every program (members ordered to match std140 without padding)
+layout (std140) uniform FrameLights {
+  PointLight point_light;
+  SpotLight spot_light;
+  DirLight dir_light;
+};
+
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
 
 vec4 calc_point_light();
 vec4 calc_spot_light();
@@ -8,35 +8,35 @@ struct Material {
 
 struct PointLight {
   vec3 position;
-  vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
   float constant;
+  vec3 ambient;
   float linear;
+  vec3 diffuse;
   float quadratic;
+  vec3 specular;
   bool on;
 };
 
 struct SpotLight {
-  vec3 position;  
-  vec3 direction;
+  vec3 position;
   float cutOff;
+  vec3 direction;
   float outerCutOff;
   vec3 ambient;
-  vec3 diffuse;
-  vec3 specular;
   float constant;
+  vec3 diffuse;
   float linear;
+  vec3 specular;
   float quadratic;
   bool on;
 };
 
 struct DirLight {
   vec3 direction;
+  bool on;
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
-  bool on;
 };
 
 out vec4 FragColor;
@@ -49,13 +49,33 @@ in vec2 TexCoord;
 in vec4 FragPosLightSpace;
 
 Material material;
-uniform PointLight point_light;
-uniform SpotLight spot_light;
-uniform DirLight dir_light;
-uniform vec4 view_position;
+//Per-frame lights shared by every program (members ordered to match std140 without padding)
+layout (std140) uniform FrameLights {
+  PointLight point_light;
+  SpotLight spot_light;
+  DirLight dir_light;
+};
+
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
 uniform bool use_texture;
 uniform sampler2D texture_image;
 uniform sampler2D depth_image;
+//With use_atlas the texture is a region of a Texture_Atlas layer instead (texture_atlas.hpp):
+//rect.xy + fract(uv) * rect.zw repeats it the way GL_REPEAT repeats texture_image
+uniform bool use_atlas;
+uniform sampler2DArray atlas_image;
+uniform vec4 atlas_rect;
+uniform float atlas_layer;
+
+//The texel under this fragment when use_texture is on
+vec3 texture_color;
 
 vec3 calc_point_light(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 calc_spot_light(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
@@ -67,6 +87,16 @@ void main()
   material.ambient = fColor;
   material.diffuse = fColor;
   material.specular = sColor;
+  if (use_texture) {
+    if (use_atlas) {
+      //The mip level comes from the unwrapped coordinates: fract() jumps back where the
+      //texture repeats, which would read the smallest level along every seam
+      vec2 dx = dFdx(TexCoord) * atlas_rect.zw;
+      vec2 dy = dFdy(TexCoord) * atlas_rect.zw;
+      texture_color = textureGrad(atlas_image,vec3(atlas_rect.xy + fract(TexCoord) * atlas_rect.zw,atlas_layer),dx,dy).rgb;
+    }
+    else texture_color = texture(texture_image,TexCoord).rgb;
+  }
   vec3 norm = normalize(Normal);
 
   vec3 viewDir = normalize(view_position.xyz - FragPos);
@@ -100,9 +130,9 @@ vec3 calc_point_light(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
   vec3 ambient, diffuse, specular;
   
   if (use_texture) {
-    ambient = light.ambient*vec3(texture(texture_image,TexCoord));
-    diffuse = diff*light.diffuse*vec3(texture(texture_image,TexCoord));
-    specular = spec*light.specular*vec3(texture(texture_image,TexCoord));
+    ambient = light.ambient*texture_color;
+    diffuse = diff*light.diffuse*texture_color;
+    specular = spec*light.specular*texture_color;
   }
   else {
     ambient = material.ambient.xyz*light.ambient;
@@ -138,9 +168,9 @@ vec3 calc_spot_light(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
   vec3 ambient, diffuse, specular;
   
   if (use_texture) {
-    ambient = light.ambient*vec3(texture(texture_image,TexCoord));
-    diffuse = diff*light.diffuse*vec3(texture(texture_image,TexCoord));
-    specular = spec*light.specular*vec3(texture(texture_image,TexCoord));
+    ambient = light.ambient*texture_color;
+    diffuse = diff*light.diffuse*texture_color;
+    specular = spec*light.specular*texture_color;
   }
   else {
     ambient = material.ambient.xyz*light.ambient;
@@ -182,9 +212,9 @@ vec3 calc_dir_light(DirLight light, vec3 normal, vec3 viewDir) {
   // combine results
   vec3 ambient, diffuse, specular;
   if (use_texture) {
-    ambient = light.ambient*vec3(texture(texture_image,TexCoord));
-    diffuse = diff*light.diffuse*vec3(texture(texture_image,TexCoord));
-    specular = spec*light.specular*vec3(texture(texture_image,TexCoord));
+    ambient = light.ambient*texture_color;
+    diffuse = diff*light.diffuse*texture_color;
+    specular = spec*light.specular*texture_color;
   }
   else {
     ambient = material.ambient.xyz*light.ambient;
@@ -0,0 +1,84 @@
+#version 330 core
+//importVertexShader.glsl plus per-instance model matrices and color overrides, for Shape::draw_instanced
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec3 aNormal;
+layout (location = 3) in vec3 aColor;
+layout (location = 4) in vec3 specColor;
+layout (location = 5) in uint aMaterial;
+//Per-instance attributes (Shape::Instance_Data)
+layout (location = 6) in mat4 instanceModel;
+layout (location = 10) in vec4 instanceColor;
+layout (location = 11) in int instanceMaterial;
+
+out vec3 Normal;
+out vec3 FragPos;
+out vec3 fColor;
+out vec3 sColor;
+out vec2 TexCoord;
+out vec4 FragPosLightSpace;
+
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
+
+//Placed in front of every instance's own model matrix
+uniform mat4 model;
+
+//Packed vertices (ImportOBJ::PackedVertex): integer position/UV plus an octahedral
+//normal and an index into the material buffer (Kd, Ks texel pairs)
+uniform bool packed_vertices;
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
+uniform vec2 uv_offset;
+uniform vec2 uv_scale;
+uniform samplerBuffer material_buffer;
+
+vec3 oct_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 s = vec2(e.x < 0.0 ? -1.0 : 1.0, e.y < 0.0 ? -1.0 : 1.0);
+        n.xy = (1.0 - abs(e.yx)) * s;
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec2 texCoord = aTexCoord;
+    vec3 color = aColor;
+    vec3 specular = specColor;
+    if (packed_vertices) {
+        position = pos_offset + aPos * pos_scale;
+        normal = oct_decode(aNormal.xy / 32767.0);
+        texCoord = uv_offset + aTexCoord * uv_scale;
+        color = vec3(1.0, 1.0, 1.0);
+        specular = vec3(0.0, 0.0, 0.0);
+        if (aMaterial != 0xFFFFu) {
+            color = texelFetch(material_buffer, int(aMaterial) * 2).rgb;
+            specular = texelFetch(material_buffer, int(aMaterial) * 2 + 1).rgb;
+        }
+    }
+    //Recolor one material slot (packed vertices only) or, with slot -1, the whole instance
+    if (instanceColor.a > 0.0 && (instanceMaterial < 0 || (packed_vertices && int(aMaterial) == instanceMaterial))) {
+        color = instanceColor.rgb;
+    }
+    mat4 world = model * instanceModel;
+
+    gl_Position = projection*view*world * vec4(position, 1.0);
+    Normal = mat3(transpose(inverse(world)))*normal;
+    vec4 tempVec = world*vec4(position,1.0);
+    FragPos = vec3(tempVec.x, tempVec.y,tempVec.z);
+    fColor = vec3(color.x,color.y,color.z);
+    sColor = vec3(specular.x,specular.y,specular.z);
+    TexCoord = texCoord;
+    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos,1.0);
+}
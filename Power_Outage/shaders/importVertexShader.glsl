@@ -4,6 +4,7 @@ layout (location = 1) in vec2 aTexCoord;
 layout (location = 2) in vec3 aNormal;
 layout (location = 3) in vec3 aColor;
 layout (location = 4) in vec3 specColor;
+layout (location = 5) in uint aMaterial;
 
 out vec3 Normal;
 out vec3 FragPos;
@@ -12,19 +13,61 @@ out vec3 sColor;
 out vec2 TexCoord;
 out vec4 FragPosLightSpace;
 
-uniform mat4 view;
-uniform mat4 projection;
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
+
 uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+
+//Packed vertices (ImportOBJ::PackedVertex): integer position/UV plus an octahedral
+//normal and an index into the material buffer (Kd, Ks texel pairs)
+uniform bool packed_vertices;
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
+uniform vec2 uv_offset;
+uniform vec2 uv_scale;
+uniform samplerBuffer material_buffer;
+
+vec3 oct_decode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 s = vec2(e.x < 0.0 ? -1.0 : 1.0, e.y < 0.0 ? -1.0 : 1.0);
+        n.xy = (1.0 - abs(e.yx)) * s;
+    }
+    return normalize(n);
+}
 
 void main()
 {
-    gl_Position = projection*view*model * vec4(aPos, 1.0);
-    Normal = mat3(transpose(inverse(model)))*aNormal;
-    vec4 tempVec = model*vec4(aPos,1.0);
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    vec2 texCoord = aTexCoord;
+    vec3 color = aColor;
+    vec3 specular = specColor;
+    if (packed_vertices) {
+        position = pos_offset + aPos * pos_scale;
+        normal = oct_decode(aNormal.xy / 32767.0);
+        texCoord = uv_offset + aTexCoord * uv_scale;
+        color = vec3(1.0, 1.0, 1.0);
+        specular = vec3(0.0, 0.0, 0.0);
+        if (aMaterial != 0xFFFFu) {
+            color = texelFetch(material_buffer, int(aMaterial) * 2).rgb;
+            specular = texelFetch(material_buffer, int(aMaterial) * 2 + 1).rgb;
+        }
+    }
+
+    gl_Position = projection*view*model * vec4(position, 1.0);
+    Normal = mat3(transpose(inverse(model)))*normal;
+    vec4 tempVec = model*vec4(position,1.0);
     FragPos = vec3(tempVec.x, tempVec.y,tempVec.z);
-    fColor = vec3(aColor.x,aColor.y,aColor.z);
-    sColor = vec3(specColor.x,specColor.y,specColor.z);
-    TexCoord = aTexCoord;
+    fColor = vec3(color.x,color.y,color.z);
+    sColor = vec3(specular.x,specular.y,specular.z);
+    TexCoord = texCoord;
     FragPosLightSpace = lightSpaceMatrix * vec4(FragPos,1.0);
 }
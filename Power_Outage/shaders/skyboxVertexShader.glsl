@@ -1,14 +1,24 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-
+//One triangle over the whole screen, without vertex attributes (see Skybox::render)
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
 
 void main()
 {
-    TexCoords = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0);
-    gl_Position = pos.xyww;
-}  
\ No newline at end of file
+    //(-1,-1), (3,-1) and (-1,3) cover all of clip space
+    vec2 corner = vec2(gl_VertexID == 1 ? 3.0 : -1.0, gl_VertexID == 2 ? 3.0 : -1.0);
+    //On the far plane (z = w), behind everything the depth buffer holds
+    gl_Position = vec4(corner, 1.0, 1.0);
+    //The view ray through the corner: undo the projection, then the camera's rotation (its
+    //translation is left out so the sky stays centered on the camera)
+    vec4 ray = inverse(projection) * vec4(corner, 1.0, 1.0);
+    TexCoords = transpose(mat3(view)) * (ray.xyz / ray.w);
+}
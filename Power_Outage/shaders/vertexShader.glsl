@@ -4,9 +4,17 @@ layout (location = 1) in vec3 normal;
 
 uniform mat4 transform;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+//Per-frame camera data shared by every program (see frame_uniforms.hpp)
+layout (std140) uniform FrameCamera {
+  mat4 view;
+  mat4 projection;
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+  float time;
+};
+//Overlays (Text_Display) draw in their own orthographic space instead of the camera's
+uniform bool screen_space;
+uniform mat4 screen_projection;
 
 out vec3 FragPos;
 out vec3 normal_vector;
@@ -17,5 +25,6 @@ void main()
     normal_vector = mat3(transpose(inverse(model*transform))) * normal;
     FragPos = vec3(model*transform*vec4(aPos.x, aPos.y, aPos.z, 1.0));
     FragPosLightSpace = lightSpaceMatrix * vec4(FragPos,1.0);
-    gl_Position = projection*view*model*transform*vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    if (screen_space) gl_Position = screen_projection*model*transform*vec4(aPos.x, aPos.y, aPos.z, 1.0);
+    else gl_Position = projection*view*model*transform*vec4(aPos.x, aPos.y, aPos.z, 1.0);
 }
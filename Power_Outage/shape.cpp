@@ -1,11 +1,26 @@
+#include <stddef.h>
 #include "shape.hpp"
+#include "gl_state_cache.hpp"
 
 //define the functions declared in the Shape class
 
-Shape::Shape(): VBO(0),VAO(0),
+Shape::Shape(): VBO(0),VAO(0),EBO(0),
                 num_of_vertices(0),
+                num_indices(0),
+                indexed(false),
+                index_type(GL_UNSIGNED_INT),
                 clear_objs(false),
-                primitive(GL_TRIANGLES) {
+                primitive(GL_TRIANGLES),
+                packed(false),
+                pos_offset(0.0f),
+                pos_scale(1.0f),
+                uv_offset(0.0f),
+                uv_scale(1.0f),
+                material_buffer(0),
+                material_texture(0),
+                instance_buffer(0),
+                instance_count(0),
+                drawn_instances(0) {
 
 }
 
@@ -16,7 +31,22 @@ Shape::Shape(Shape &obj) {
   this->EBO = obj.EBO;
   this->num_indices = obj.num_indices;
   this->num_of_vertices = obj.num_of_vertices;
+  this->indexed = obj.indexed;
+  this->index_type = obj.index_type;
   this->primitive = obj.primitive;
+  this->packed = obj.packed;
+  this->pos_offset = obj.pos_offset;
+  this->pos_scale = obj.pos_scale;
+  this->uv_offset = obj.uv_offset;
+  this->uv_scale = obj.uv_scale;
+  this->material_buffer = obj.material_buffer;
+  this->material_texture = obj.material_texture;
+  //The instance buffer belongs to the original; the copy starts without instances
+  this->instance_buffer = 0;
+  this->instance_count = 0;
+  this->drawn_instances = 0;
+  this->bounds = obj.bounds;
+  this->sphere = obj.sphere;
   this->clear_objs = false;
 }
 
@@ -27,7 +57,21 @@ Shape::Shape(Shape_Struct obj) {
   this->EBO = obj.EBO;
   this->num_indices = obj.num_indices;
   this->num_of_vertices = obj.num_of_vertices;
+  this->indexed = obj.indexed;
+  this->index_type = obj.index_type;
   this->primitive = obj.primitive;
+  this->packed = obj.packed;
+  this->pos_offset = obj.pos_offset;
+  this->pos_scale = obj.pos_scale;
+  this->uv_offset = obj.uv_offset;
+  this->uv_scale = obj.uv_scale;
+  this->material_buffer = obj.material_buffer;
+  this->material_texture = obj.material_texture;
+  this->instance_buffer = 0;
+  this->instance_count = 0;
+  this->drawn_instances = 0;
+  this->bounds = obj.bounds;
+  this->sphere = obj.sphere;
 }
 
 void Shape::initialize (float* data, int data_bytes, int num_vertices, 
@@ -43,13 +87,19 @@ void Shape::initialize (float* data, int data_bytes, int num_vertices,
   //use glBufferData to push data to the buffer memory
   glBufferData(GL_ARRAY_BUFFER,data_bytes,data,GL_STATIC_DRAW);
 
+  //The first attribute is the position
+  if (vao.size() > 0 && vao[0].data_type == GL_FLOAT) {
+    int stride = vao[0].stride_bytes > 0 ? vao[0].stride_bytes : vao[0].num_per_vertex*sizeof(float);
+    compute_bounds((char*)data + vao[0].offset_bytes,num_vertices,stride,vao[0].num_per_vertex,this->bounds,this->sphere);
+  }
+
   //VAO setup
   //create a vertex array object
   
   glGenVertexArrays(1,&(this->VAO));
 
   //bind the VAO to configure it.
-  glBindVertexArray(this->VAO);
+  GL_State_Cache::bind_vertex_array(this->VAO);
 
   for (int i = 0; i < vao.size(); i++) {
   //Vertex shader lets us specify anything we want...
@@ -65,41 +115,185 @@ void Shape::initialize (float* data, int data_bytes, int num_vertices,
 
 void Shape::set_EBO (unsigned int* data, int num_indices) {
   glGenBuffers(1,&(this->EBO));
-  glBindVertexArray(this->VAO);
+  GL_State_Cache::bind_vertex_array(this->VAO);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,this->EBO);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER,num_indices*sizeof(unsigned int),data,GL_STATIC_DRAW);
-  glBindVertexArray(0);
+  GL_State_Cache::bind_vertex_array(0);
   this->num_indices = num_indices;
+  this->index_type = GL_UNSIGNED_INT;
 }
 
 
 //define destructor
 Shape::~Shape() {
+  if (this->instance_buffer > 0) glDeleteBuffers(1,&(this->instance_buffer));
   if (this->clear_objs) {
     //std::cout<<"Deleted shape."<<std::endl;
     glDeleteBuffers(1,&(this->VBO));
+    if (this->EBO > 0) glDeleteBuffers(1,&(this->EBO));
+    if (this->material_texture > 0) glDeleteTextures(1,&(this->material_texture));
+    if (this->material_buffer > 0) glDeleteBuffers(1,&(this->material_buffer));
     glDeleteVertexArrays(1,&(this->VAO));
+    //Deleting bound objects unbinds them, and their ids may be reused
+    GL_State_Cache::invalidate();
   }
 }
 //define draw
-void Shape::draw (unsigned int shader_program,unsigned int outline_program) {
+void Shape::draw (const Shader* shader,unsigned int outline_program) {
   if (this->VBO<1 || this->VAO<1) {
     std::cout<<"SHAPE NOT INITIALIZED."<<std::endl;
     return;
   }
-  glUseProgram(shader_program);
-  glBindVertexArray(this->VAO);
-  
-  glDrawArrays(this->primitive,0,this->num_of_vertices);
+  this->draw_geometry(shader,0);
 
   if (outline_program>0 && this->EBO > 0) {
-    glUseProgram(outline_program);
+    GL_State_Cache::use_program(outline_program);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,this->EBO);
-    glDrawElements(GL_LINE_LOOP,this->num_indices,GL_UNSIGNED_INT,0);
+    glDrawElements(GL_LINE_LOOP,this->num_indices,this->index_type,0);
     
   }
+  //The VAO stays bound; GL_State_Cache skips rebinding it for the next draw of this shape
+}
+
+void Shape::set_instances(const std::vector<Instance_Data>& instances) {
+  if (this->VAO<1) {
+    std::cout<<"SHAPE NOT INITIALIZED."<<std::endl;
+    return;
+  }
+  GL_State_Cache::bind_vertex_array(this->VAO);
+  if (this->instance_buffer == 0) {
+    glGenBuffers(1,&(this->instance_buffer));
+    glBindBuffer(GL_ARRAY_BUFFER,this->instance_buffer);
+    //A mat4 attribute takes four locations, one column each
+    for (int i = 0; i < 4; i++) {
+      glVertexAttribPointer(6+i,4,GL_FLOAT,GL_FALSE,sizeof(Instance_Data),(void*)(offsetof(Instance_Data,model)+i*sizeof(glm::vec4)));
+      glEnableVertexAttribArray(6+i);
+      glVertexAttribDivisor(6+i,1);
+    }
+    glVertexAttribPointer(10,4,GL_FLOAT,GL_FALSE,sizeof(Instance_Data),(void*)offsetof(Instance_Data,color_override));
+    glEnableVertexAttribArray(10);
+    glVertexAttribDivisor(10,1);
+    glVertexAttribIPointer(11,1,GL_INT,sizeof(Instance_Data),(void*)offsetof(Instance_Data,override_material));
+    glEnableVertexAttribArray(11);
+    glVertexAttribDivisor(11,1);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  this->instances = instances;
+  this->instance_count = instances.size();
+  this->upload_instances(instances.data(),instances.size());
+
+  this->instance_bounds = AABB();
+  for (size_t i = 0; i < instances.size(); i++) {
+    aabb_expand(this->instance_bounds,aabb_transform(this->bounds,instances[i].model));
+  }
+}
+
+void Shape::upload_instances(const Instance_Data* data, int count) {
+  //A new store each time, so the driver need not wait for draws still reading the old one
+  glBindBuffer(GL_ARRAY_BUFFER,this->instance_buffer);
+  glBufferData(GL_ARRAY_BUFFER,count*sizeof(Instance_Data),data,GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER,0);
+  this->drawn_instances = count;
+}
+
+int Shape::get_instance_count() {
+  return this->instance_count;
+}
+
+const std::vector<Instance_Data>& Shape::get_instances() {
+  return this->instances;
+}
+
+void Shape::select_instances(const std::vector<int>& indices) {
+  if (this->instance_buffer == 0) return;
+  this->selected_instances.clear();
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (indices[i] >= 0 && indices[i] < this->instance_count) this->selected_instances.push_back(this->instances[indices[i]]);
+  }
+  this->upload_instances(this->selected_instances.data(),this->selected_instances.size());
+}
+
+void Shape::select_all_instances() {
+  if (this->instance_buffer == 0 || this->drawn_instances == this->instance_count) return;
+  this->upload_instances(this->instances.data(),this->instance_count);
+}
+
+void Shape::draw_instanced (const Shader* shader) {
+  if (this->VBO<1 || this->VAO<1) {
+    std::cout<<"SHAPE NOT INITIALIZED."<<std::endl;
+    return;
+  }
+  if (this->drawn_instances == 0) return;
+  this->draw_geometry(shader,this->drawn_instances);
+}
+
+void Shape::draw_geometry(const Shader* shader, int instances) {
+  GL_State_Cache::use_program(shader->ID);
+  GL_State_Cache::bind_vertex_array(this->VAO);
+  int packed_location = -1;
+  if (this->packed) packed_location = this->use_packed_uniforms(shader);
+  
+  if (this->indexed) {
+    if (instances > 0) glDrawElementsInstanced(this->primitive,this->num_indices,this->index_type,0,instances);
+    else glDrawElements(this->primitive,this->num_indices,this->index_type,0);
+  }
+  else {
+    if (instances > 0) glDrawArraysInstanced(this->primitive,0,this->num_of_vertices,instances);
+    else glDrawArrays(this->primitive,0,this->num_of_vertices);
+  }
+  //Leave the program decoding float vertices for the next (unpacked) shape
+  if (packed_location >= 0) {
+    glUniform1i(packed_location,0);
+    Shader::uniform_calls++;
+  }
+}
+
+int Shape::use_packed_uniforms(const Shader* shader) {
+  Packed_Uniforms* found = NULL;
+  for (size_t i = 0; i < this->packed_uniforms.size(); i++) {
+    if (this->packed_uniforms[i].program == shader->ID) found = &this->packed_uniforms[i];
+  }
+  if (found == NULL) {
+    //From the program's reflection table, no driver lookups
+    Packed_Uniforms handles;
+    handles.program = shader->ID;
+    handles.packed_vertices = shader->getUniform("packed_vertices");
+    handles.pos_offset = shader->getUniform("pos_offset");
+    handles.pos_scale = shader->getUniform("pos_scale");
+    handles.uv_offset = shader->getUniform("uv_offset");
+    handles.uv_scale = shader->getUniform("uv_scale");
+    if (handles.packed_vertices.location < 0) {
+      std::cout<<"ERROR: Program "<<shader->ID<<" cannot decode packed vertices."<<std::endl;
+    }
+    this->packed_uniforms.push_back(handles);
+    found = &this->packed_uniforms.back();
+  }
+  if (found->packed_vertices.location < 0) return -1;
+  shader->setBool(found->packed_vertices,true);
+  shader->setVec3(found->pos_offset,this->pos_offset);
+  shader->setVec3(found->pos_scale,this->pos_scale);
+  shader->setVec2(found->uv_offset,this->uv_offset);
+  shader->setVec2(found->uv_scale,this->uv_scale);
+  if (this->material_texture > 0) {
+    GL_State_Cache::bind_texture(MATERIAL_BUFFER_UNIT,GL_TEXTURE_BUFFER,this->material_texture);
+  }
+  return found->packed_vertices.location;
+}
+
+unsigned int Shape::get_VAO() {
+  return this->VAO;
+}
+
+const AABB& Shape::get_bounds() {
+  return this->bounds;
+}
+
+const Bounding_Sphere& Shape::get_bounding_sphere() {
+  return this->sphere;
+}
 
-  glBindVertexArray(0);
+const AABB& Shape::get_instance_bounds() {
+  return this->instance_bounds;
 }
 
 void Shape::set_material(Material m) {
@@ -107,10 +301,10 @@ void Shape::set_material(Material m) {
 }
 
 void Shape::use_material (Shader* s) {
-  s->setVec3("material.ambient",this->material.ambient);
-  s->setVec3("material.diffuse",this->material.diffuse);
-  s->setVec3("material.specular",this->material.specular);
-  s->setFloat("material.shininess",this->material.shininess);
+  s->setVec3(s->draw_uniforms.material_ambient,this->material.ambient);
+  s->setVec3(s->draw_uniforms.material_diffuse,this->material.diffuse);
+  s->setVec3(s->draw_uniforms.material_specular,this->material.specular);
+  s->setFloat(s->draw_uniforms.material_shininess,this->material.shininess);
 }
 
 
@@ -9,6 +9,10 @@
 #include <vector>
 #include "vertex_attr.hpp"
 #include "Shader.hpp"
+#include "bounds.hpp"
+
+//Texture unit the packed vertex shaders read the material buffer (samplerBuffer material_buffer) from
+#define MATERIAL_BUFFER_UNIT 2
 
 struct Material {
     glm::vec3 ambient;
@@ -17,6 +21,16 @@ struct Material {
     float shininess;
 };
 
+//Per-instance attributes for Shape::draw_instanced (locations 6-11 of importInstancedVertexShader.glsl)
+struct Instance_Data {
+  glm::mat4 model = glm::mat4(1.0f);
+  //Replaces the diffuse color of material slot override_material (of every material if it is -1;
+  //slots are only known for packed vertices).  An alpha of 0 keeps the model's own colors.
+  glm::vec4 color_override = glm::vec4(0.0f);
+  int override_material = -1;
+  int pad[3] = {0,0,0};
+};
+
 struct Shape_Struct {
    unsigned int VBO;
    unsigned int VAO;
@@ -26,6 +40,22 @@ struct Shape_Struct {
   int num_of_vertices;
   GLuint primitive;
   Material material;
+  //True if the EBO holds the triangle indices (drawn with glDrawElements)
+  bool indexed = false;
+  //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+  GLenum index_type = GL_UNSIGNED_INT;
+  //True if the VBO holds ImportOBJ::PackedVertex data; the offsets and scales dequantize it
+  bool packed = false;
+  glm::vec3 pos_offset = glm::vec3(0.0f);
+  glm::vec3 pos_scale = glm::vec3(1.0f);
+  glm::vec2 uv_offset = glm::vec2(0.0f);
+  glm::vec2 uv_scale = glm::vec2(1.0f);
+  //Texture buffer holding the Kd/Ks table indexed by packed vertices (0 if none)
+  unsigned int material_buffer = 0;
+  unsigned int material_texture = 0;
+  //Model-space bounds of the vertices (empty if unknown)
+  AABB bounds;
+  Bounding_Sphere sphere;
 };
 
 //A class containing VBO, VAO, and EBO information 
@@ -43,6 +73,10 @@ class Shape {
         int num_of_vertices;
         //Number of indices in the EBO
         int num_indices;
+        //True if the shape itself is drawn from the EBO (otherwise the EBO only holds an outline)
+        bool indexed;
+        //Type of the values in the EBO (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+        GLenum index_type;
         //A boolean variable that is true if the 
         //buffers must be cleared when the destructor is invoked.
         bool clear_objs;
@@ -51,6 +85,47 @@ class Shape {
 
         //Material for the shape
         Material material;
+
+        //Packed (quantized) vertex data, see Shape_Struct
+        bool packed;
+        glm::vec3 pos_offset;
+        glm::vec3 pos_scale;
+        glm::vec2 uv_offset;
+        glm::vec2 uv_scale;
+        unsigned int material_buffer;
+        unsigned int material_texture;
+
+        //Per-instance attribute buffer (0 until set_instances is called) and its instance count
+        unsigned int instance_buffer;
+        int instance_count;
+        //The instances as set_instances got them, and how many of them the buffer holds for
+        //the next draw (fewer after select_instances)
+        std::vector<Instance_Data> instances;
+        std::vector<Instance_Data> selected_instances;
+        int drawn_instances;
+        //Uploads this many instances to the instance buffer
+        void upload_instances(const Instance_Data* data, int count);
+
+        //Model-space bounds of the vertices, and of every instance together
+        AABB bounds;
+        Bounding_Sphere sphere;
+        AABB instance_bounds;
+
+        //Handles of the packed-vertex uniforms in each program this shape was drawn with
+        struct Packed_Uniforms {
+            unsigned int program;
+            Uniform_Handle packed_vertices;
+            Uniform_Handle pos_offset;
+            Uniform_Handle pos_scale;
+            Uniform_Handle uv_offset;
+            Uniform_Handle uv_scale;
+        };
+        std::vector<Packed_Uniforms> packed_uniforms;
+        //Enables the packed decode in the given program (and binds the material buffer)
+        //and returns the location of its packed_vertices uniform.
+        int use_packed_uniforms(const Shader* shader);
+        //Binds the program and VAO and issues the draw call (instanced if instances > 0)
+        void draw_geometry(const Shader* shader, int instances);
     
     public:
   
@@ -71,9 +146,23 @@ class Shape {
         //Optionally sets up an EBO (assumes that the EBO is used for creating an outline).
         void set_EBO (unsigned int* data, int num_indices);
 
-        //Draws the shape using a given shader program.  Optionally draws an outline if the 
-        //EBO has been set up.
-        void draw (unsigned int shader_program,unsigned int outline_program=0);
+        //Draws the shape using a given shader program (glDrawElements for indexed shapes).
+        //Optionally draws an outline if the EBO has been set up.
+        void draw (const Shader* shader,unsigned int outline_program=0);
+
+        //Uploads per-instance model matrices and color overrides into this shape's VAO.
+        //Calling it again replaces them.
+        void set_instances(const std::vector<Instance_Data>& instances);
+        int get_instance_count();
+        const std::vector<Instance_Data>& get_instances();
+        //Makes the next draw_instanced calls draw only these instances (indices into the
+        //set_instances list), copied to the front of the instance buffer
+        void select_instances(const std::vector<int>& indices);
+        //Makes draw_instanced draw every instance again
+        void select_all_instances();
+        //Draws the selected instances (all of them unless select_instances was called) with one
+        //call; the program must read the instance attributes (shaders/importInstancedVertexShader.glsl).
+        void draw_instanced (const Shader* shader);
 
         //Given a material structure (with ambient, diffuse, specular, and shininess values), set the 
         // material data member for the class
@@ -83,6 +172,15 @@ class Shape {
         //in the given shape.
         void use_material (Shader* s);
 
+        //Vertex array object id (used to sort draws by the state they need)
+        unsigned int get_VAO();
+
+        //Model-space bounds (empty if the shape has no vertices)
+        const AABB& get_bounds();
+        const Bounding_Sphere& get_bounding_sphere();
+        //The box around all instances' placements (before the draw's own model matrix)
+        const AABB& get_instance_bounds();
+
         //Destructor (deletes the buffers and vertex array object if this shape created them).
         ~Shape();
 };
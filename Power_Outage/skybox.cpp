@@ -1,27 +1,64 @@
 #include <glad/glad.h> //GLAD must be BEFORE GLFW
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
-#include <map>
-#include <vector>
 #include "skybox.hpp"
-#include "shape.hpp"
 #include "Shader.hpp"
+#include "gl_state_cache.hpp"
 
-Skybox::Skybox(Shader * shader, Shape shape, unsigned int texture) {
+Skybox::Skybox(Shader * shader, unsigned int texture) {
     this->shader = shader;
-    this->shape = shape;
     this->texture = texture;
+    glGenVertexArrays(1,&VAO);
 }
 
-void Skybox::render(glm::mat4 camera_view_matrix) {
+Skybox::~Skybox() {
+    if (query > 0) glDeleteQueries(1,&query);
+    glDeleteVertexArrays(1,&VAO);
+    GL_State_Cache::invalidate();
+}
+
+//The view and projection come from the FrameCamera block; the vertex shader places the
+//triangle and its view rays from gl_VertexID
+void Skybox::render() {
+  if (query_pending) read_query();
   shader->use();
-  glm::mat4 temp_view = glm::mat4(glm::mat3(camera_view_matrix)); 
-  shader->setMat4("view",temp_view);
-  glDepthFunc(GL_EQUAL);
-  glBindTexture(GL_TEXTURE_CUBE_MAP,texture);
-  glDrawArrays(GL_TRIANGLES, 0, 36);
-  shape.draw(shader->ID);
+  GL_State_Cache::bind_texture(0,GL_TEXTURE_CUBE_MAP,texture);
+  GL_State_Cache::bind_vertex_array(VAO);
+  //Only where the depth buffer still holds the clear value, and nothing to write back
+  glDepthFunc(GL_LEQUAL);
+  glDepthMask(GL_FALSE);
+  if (count_fragments) {
+    if (query == 0) glGenQueries(1,&query);
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT,viewport);
+    stats.pixels_covered += (uint64_t)viewport[2] * viewport[3];
+    glBeginQuery(GL_SAMPLES_PASSED,query);
+  }
+  glDrawArrays(GL_TRIANGLES,0,3);
+  if (count_fragments) {
+    glEndQuery(GL_SAMPLES_PASSED);
+    query_pending = true;
+  }
+  stats.draws++;
+  glDepthMask(GL_TRUE);
   glDepthFunc(GL_LESS);
 }
+
+void Skybox::read_query() {
+  GLuint64 samples = 0;
+  glGetQueryObjectui64v(query,GL_QUERY_RESULT,&samples);
+  stats.fragments_shaded += samples;
+  query_pending = false;
+}
+
+Skybox_Stats Skybox::get_stats() {
+  if (query_pending) read_query();
+  return stats;
+}
+
+void Skybox::reset_stats() {
+  //A draw still in flight belongs to the frames before the reset
+  if (query_pending) read_query();
+  stats = Skybox_Stats();
+}
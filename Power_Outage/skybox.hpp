@@ -1,17 +1,45 @@
 #ifndef SKYBOX_HPP
 #define SKYBOX_HPP
 
-#include "shape.hpp"
+#include <stdint.h>
 #include "Shader.hpp"
 
+//What the skybox draws cost since the last reset_stats(), counted with count_fragments on
+struct Skybox_Stats {
+  unsigned int draws = 0;
+  //Pixels of the viewports the sky was drawn over (the triangle covers all of each)
+  uint64_t pixels_covered = 0;
+  //Fragments that passed the depth test and ran the fragment shader (GL_SAMPLES_PASSED); the
+  //rest were rejected by the early depth test where something was already drawn
+  uint64_t fragments_shaded = 0;
+};
+
+//The cube map sky, drawn as one full-screen triangle at the far plane.  The vertex shader
+//rebuilds each corner's view ray from the FrameCamera block, so there is no vertex buffer and
+//no cube.  Draw it once per frame, in the main pass after the opaque objects: with depth writes
+//off and LEQUAL it only shades the pixels nothing else covered.
 class Skybox {
   private:
     Shader * shader;
-    Shape shape;
     unsigned int texture;
+    //Empty: core profile draws need a VAO bound even without attributes
+    unsigned int VAO = 0;
+    unsigned int query = 0;
+    bool query_pending = false;
+    Skybox_Stats stats;
+    //Adds the last draw's query result to stats
+    void read_query();
+    Skybox(const Skybox&);
+    Skybox& operator=(const Skybox&);
   public:
-    Skybox(Shader * shader, Shape shape, unsigned int texture);
-    void render(glm::mat4 camera_view_matrix);
+    Skybox(Shader * shader, unsigned int texture);
+    ~Skybox();
+    void render();
+    //Counts the fragments each render() shades.  A draw's count is read at the next render()
+    //(or get_stats()), so the query does not stall the frame it was issued in.
+    bool count_fragments = false;
+    Skybox_Stats get_stats();
+    void reset_stats();
 };
 
 #endif //SKYBOX_HPP
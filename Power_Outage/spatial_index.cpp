@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include "spatial_index.hpp"
+
+//Proxies per leaf
+#define SPATIAL_INDEX_LEAF_SIZE 4
+
+static glm::vec3 box_center(const AABB& box) {
+    return 0.5f * (box.min + box.max);
+}
+
+int Spatial_Index::add(const AABB& box, int id) {
+    Proxy proxy;
+    proxy.box = box;
+    proxy.id = id;
+    proxy.leaf = -1;
+    proxies.push_back(proxy);
+    built = false;
+    return proxies.size() - 1;
+}
+
+void Spatial_Index::update(int proxy, const AABB& box) {
+    if (proxy < 0 || proxy >= (int)proxies.size()) {
+        std::cout << "ERROR: Spatial_Index has no proxy " << proxy << std::endl;
+        return;
+    }
+    Proxy& p = proxies[proxy];
+    if (p.box.min == box.min && p.box.max == box.max) return;
+    p.box = box;
+    if (!built) return;
+
+    //Refit: the leaf from its proxies, then each ancestor from its two children
+    Node& leaf = nodes[p.leaf];
+    leaf.box = AABB();
+    for (int i = 0; i < leaf.count; i++) aabb_expand(leaf.box,proxies[leaf_proxies[leaf.first + i]].box);
+    for (int n = leaf.parent; n >= 0; n = nodes[n].parent) {
+        Node& node = nodes[n];
+        node.box = nodes[node.left].box;
+        aabb_expand(node.box,nodes[node.right].box);
+    }
+}
+
+const AABB& Spatial_Index::get_box(int proxy) {
+    return proxies[proxy].box;
+}
+
+void Spatial_Index::clear() {
+    nodes.clear();
+    proxies.clear();
+    leaf_proxies.clear();
+    built = false;
+}
+
+int Spatial_Index::size() {
+    return proxies.size();
+}
+
+void Spatial_Index::build() {
+    nodes.clear();
+    leaf_proxies.resize(proxies.size());
+    for (size_t i = 0; i < proxies.size(); i++) leaf_proxies[i] = i;
+    if (!proxies.empty()) {
+        nodes.reserve(2 * proxies.size() / SPATIAL_INDEX_LEAF_SIZE + 1);
+        build_node(0,proxies.size(),-1);
+    }
+    built = true;
+}
+
+void Spatial_Index::ensure_built() {
+    if (!built) build();
+}
+
+//Splits at the median of the box centers along the axis they spread the most in
+int Spatial_Index::build_node(int first, int count, int parent) {
+    int index = nodes.size();
+    nodes.push_back(Node());
+    Node node;
+    node.parent = parent;
+    node.left = node.right = -1;
+    node.first = first;
+    node.count = 0;
+    AABB center_bounds;
+    for (int i = 0; i < count; i++) {
+        const AABB& box = proxies[leaf_proxies[first + i]].box;
+        aabb_expand(node.box,box);
+        aabb_expand(center_bounds,box_center(box));
+    }
+
+    glm::vec3 spread = center_bounds.max - center_bounds.min;
+    if (count <= SPATIAL_INDEX_LEAF_SIZE || (spread.x <= 0.0f && spread.y <= 0.0f && spread.z <= 0.0f)) {
+        node.count = count;
+        for (int i = 0; i < count; i++) proxies[leaf_proxies[first + i]].leaf = index;
+        nodes[index] = node;
+        return index;
+    }
+
+    int axis = 0;
+    if (spread.y > spread[axis]) axis = 1;
+    if (spread.z > spread[axis]) axis = 2;
+    int half = count / 2;
+    std::vector<Proxy>& all = proxies;
+    std::nth_element(leaf_proxies.begin() + first,leaf_proxies.begin() + first + half,leaf_proxies.begin() + first + count,
+                     [&all,axis](int a, int b) {
+                         return all[a].box.min[axis] + all[a].box.max[axis] < all[b].box.min[axis] + all[b].box.max[axis];
+                     });
+    nodes[index] = node;
+    int left = build_node(first,half,index);
+    int right = build_node(first + half,count - half,index);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void Spatial_Index::append_subtree(int root, std::vector<int>& ids) {
+    size_t base = stack.size();
+    stack.push_back(root);
+    while (stack.size() > base) {
+        int n = stack.back();
+        stack.pop_back();
+        nodes_visited++;
+        const Node& node = nodes[n];
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; i++) ids.push_back(proxies[leaf_proxies[node.first + i]].id);
+        }
+        else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+void Spatial_Index::query_frustum(const Frustum& frustum, std::vector<int>& ids) {
+    ensure_built();
+    if (nodes.empty()) return;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int n = stack.back();
+        stack.pop_back();
+        nodes_visited++;
+        const Node& node = nodes[n];
+        //Farthest corner behind a plane: outside.  Nearest corner in front of every plane: the
+        //whole subtree is inside, so it needs no more tests.
+        bool outside = false;
+        bool inside = true;
+        for (int i = 0; i < 6 && !outside; i++) {
+            const glm::vec4& plane = frustum.planes[i];
+            float far_distance = plane.w, near_distance = plane.w;
+            for (int axis = 0; axis < 3; axis++) {
+                float low = plane[axis] * node.box.min[axis];
+                float high = plane[axis] * node.box.max[axis];
+                far_distance += fmaxf(low,high);
+                near_distance += fminf(low,high);
+            }
+            if (far_distance < 0.0f) outside = true;
+            if (near_distance < 0.0f) inside = false;
+        }
+        if (outside) continue;
+        if (inside) {
+            nodes_visited--;
+            append_subtree(n,ids);
+        }
+        else if (node.count > 0) {
+            for (int i = 0; i < node.count; i++) {
+                const Proxy& proxy = proxies[leaf_proxies[node.first + i]];
+                if (aabb_visible(frustum,proxy.box)) ids.push_back(proxy.id);
+            }
+        }
+        else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+static bool box_touches_sphere(const AABB& box, glm::vec3 center, float radius_squared) {
+    glm::vec3 closest = glm::clamp(center,box.min,box.max);
+    glm::vec3 offset = center - closest;
+    return glm::dot(offset,offset) <= radius_squared;
+}
+
+void Spatial_Index::query_sphere(glm::vec3 center, float radius, std::vector<int>& ids) {
+    ensure_built();
+    if (nodes.empty()) return;
+    float radius_squared = radius * radius;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        nodes_visited++;
+        if (!box_touches_sphere(node.box,center,radius_squared)) continue;
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; i++) {
+                const Proxy& proxy = proxies[leaf_proxies[node.first + i]];
+                if (box_touches_sphere(proxy.box,center,radius_squared)) ids.push_back(proxy.id);
+            }
+        }
+        else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+static bool boxes_overlap(const AABB& a, const AABB& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+void Spatial_Index::query_box(const AABB& box, std::vector<int>& ids) {
+    ensure_built();
+    if (nodes.empty()) return;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        nodes_visited++;
+        if (!boxes_overlap(node.box,box)) continue;
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; i++) {
+                const Proxy& proxy = proxies[leaf_proxies[node.first + i]];
+                if (boxes_overlap(proxy.box,box)) ids.push_back(proxy.id);
+            }
+        }
+        else {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+        }
+    }
+}
+
+//Slab test: the distance at which the ray enters the box, or -1 if it misses within max_distance
+static float ray_enters_box(const AABB& box, glm::vec3 origin, glm::vec3 inverse_direction, float max_distance) {
+    glm::vec3 t0 = (box.min - origin) * inverse_direction;
+    glm::vec3 t1 = (box.max - origin) * inverse_direction;
+    glm::vec3 t_near = glm::min(t0,t1);
+    glm::vec3 t_far = glm::max(t0,t1);
+    float enter = fmaxf(fmaxf(t_near.x,t_near.y),fmaxf(t_near.z,0.0f));
+    float leave = fminf(fminf(t_far.x,t_far.y),fminf(t_far.z,max_distance));
+    return enter <= leave ? enter : -1.0f;
+}
+
+bool Spatial_Index::raycast(glm::vec3 origin, glm::vec3 direction, float max_distance, Ray_Hit& hit) {
+    ensure_built();
+    hit = Ray_Hit();
+    if (nodes.empty()) return false;
+    //Division by a zero component gives infinity, which the slab test handles
+    glm::vec3 inverse_direction = 1.0f / direction;
+    float best = max_distance;
+    stack.clear();
+    if (ray_enters_box(nodes[0].box,origin,inverse_direction,best) >= 0.0f) stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        nodes_visited++;
+        if (node.count > 0) {
+            for (int i = 0; i < node.count; i++) {
+                const Proxy& proxy = proxies[leaf_proxies[node.first + i]];
+                float t = ray_enters_box(proxy.box,origin,inverse_direction,best);
+                if (t >= 0.0f && (hit.id < 0 || t < best)) {
+                    best = t;
+                    hit.id = proxy.id;
+                    hit.distance = t;
+                }
+            }
+            continue;
+        }
+        //Visit the nearer child first so the farther one is more often pruned
+        float t_left = ray_enters_box(nodes[node.left].box,origin,inverse_direction,best);
+        float t_right = ray_enters_box(nodes[node.right].box,origin,inverse_direction,best);
+        if (t_left >= 0.0f && t_right >= 0.0f) {
+            if (t_left <= t_right) {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+            }
+            else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+        else if (t_left >= 0.0f) stack.push_back(node.left);
+        else if (t_right >= 0.0f) stack.push_back(node.right);
+    }
+    return hit.id >= 0;
+}
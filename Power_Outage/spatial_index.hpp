@@ -0,0 +1,73 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+//Closest box a ray enters (distance 0 if it starts inside one)
+struct Ray_Hit {
+    int id = -1;
+    float distance = 0.0f;
+};
+
+//A bounding volume hierarchy over world-space boxes.  Each box is added with an id of the
+//caller's choosing (returned by the queries) and gets back a proxy handle for update().
+//The tree is built on the first query after add(); update() only refits the boxes on the
+//path from the proxy's leaf to the root, so moving a few objects per frame stays cheap.
+//Refitting never rebalances, so call build() again after large changes.
+class Spatial_Index {
+    public:
+        //Adds a box and returns its proxy handle.
+        int add(const AABB& box, int id);
+        //Moves a proxy's box (does nothing if the box is unchanged).
+        void update(int proxy, const AABB& box);
+        const AABB& get_box(int proxy);
+        void clear();
+        int size();
+        //Rebuilds the tree from every proxy's current box.
+        void build();
+
+        //Appends the ids of boxes that are (at least partly) inside the frustum
+        void query_frustum(const Frustum& frustum, std::vector<int>& ids);
+        //Appends the ids of boxes within radius of center
+        void query_sphere(glm::vec3 center, float radius, std::vector<int>& ids);
+        //Appends the ids of boxes that overlap box
+        void query_box(const AABB& box, std::vector<int>& ids);
+        //Finds the nearest box along the ray within max_distance (direction need not be unit
+        //length; distances are in units of it).  Returns false if nothing is hit.
+        bool raycast(glm::vec3 origin, glm::vec3 direction, float max_distance, Ray_Hit& hit);
+
+        //Tree nodes visited by queries since the last reset (to compare against linear scans)
+        unsigned int nodes_visited = 0;
+
+    private:
+        //Leaves hold count > 0 proxies starting at leaf_proxies[first]; inner nodes have
+        //count == 0 and two children
+        struct Node {
+            AABB box;
+            int parent;
+            int left;
+            int right;
+            int first;
+            int count;
+        };
+        struct Proxy {
+            AABB box;
+            int id;
+            int leaf;
+        };
+
+        int build_node(int first, int count, int parent);
+        void ensure_built();
+        void append_subtree(int node, std::vector<int>& ids);
+
+        std::vector<Node> nodes;
+        std::vector<Proxy> proxies;
+        std::vector<int> leaf_proxies;
+        bool built = false;
+        std::vector<int> stack;
+};
+
+#endif //SPATIAL_INDEX_HPP
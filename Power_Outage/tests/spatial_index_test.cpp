@@ -0,0 +1,195 @@
+//Unit test: every Spatial_Index query against a brute-force scan over the same boxes.
+//  frustum: cameras turning in place, inside and outside the scene
+//  sphere:  proximity queries, including ones that touch nothing
+//  box:     overlap queries
+//  ray:     nearest hit, rays starting inside a box and rays that miss
+//  refit:   update() moving every box a little and a few boxes far away, queried without
+//           a rebuild, then after build()
+//Prints each failing check and exits with 1 if there was one (registered with ctest).
+//
+//CMake target: spatial_index_test (ctest runs it)
+
+#include "spatial_index.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool passed, const char* what, int round) {
+    if (passed) return;
+    printf("FAILED: %s (round %d)\n", what, round);
+    failures++;
+}
+
+static float random_float(float low, float high) {
+    return low + (high - low) * (rand() / (float)RAND_MAX);
+}
+
+static AABB random_box(float spread) {
+    glm::vec3 center(random_float(-spread,spread),random_float(-4.0f,16.0f),random_float(-spread,spread));
+    glm::vec3 extent(random_float(0.5f,8.0f),random_float(0.5f,12.0f),random_float(0.5f,8.0f));
+    AABB box;
+    box.min = center - extent;
+    box.max = center + extent;
+    return box;
+}
+
+static bool box_touches_sphere(const AABB& box, glm::vec3 center, float radius) {
+    glm::vec3 offset = center - glm::clamp(center,box.min,box.max);
+    return glm::dot(offset,offset) <= radius * radius;
+}
+
+static bool boxes_overlap(const AABB& a, const AABB& b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y &&
+           a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+static float ray_enters_box(const AABB& box, glm::vec3 origin, glm::vec3 direction, float max_distance) {
+    glm::vec3 inverse_direction = 1.0f / direction;
+    glm::vec3 t0 = (box.min - origin) * inverse_direction;
+    glm::vec3 t1 = (box.max - origin) * inverse_direction;
+    glm::vec3 t_near = glm::min(t0,t1);
+    glm::vec3 t_far = glm::max(t0,t1);
+    float enter = fmaxf(fmaxf(t_near.x,t_near.y),fmaxf(t_near.z,0.0f));
+    float leave = fminf(fminf(t_far.x,t_far.y),fminf(t_far.z,max_distance));
+    return enter <= leave ? enter : -1.0f;
+}
+
+static std::vector<int> sorted(std::vector<int> ids) {
+    std::sort(ids.begin(),ids.end());
+    return ids;
+}
+
+//Runs every kind of query on the index and on the boxes and compares the results.  The
+//ids are the box indices plus 100, so a query returning proxies instead of ids fails.
+static void check_queries(Spatial_Index& index, const std::vector<AABB>& boxes, float spread, int round) {
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),1280.0f/720.0f,0.1f,100.0f);
+    for (int q = 0; q < 8; q++) {
+        float yaw = glm::radians(q * 45.0f + round * 7.0f);
+        glm::vec3 eye = q < 4 ? glm::vec3(0.0f,2.0f,0.0f) : glm::vec3(random_float(-spread,spread),2.0f,random_float(-spread,spread));
+        Frustum frustum = extract_frustum(projection * glm::lookAt(eye,eye + glm::vec3(cosf(yaw),-0.2f,sinf(yaw)),glm::vec3(0.0f,1.0f,0.0f)));
+        std::vector<int> expected, found;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (aabb_visible(frustum,boxes[i])) expected.push_back(i + 100);
+        }
+        index.query_frustum(frustum,found);
+        check(sorted(found) == expected,"query_frustum matches the scan",round);
+    }
+
+    for (int q = 0; q < 50; q++) {
+        glm::vec3 center(random_float(-spread,spread),random_float(-4.0f,16.0f),random_float(-spread,spread));
+        float radius = q < 40 ? random_float(0.5f,20.0f) : 0.0f;
+        std::vector<int> expected, found;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (box_touches_sphere(boxes[i],center,radius)) expected.push_back(i + 100);
+        }
+        index.query_sphere(center,radius,found);
+        check(sorted(found) == expected,"query_sphere matches the scan",round);
+    }
+
+    for (int q = 0; q < 50; q++) {
+        AABB query = random_box(spread);
+        std::vector<int> expected, found;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            if (boxes_overlap(boxes[i],query)) expected.push_back(i + 100);
+        }
+        index.query_box(query,found);
+        check(sorted(found) == expected,"query_box matches the scan",round);
+    }
+
+    for (int q = 0; q < 100; q++) {
+        glm::vec3 origin(random_float(-spread,spread),random_float(-3.0f,10.0f),random_float(-spread,spread));
+        //Every tenth ray starts in the middle of a box, which is a hit at distance 0
+        if (q % 10 == 0 && !boxes.empty()) {
+            const AABB& box = boxes[rand() % boxes.size()];
+            origin = (box.min + box.max) * 0.5f;
+        }
+        float angle = random_float(0.0f,6.2831853f);
+        glm::vec3 direction(cosf(angle),random_float(-0.2f,0.2f),sinf(angle));
+        if (q % 25 == 1) direction = glm::vec3(0.0f,0.0f,1.0f); //zero components
+        float best = -1.0f;
+        for (size_t i = 0; i < boxes.size(); i++) {
+            float t = ray_enters_box(boxes[i],origin,direction,200.0f);
+            if (t >= 0.0f && (best < 0.0f || t < best)) best = t;
+        }
+        Ray_Hit hit;
+        bool hit_something = index.raycast(origin,direction,200.0f,hit);
+        check(hit_something == (best >= 0.0f),"raycast hits when the scan does",round);
+        if (!hit_something || best < 0.0f) continue;
+        check(fabsf(hit.distance - best) <= 1e-4f * fmaxf(1.0f,best),"raycast finds the nearest distance",round);
+        //Ties may report either box, but the reported box must be hit at that distance
+        bool valid_id = hit.id >= 100 && hit.id < (int)boxes.size() + 100;
+        check(valid_id,"raycast reports an id that was added",round);
+        if (valid_id) {
+            float t = ray_enters_box(boxes[hit.id - 100],origin,direction,200.0f);
+            check(fabsf(t - hit.distance) <= 1e-4f * fmaxf(1.0f,best),"raycast's box is hit at its distance",round);
+        }
+    }
+}
+
+int main() {
+    srand(1357);
+    int round = 0;
+
+    //Empty index: nothing is found and nothing crashes
+    {
+        Spatial_Index index;
+        std::vector<int> ids;
+        index.query_sphere(glm::vec3(0.0f),100.0f,ids);
+        Ray_Hit hit;
+        check(ids.empty() && !index.raycast(glm::vec3(0.0f),glm::vec3(1.0f,0.0f,0.0f),100.0f,hit),"an empty index finds nothing",round);
+    }
+
+    int counts[4] = {1, 7, 300, 5000};
+    for (int c = 0; c < 4; c++) {
+        float spread = counts[c] < 100 ? 30.0f : 400.0f;
+        std::vector<AABB> boxes;
+        Spatial_Index index;
+        std::vector<int> proxies;
+        for (int i = 0; i < counts[c]; i++) {
+            boxes.push_back(random_box(spread));
+            proxies.push_back(index.add(boxes.back(),i + 100));
+        }
+        check(index.size() == counts[c],"size() counts the added boxes",round);
+        check_queries(index,boxes,spread,round++);
+
+        //Refit: every box drifts a little, a few jump across the scene
+        for (int step = 0; step < 3; step++) {
+            for (size_t i = 0; i < boxes.size(); i++) {
+                glm::vec3 offset(random_float(-2.0f,2.0f),random_float(-1.0f,1.0f),random_float(-2.0f,2.0f));
+                if (i % 50 == 0) offset = glm::vec3(random_float(-spread,spread),0.0f,random_float(-spread,spread));
+                boxes[i].min += offset;
+                boxes[i].max += offset;
+                index.update(proxies[i],boxes[i]);
+            }
+            for (size_t i = 0; i < boxes.size(); i++) {
+                const AABB& box = index.get_box(proxies[i]);
+                check(box.min == boxes[i].min && box.max == boxes[i].max,"get_box returns the updated box",round);
+            }
+            check_queries(index,boxes,spread,round++);
+        }
+        index.build();
+        check_queries(index,boxes,spread,round++);
+
+        //Boxes added after the tree was built show up in the next query
+        boxes.push_back(random_box(spread));
+        proxies.push_back(index.add(boxes.back(),boxes.size() - 1 + 100));
+        check_queries(index,boxes,spread,round++);
+
+        index.clear();
+        std::vector<int> ids;
+        index.query_box(random_box(spread),ids);
+        check(index.size() == 0 && ids.empty(),"clear() removes every box",round);
+    }
+
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All spatial index checks passed (%d rounds)\n", round);
+    return 0;
+}
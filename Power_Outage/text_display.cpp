@@ -10,8 +10,13 @@
 #include "Shader.hpp"
 #include "Font.hpp"
 #include "text_display.hpp"
+#include "input_replay.hpp"
 
 #define TOTAL_EFFECTS 7
+//Profiler overlay: lines it has room for, their height, and the font scale it uses
+#define PROFILER_LINES 22
+#define PROFILER_LINE_HEIGHT 0.2
+#define PROFILER_FONT_SCALE glm::vec2(0.13f,0.2f)
 
 Text_Display::Text_Display(Display_Data data) {
     this->data = data;
@@ -21,6 +26,7 @@ void Text_Display::initialize() {
   set_basic_rectangle(&rect_player_coordinates,glm::vec3(0.8,-5.0,0.0),5.0,0.4);
   set_basic_rectangle(&rect_effects_list,glm::vec3(-5.0,2.1,0.0),2.3,3.9);
   set_basic_rectangle(&rect_key_status,glm::vec3(3.2,4.65,0.0),1.8,0.4);
+  set_basic_rectangle(&rect_profiler,glm::vec3(-5.0,-4.6,0.0),5.6,PROFILER_LINES*PROFILER_LINE_HEIGHT);
 
   //Effects Selection Highlight
   effects.push_back("1) Default");
@@ -48,24 +54,30 @@ float Text_Display::get_alpha_value() {
 
 void Text_Display::process_input(GLFWwindow* win) {
   //Effects List
-  if (glfwGetKey(win,GLFW_KEY_E) == GLFW_PRESS && effects_list_flag) {
+  if (Input_Replay::get_key(win,GLFW_KEY_E) == GLFW_PRESS && effects_list_flag) {
     effects_list_activated = !effects_list_activated;
     effects_list_flag = false;
   }
-  if (glfwGetKey(win,GLFW_KEY_E) == GLFW_RELEASE) effects_list_flag = true;
+  if (Input_Replay::get_key(win,GLFW_KEY_E) == GLFW_RELEASE) effects_list_flag = true;
+
+  //Profiler Overlay
+  if (Input_Replay::get_key(win,GLFW_KEY_F3) == GLFW_PRESS && profiler_flag) {
+    profiler_activated = !profiler_activated;
+    profiler_flag = false;
+  }
+  if (Input_Replay::get_key(win,GLFW_KEY_F3) == GLFW_RELEASE) profiler_flag = true;
 }
 
 void Text_Display::render_player_coordinates(glm::vec3 camPos) {
   data.fill_program->use();
-  data.fill_program->setMat4("model",glm::mat4(1.0f));
-  data.fill_program->setMat4("view",glm::mat4(1.0));
-  data.fill_program->setMat4("projection",glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
-  data.fill_program->setBool("use_set_color",true);
-  data.fill_program->setVec4("set_color",glm::vec4(0.0f,0.0f,0.7f,0.3f));
-  rect_player_coordinates.draw(data.fill_program->ID);
-  data.fill_program->setMat4("view",data.view);
-  data.fill_program->setMat4("projection",data.projection);
-  data.fill_program->setBool("use_set_color",false);
+  data.fill_program->setMat4(data.fill_program->draw_uniforms.model,glm::mat4(1.0f));
+  data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,true);
+  data.fill_program->setMat4(data.fill_program->draw_uniforms.screen_projection,glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
+  data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,true);
+  data.fill_program->setVec4(data.fill_program->draw_uniforms.set_color,glm::vec4(0.0f,0.0f,0.7f,0.3f));
+  rect_player_coordinates.draw(data.fill_program);
+  data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,false);
+  data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,false);
 
   //Display String
   std::string labels[3] = {"X","Y","Z"};
@@ -86,26 +98,24 @@ void Text_Display::render_player_coordinates(glm::vec3 camPos) {
 void Text_Display::render_effects_list(int effect_id) {
   if (effects_list_activated) {
     data.fill_program->use();
-    data.fill_program->setMat4("model",glm::mat4(1.0f));
-    data.fill_program->setMat4("view",glm::mat4(1.0));
-    data.fill_program->setMat4("projection",glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
-    data.fill_program->setBool("use_set_color",true);
-    data.fill_program->setVec4("set_color",glm::vec4(1.0f,1.0f,0.0f,0.7f));
-    rect_selects.at(effect_id-1)->draw(data.fill_program->ID);
-    data.fill_program->setMat4("view",data.view);
-    data.fill_program->setMat4("projection",data.projection);
-    data.fill_program->setBool("use_set_color",false);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.model,glm::mat4(1.0f));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,true);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.screen_projection,glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,true);
+    data.fill_program->setVec4(data.fill_program->draw_uniforms.set_color,glm::vec4(1.0f,1.0f,0.0f,0.7f));
+    rect_selects.at(effect_id-1)->draw(data.fill_program);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,false);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,false);
 
     data.fill_program->use();
-    data.fill_program->setMat4("model",glm::mat4(1.0f));
-    data.fill_program->setMat4("view",glm::mat4(1.0));
-    data.fill_program->setMat4("projection",glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
-    data.fill_program->setBool("use_set_color",true);
-    data.fill_program->setVec4("set_color",glm::vec4(0.6f,0.6f,0.6f,0.5f));
-    rect_effects_list.draw(data.fill_program->ID);
-    data.fill_program->setMat4("view",data.view);
-    data.fill_program->setMat4("projection",data.projection);
-    data.fill_program->setBool("use_set_color",false);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.model,glm::mat4(1.0f));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,true);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.screen_projection,glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,true);
+    data.fill_program->setVec4(data.fill_program->draw_uniforms.set_color,glm::vec4(0.6f,0.6f,0.6f,0.5f));
+    rect_effects_list.draw(data.fill_program);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,false);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,false);
 
     double y_pos = 4.55;
     for (int i = 0; i < effects.size(); i++) {
@@ -121,15 +131,14 @@ void Text_Display::render_effects_list(int effect_id) {
 void Text_Display::render_key_status(bool key_collected) {
   if (key_collected) {
     data.fill_program->use();
-    data.fill_program->setMat4("model",glm::mat4(1.0f));
-    data.fill_program->setMat4("view",glm::mat4(1.0));
-    data.fill_program->setMat4("projection",glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
-    data.fill_program->setBool("use_set_color",true);
-    data.fill_program->setVec4("set_color",glm::vec4(0.0f,1.0f,0.0f,0.5f));
-    rect_key_status.draw(data.fill_program->ID);
-    data.fill_program->setMat4("view",data.view);
-    data.fill_program->setMat4("projection",data.projection);
-    data.fill_program->setBool("use_set_color",false);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.model,glm::mat4(1.0f));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,true);
+    data.fill_program->setMat4(data.fill_program->draw_uniforms.screen_projection,glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,true);
+    data.fill_program->setVec4(data.fill_program->draw_uniforms.set_color,glm::vec4(0.0f,1.0f,0.0f,0.5f));
+    rect_key_status.draw(data.fill_program);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,false);
+    data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,false);
 
     //Display String
     std::string disp_string = "Key Collected!";
@@ -138,4 +147,37 @@ void Text_Display::render_key_status(bool key_collected) {
     data.font_program->use();
     data.font_program->setFloat("alpha",alpha_value);
   }
-}
\ No newline at end of file
+}
+
+void Text_Display::render_profiler(const std::vector<std::string>& lines) {
+  if (!profiler_activated) return;
+  //The default framebuffer's depth and stencil are never cleared, so draw over everything
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+
+  data.fill_program->use();
+  data.fill_program->setMat4(data.fill_program->draw_uniforms.model,glm::mat4(1.0f));
+  data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,true);
+  data.fill_program->setMat4(data.fill_program->draw_uniforms.screen_projection,glm::ortho(-5.0,5.0,-5.0,5.0,-1.0,1.0));
+  data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,true);
+  data.fill_program->setVec4(data.fill_program->draw_uniforms.set_color,glm::vec4(0.0f,0.0f,0.0f,0.6f));
+  rect_profiler.draw(data.fill_program);
+  data.fill_program->setBool(data.fill_program->draw_uniforms.screen_space,false);
+  data.fill_program->setBool(data.fill_program->draw_uniforms.use_set_color,false);
+
+  //Header first, then as many scopes as fit
+  glm::vec2 scale = data.font->getScale();
+  data.font->setScale(PROFILER_FONT_SCALE);
+  double y_pos = -4.6 + (PROFILER_LINES-1)*PROFILER_LINE_HEIGHT;
+  data.font->draw_text("Frame profile (ms, min/avg/p99)",glm::vec2(-4.9,y_pos),*data.font_program);
+  for (int i = 0; i < (int)lines.size() && i < PROFILER_LINES-1; i++) {
+    y_pos -= PROFILER_LINE_HEIGHT;
+    data.font->draw_text(lines[i],glm::vec2(-4.9,y_pos),*data.font_program);
+  }
+  data.font->setScale(scale);
+
+  data.font_program->use();
+  data.font_program->setFloat("alpha",alpha_value);
+  glEnable(GL_STENCIL_TEST);
+  glEnable(GL_DEPTH_TEST);
+}
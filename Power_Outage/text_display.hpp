@@ -12,8 +12,6 @@
 struct Display_Data {
   Shader * fill_program;
   Shader * font_program;
-  glm::mat4 view;
-  glm::mat4 projection;
   Font * font;
 };
 
@@ -29,6 +27,9 @@ class Text_Display {
     void render_player_coordinates(glm::vec3 camPos);
     void render_effects_list(int effect_id);
     void render_key_status(bool key_collected);
+    //Draws the given lines (e.g. Profiler::summary_lines()) in small print over the lower left
+    //of the screen.  Meant for the default framebuffer, after post processing.
+    void render_profiler(const std::vector<std::string>& lines);
 
     Shape rect_player_coordinates;
     Shape rect_effects_list;
@@ -45,6 +46,10 @@ class Text_Display {
     Shape rect_key_status;
     bool effects_list_flag = true;
     bool effects_list_activated = false;
+
+    Shape rect_profiler;
+    bool profiler_flag = true;
+    bool profiler_activated = false;
 };
 
 #endif //TEXT_DISPLAY_HPP
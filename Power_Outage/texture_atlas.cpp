@@ -0,0 +1,273 @@
+#include "texture_atlas.hpp"
+#include "gl_state_cache.hpp"
+#include "mip_generator.hpp"
+#include "texture_cache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+void set_atlas_uniforms(const Shader* shader, const Atlas_Region& region) {
+    const Draw_Uniforms& uniforms = shader->draw_uniforms;
+    if (region.layer < 0) {
+        shader->setBool(uniforms.use_atlas,false);
+        return;
+    }
+    shader->setBool(uniforms.use_atlas,true);
+    shader->setVec4(uniforms.atlas_rect,region.rect);
+    shader->setFloat(uniforms.atlas_layer,(float)region.layer);
+}
+
+Texture_Atlas::Texture_Atlas(int layer_size, int max_texture_size)
+    : layer_size(layer_size), max_texture_size(max_texture_size) {
+}
+
+Texture_Atlas::~Texture_Atlas() {
+    for (size_t i = 0; i < entries.size(); i++) free_texture_image(entries[i].image);
+    if (texture != 0) glDeleteTextures(1,&texture);
+}
+
+int Texture_Atlas::find(const std::string& path) {
+    std::string canonical = Texture_Cache::canonical_path(path);
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].path == canonical) return i;
+    }
+    return -1;
+}
+
+int Texture_Atlas::add(const std::string& path, Texture_Image& image) {
+    int handle = find(path);
+    if (handle >= 0) {
+        free_texture_image(image);
+        return handle;
+    }
+    if (image.data != NULL && (image.width > max_texture_size || image.height > max_texture_size)) return -1;
+    Entry entry;
+    entry.path = Texture_Cache::canonical_path(path);
+    entry.image = image;
+    image = Texture_Image();
+    if (entry.image.data == NULL || entry.image.compressed_format != 0) {
+        if (entry.image.data != NULL) {
+            std::cout << "ERROR: Texture_Atlas needs decoded pixels, not compressed ones, for " << path << std::endl;
+        }
+        else std::cout << "ERROR: could not load texture " << path << std::endl;
+        free_texture_image(entry.image);
+        entry.missing = true;
+        entry.width = 1;
+        entry.height = 1;
+    }
+    else {
+        entry.width = entry.image.width;
+        entry.height = entry.image.height;
+    }
+    entries.push_back(entry);
+    return entries.size() - 1;
+}
+
+bool Texture_Atlas::skyline_find(const std::vector<Skyline_Node>& skyline, int width, int height, int& x, int& y) {
+    int best_y = INT_MAX;
+    for (size_t i = 0; i < skyline.size(); i++) {
+        int left = skyline[i].x;
+        if (left + width > layer_size) break;
+        //The box rests on the highest node under it
+        int top = 0;
+        int covered = 0;
+        for (size_t j = i; covered < width && j < skyline.size(); j++) {
+            top = std::max(top,skyline[j].y);
+            covered += skyline[j].width;
+        }
+        if (top + height > layer_size || top >= best_y) continue;
+        best_y = top;
+        x = left;
+    }
+    if (best_y == INT_MAX) return false;
+    y = best_y;
+    return true;
+}
+
+void Texture_Atlas::skyline_add(std::vector<Skyline_Node>& skyline, int x, int y, int width, int height) {
+    size_t index = 0;
+    while (index < skyline.size() && skyline[index].x < x) index++;
+    Skyline_Node node = {x, y + height, width};
+    skyline.insert(skyline.begin() + index,node);
+    //Cut the nodes the box now covers
+    for (size_t i = index + 1; i < skyline.size();) {
+        int overlap = x + width - skyline[i].x;
+        if (overlap <= 0) break;
+        skyline[i].x += overlap;
+        skyline[i].width -= overlap;
+        if (skyline[i].width > 0) break;
+        skyline.erase(skyline.begin() + i);
+    }
+    //Neighbors at the same height become one node
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else i++;
+    }
+}
+
+void Texture_Atlas::blit(const Entry& entry, unsigned char* layer) {
+    //Level 0 comes first in decode_texture's chain
+    const unsigned char* level = entry.image.data;
+    int source_channels = entry.image.channels;
+    for (int row = -ATLAS_GUTTER; row < entry.box_height - ATLAS_GUTTER; row++) {
+        int source_row = (row % entry.height + entry.height) % entry.height;
+        unsigned char* target = layer + ((size_t)(entry.y + row) * layer_size + entry.x - ATLAS_GUTTER) * channels;
+        for (int column = -ATLAS_GUTTER; column < entry.box_width - ATLAS_GUTTER; column++, target += channels) {
+            unsigned char texel[4] = {128, 128, 128, 255};
+            if (!entry.missing) {
+                int source_column = (column % entry.width + entry.width) % entry.width;
+                const unsigned char* source = level + ((size_t)source_row * entry.width + source_column) * source_channels;
+                for (int c = 0; c < 3; c++) texel[c] = source[source_channels < 3 ? 0 : c];
+                if (source_channels == 2 || source_channels == 4) texel[3] = source[source_channels - 1];
+            }
+            memcpy(target,texel,channels);
+        }
+    }
+}
+
+bool Texture_Atlas::build() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (entries.empty()) {
+        std::cout << "ERROR: Texture_Atlas has no textures to build" << std::endl;
+        return false;
+    }
+    //Tallest first, then widest, keeps the skyline flat
+    std::vector<int> order(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(),order.end(),[this](int a, int b) {
+        if (entries[a].height != entries[b].height) return entries[a].height > entries[b].height;
+        return entries[a].width > entries[b].width;
+    });
+    channels = 3;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (!entries[i].missing && (entries[i].image.channels == 2 || entries[i].image.channels == 4)) channels = 4;
+    }
+
+    std::vector<std::vector<Skyline_Node> > skylines;
+    layer_texels.clear();
+    for (size_t i = 0; i < order.size(); i++) {
+        Entry& entry = entries[order[i]];
+        entry.box_width = (entry.width + 2 * ATLAS_GUTTER + ATLAS_ALIGN - 1) / ATLAS_ALIGN * ATLAS_ALIGN;
+        entry.box_height = (entry.height + 2 * ATLAS_GUTTER + ATLAS_ALIGN - 1) / ATLAS_ALIGN * ATLAS_ALIGN;
+        int width = entry.box_width, height = entry.box_height;
+        if (width > layer_size || height > layer_size) {
+            std::cout << "ERROR: " << entry.path << " does not fit a " << layer_size << "x" << layer_size << " atlas layer" << std::endl;
+            return false;
+        }
+        int x = 0, y = 0;
+        entry.layer = -1;
+        for (size_t l = 0; l < skylines.size() && entry.layer < 0; l++) {
+            if (skyline_find(skylines[l],width,height,x,y)) entry.layer = l;
+        }
+        if (entry.layer < 0) {
+            Skyline_Node floor = {0, 0, layer_size};
+            skylines.push_back(std::vector<Skyline_Node>(1,floor));
+            layer_texels.push_back(0);
+            entry.layer = skylines.size() - 1;
+            skyline_find(skylines.back(),width,height,x,y);
+        }
+        skyline_add(skylines[entry.layer],x,y,width,height);
+        layer_texels[entry.layer] += (size_t)width * height;
+        entry.x = x + ATLAS_GUTTER;
+        entry.y = y + ATLAS_GUTTER;
+    }
+    layers = skylines.size();
+
+    //Sampled like upload_texture's textures, through the first ATLAS_MIP_LEVELS levels (the
+    //shader picks the level from the unwrapped coordinates).  The shader does the repeating,
+    //hence the clamp.
+    if (texture == 0) glGenTextures(1,&texture);
+    GL_State_Cache::bind_texture(ATLAS_TEXTURE_UNIT,GL_TEXTURE_2D_ARRAY,texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAX_LEVEL,ATLAS_MIP_LEVELS - 1);
+    int format = channels > 3 ? GL_RGBA : GL_RGB;
+    for (int level = 0; level < ATLAS_MIP_LEVELS; level++) {
+        int size = std::max(layer_size >> level,1);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY,level,format,size,size,layers,0,format,GL_UNSIGNED_BYTE,NULL);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    for (int l = 0; l < layers; l++) {
+        //The layer as one image, so the mip generator filters it like any other texture
+        Texture_Image image;
+        image.width = layer_size;
+        image.height = layer_size;
+        image.channels = channels;
+        image.data_bytes = (size_t)layer_size * layer_size * channels;
+        image.data = (unsigned char*)calloc(image.data_bytes,1);
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].layer == l) blit(entries[i],image.data);
+        }
+        generate_mip_chain(image);
+        const unsigned char* level_pixels = image.data;
+        for (int level = 0; level < ATLAS_MIP_LEVELS && level < image.mip_levels; level++) {
+            int size = std::max(layer_size >> level,1);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY,level,0,0,l,size,size,1,format,GL_UNSIGNED_BYTE,level_pixels);
+            level_pixels += (size_t)size * size * channels;
+        }
+        free(image.data);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT,4);
+    for (size_t i = 0; i < entries.size(); i++) free_texture_image(entries[i].image);
+    build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+unsigned int Texture_Atlas::get_texture() {
+    return texture;
+}
+
+Atlas_Region Texture_Atlas::get_region(int handle) {
+    Atlas_Region region;
+    if (handle < 0 || handle >= (int)entries.size()) {
+        std::cout << "ERROR: Texture_Atlas has no texture " << handle << std::endl;
+        return region;
+    }
+    const Entry& entry = entries[handle];
+    if (entry.layer < 0 || layers == 0) return region;
+    region.layer = entry.layer;
+    region.rect = glm::vec4(entry.x,entry.y,entry.width,entry.height) / (float)layer_size;
+    return region;
+}
+
+int Texture_Atlas::get_layer_count() {
+    return layers;
+}
+
+size_t Texture_Atlas::get_resident_bytes() {
+    //Drivers may pad RGB to four bytes per texel, as Texture_Cache assumes
+    size_t bytes = 0;
+    for (int level = 0; level < ATLAS_MIP_LEVELS; level++) {
+        size_t size = std::max(layer_size >> level,1);
+        bytes += size * size * channels * layers;
+    }
+    return bytes;
+}
+
+void Texture_Atlas::print_report() {
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Texture atlas: " << entries.size() << " textures in " << layers << " layers of "
+              << layer_size << "x" << layer_size << " (" << get_resident_bytes() / (1024.0 * 1024.0)
+              << " MB, built in " << build_ms << " ms)" << std::endl;
+    for (int l = 0; l < layers; l++) {
+        std::cout << "  layer " << l << ": " << 100.0 * layer_texels[l] / ((double)layer_size * layer_size) << "% used" << std::endl;
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry& entry = entries[i];
+        std::cout << "  " << std::left << std::setw(40) << entry.path << std::right;
+        if (entry.missing) std::cout << " missing (gray)";
+        else std::cout << std::setw(5) << entry.width << "x" << entry.height;
+        std::cout << " layer " << entry.layer << " at " << entry.x << "," << entry.y << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
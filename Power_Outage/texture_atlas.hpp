@@ -0,0 +1,118 @@
+#ifndef TEXTURE_ATLAS_HPP
+#define TEXTURE_ATLAS_HPP
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "build_shapes.hpp"
+#include "Shader.hpp"
+
+//Side of every atlas layer in texels
+#define ATLAS_LAYER_SIZE 2048
+//Images larger than this on either side are not packed; they stay standalone textures at full
+//resolution.  With the current models that leaves only gold and metal in the atlas (14.2 -> 11.0
+//texture binds per frame in power_outage_bench); a 4096 layer with a 2048 limit also takes the
+//office floor and furniture textures (7.5 binds) but needs 63.8 MB instead of 15.9 MB
+#define ATLAS_MAX_TEXTURE 1024
+//Mip levels stored per layer (level 0 down to 1/8 size).  Levels are made from the whole
+//layer, so coarser ones would blend neighboring images across the gutters.
+#define ATLAS_MIP_LEVELS 4
+//Texels around each image repeating its opposite edges, so filtering at a region's border
+//blends like GL_REPEAT instead of picking up the neighbor.  Two texels of the coarsest level.
+#define ATLAS_GUTTER (2 << (ATLAS_MIP_LEVELS - 1))
+//Images (with their gutters) are placed on this grid, so each level's texels cover whole
+//blocks of the level above
+#define ATLAS_ALIGN (1 << (ATLAS_MIP_LEVELS - 1))
+//Texture unit the import programs' atlas_image sampler reads (must not alias texture_image,
+//depth_image or material_buffer)
+#define ATLAS_TEXTURE_UNIT 3
+
+//Where a texture landed in a Texture_Atlas.  The import shaders map a model's coordinates into
+//it as rect.xy + fract(uv) * rect.zw on the given layer (see importFragmentShader.glsl).
+struct Atlas_Region {
+    int layer = -1; //-1: not in an atlas
+    glm::vec4 rect = glm::vec4(0.0f,0.0f,1.0f,1.0f);
+};
+
+//Points a program's atlas uniforms (use_atlas, atlas_rect, atlas_layer) at region for the next
+//draw.  A region outside the atlas turns use_atlas off.
+void set_atlas_uniforms(const Shader* shader, const Atlas_Region& region);
+
+//Packs many small textures into the layers of one GL_TEXTURE_2D_ARRAY, so every draw that
+//samples one of them can share a single bound texture and only change uniforms.  add() the
+//decoded images (from one thread at a time), then build() places them with a skyline packer,
+//tallest first, and uploads every layer with its first ATLAS_MIP_LEVELS mip levels.  Only call build() and the destructor on the
+//thread that owns the OpenGL context.
+class Texture_Atlas {
+    public:
+        Texture_Atlas(int layer_size = ATLAS_LAYER_SIZE, int max_texture_size = ATLAS_MAX_TEXTURE);
+        ~Texture_Atlas();
+
+        //Takes over decoded pixels for path (as decode_texture leaves them, mip chain included)
+        //and returns the entry's handle.  A path already added returns the same handle and frees
+        //image.  An image that failed to decode (no data) draws mid-gray, like the placeholder
+        //of a texture that did not load.  An image larger than max_texture_size on either side
+        //returns -1 and is left in image for the caller to upload on its own.
+        int add(const std::string& path, Texture_Image& image);
+        //Handle of path, or -1 if it was never added
+        int find(const std::string& path);
+
+        //Packs every entry and uploads the layers.  False if nothing was added or an image does
+        //not fit a layer.  Entries added afterwards are not placed.
+        bool build();
+
+        unsigned int get_texture();
+        //The entry's region (layer -1 for a bad handle or before build)
+        Atlas_Region get_region(int handle);
+        int get_layer_count();
+        //Bytes of all the layers (and their mip levels) on the GPU
+        size_t get_resident_bytes();
+        //Prints the layers, how full they are, and where each entry went
+        void print_report();
+
+    private:
+        Texture_Atlas(const Texture_Atlas&);
+        Texture_Atlas& operator=(const Texture_Atlas&);
+
+        struct Entry {
+            std::string path;
+            Texture_Image image;
+            //No pixels: drawn as one mid-gray texel
+            bool missing = false;
+            //Size of image's level 0, the only one that goes in
+            int width = 0;
+            int height = 0;
+            //Corner of the image inside its layer (past the gutter), and the size of the box it
+            //takes there (gutters and alignment included)
+            int layer = -1;
+            int x = 0;
+            int y = 0;
+            int box_width = 0;
+            int box_height = 0;
+        };
+        //One run of the skyline: the top of what has been placed from x to x + width
+        struct Skyline_Node {
+            int x;
+            int y;
+            int width;
+        };
+
+        //Finds the lowest spot for a width x height box; false if it does not fit the layer
+        bool skyline_find(const std::vector<Skyline_Node>& skyline, int width, int height, int& x, int& y);
+        void skyline_add(std::vector<Skyline_Node>& skyline, int x, int y, int width, int height);
+        //Copies the entry's image, repeated over the rest of its box, into the layer's pixels
+        void blit(const Entry& entry, unsigned char* layer);
+
+        int layer_size;
+        int max_texture_size;
+        int channels = 3;
+        int layers = 0;
+        unsigned int texture = 0;
+        std::vector<Entry> entries;
+        //Texels covered by the entries and their gutters, per layer
+        std::vector<size_t> layer_texels;
+        double build_ms = 0.0;
+};
+
+#endif //TEXTURE_ATLAS_HPP
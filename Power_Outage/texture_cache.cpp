@@ -0,0 +1,165 @@
+#include "texture_cache.hpp"
+#include "compressed_texture.hpp"
+#include "gl_state_cache.hpp"
+#include <glad/glad.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+std::map<std::string,Texture_Cache::Entry> Texture_Cache::entries;
+std::map<unsigned int,std::string> Texture_Cache::paths_by_texture;
+Texture_Cache_Stats Texture_Cache::stats;
+
+std::string Texture_Cache::canonical_path(const std::string& path) {
+    //Split on either separator; runs of them give empty parts, which are dropped
+    std::vector<std::string> parts;
+    std::string part;
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+    for (size_t i = 0; i <= path.size(); i++) {
+        if (i < path.size() && path[i] != '/' && path[i] != '\\') {
+            part += path[i];
+            continue;
+        }
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") parts.pop_back();
+            else if (!absolute) parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".") parts.push_back(part);
+        part.clear();
+    }
+    std::string canonical = absolute ? "/" : "";
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) canonical += '/';
+        canonical += parts[i];
+    }
+    return canonical;
+}
+
+//Every mip level down to 1x1, as glGenerateMipmap makes them
+size_t Texture_Cache::texture_bytes(int width, int height, int channels) {
+    int texel_bytes = channels > 3 ? 4 : 3;
+    size_t bytes = 0;
+    while (width > 0 && height > 0) {
+        bytes += (size_t)width * height * texel_bytes;
+        if (width == 1 && height == 1) break;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+size_t Texture_Cache::texture_bytes(const Texture_Image& image) {
+    if (image.compressed_format != 0) return image.data_bytes;
+    return texture_bytes(image.width,image.height,image.channels);
+}
+
+unsigned int Texture_Cache::acquire(const std::string& path, Texture_Image* decoded) {
+    std::string key = canonical_path(path);
+    stats.requests++;
+    std::map<std::string,Entry>::iterator found = entries.find(key);
+    if (found != entries.end()) {
+        if (decoded != NULL) free_texture_image(*decoded);
+        found->second.references++;
+        stats.hits++;
+        return found->second.texture;
+    }
+
+    Texture_Image image;
+    if (decoded != NULL && decoded->data != NULL) {
+        image = *decoded;
+        decoded->data = NULL;
+    }
+    else decode_texture(key,image,compressed_textures_supported());
+    Entry entry;
+    entry.path = key;
+    //upload_texture frees the pixels, so size the texture first (nothing is stored if decoding failed)
+    if (image.data != NULL) entry.bytes = texture_bytes(image);
+    entry.compressed = image.compressed_format != 0;
+    entry.texture = upload_texture(image);
+    entry.references = 1;
+    entries[key] = entry;
+    paths_by_texture[entry.texture] = key;
+    stats.textures++;
+    stats.resident_bytes += entry.bytes;
+    return entry.texture;
+}
+
+void Texture_Cache::release(unsigned int texture) {
+    std::map<unsigned int,std::string>::iterator path = paths_by_texture.find(texture);
+    if (path == paths_by_texture.end()) return;
+    Entry& entry = entries[path->second];
+    if (--entry.references > 0) return;
+    glDeleteTextures(1,&texture);
+    //The next glGenTextures may hand out the same name, which must not look bound already
+    GL_State_Cache::invalidate();
+    stats.textures--;
+    stats.resident_bytes -= entry.bytes;
+    entries.erase(path->second);
+    paths_by_texture.erase(path);
+}
+
+unsigned int Texture_Cache::retain(unsigned int texture) {
+    std::map<unsigned int,std::string>::iterator path = paths_by_texture.find(texture);
+    if (path != paths_by_texture.end()) entries[path->second].references++;
+    return texture;
+}
+
+unsigned int Texture_Cache::find(const std::string& path) {
+    std::map<std::string,Entry>::iterator found = entries.find(canonical_path(path));
+    if (found == entries.end()) return 0;
+    stats.requests++;
+    stats.hits++;
+    found->second.references++;
+    return found->second.texture;
+}
+
+void Texture_Cache::add(const std::string& path, unsigned int texture, size_t bytes) {
+    Entry entry;
+    entry.path = canonical_path(path);
+    entry.texture = texture;
+    entry.references = 1;
+    entry.bytes = bytes;
+    if (entries.count(entry.path) > 0) {
+        std::cout << "ERROR: Texture_Cache already holds " << entry.path << std::endl;
+        return;
+    }
+    entries[entry.path] = entry;
+    paths_by_texture[texture] = entry.path;
+    stats.requests++;
+    stats.textures++;
+    stats.resident_bytes += bytes;
+}
+
+void Texture_Cache::set_resident_bytes(unsigned int texture, size_t bytes, bool compressed) {
+    std::map<unsigned int,std::string>::iterator path = paths_by_texture.find(texture);
+    if (path == paths_by_texture.end()) return;
+    Entry& entry = entries[path->second];
+    stats.resident_bytes = stats.resident_bytes - entry.bytes + bytes;
+    entry.bytes = bytes;
+    entry.compressed = compressed;
+}
+
+size_t Texture_Cache::get_resident_bytes(unsigned int texture) {
+    std::map<unsigned int,std::string>::iterator path = paths_by_texture.find(texture);
+    if (path == paths_by_texture.end()) return 0;
+    return entries[path->second].bytes;
+}
+
+Texture_Cache_Stats Texture_Cache::get_stats() {
+    return stats;
+}
+
+void Texture_Cache::print_report() {
+    double hit_rate = stats.requests > 0 ? 100.0 * stats.hits / stats.requests : 0.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Texture cache: " << stats.requests << " requests, " << stats.hits << " hits ("
+              << hit_rate << "%), " << stats.textures << " textures, "
+              << stats.resident_bytes / (1024.0 * 1024.0) << " MB resident" << std::endl;
+    for (std::map<std::string,Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        std::cout << "  " << std::left << std::setw(40) << it->first << std::right << std::setw(4)
+                  << it->second.references << " refs" << std::setw(10) << it->second.bytes / 1024.0 << " KB"
+                  << (it->second.compressed ? " (BC)" : "") << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+}
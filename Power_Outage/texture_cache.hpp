@@ -0,0 +1,69 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include "build_shapes.hpp"
+
+//Requests and hits since startup, plus what is resident right now
+struct Texture_Cache_Stats {
+    unsigned int requests = 0;
+    unsigned int hits = 0;
+    unsigned int textures = 0;
+    size_t resident_bytes = 0;
+};
+
+//Shares one GL texture between everything that loads the same image file.  Paths are
+//canonicalized first (see canonical_path), so "textures\\gold.jpg" from an .MTL file and
+//"textures/gold.jpg" from code are the same texture.  Every acquire() adds a reference and
+//every release() drops one; the texture is deleted when the last one goes.  Only call it on
+//the thread that owns the OpenGL context (canonical_path is safe anywhere).
+class Texture_Cache {
+    public:
+        //Forward slashes, no repeated separators, no "." and no "dir/.." components
+        static std::string canonical_path(const std::string& path);
+
+        //Returns the texture for path, decoding and uploading the image only the first time.
+        //decoded may hold the image already decoded on a worker (see Asset_Loader); it is
+        //uploaded on a miss and freed on a hit.
+        static unsigned int acquire(const std::string& path, Texture_Image* decoded = NULL);
+        //Drops a reference taken by acquire(), find(), add() or retain() (textures the cache does
+        //not know are ignored)
+        static void release(unsigned int texture);
+        //Adds a reference to a texture the cache handed out, for a second owner; returns texture
+        static unsigned int retain(unsigned int texture);
+
+        //For textures created elsewhere (Texture_Streamer): find() returns the cached texture
+        //with a reference added, or 0 if there is none; add() enters a new one with one reference
+        //and set_resident_bytes() updates its size once its pixels are in.
+        static unsigned int find(const std::string& path);
+        static void add(const std::string& path, unsigned int texture, size_t bytes);
+        static void set_resident_bytes(unsigned int texture, size_t bytes, bool compressed = false);
+        //Bytes of a width x height texture with 3 or 4 channels and its mip chain
+        static size_t texture_bytes(int width, int height, int channels);
+        //Bytes the image will take once uploaded (its compressed mip chain as stored)
+        static size_t texture_bytes(const Texture_Image& image);
+
+        //Estimated GPU memory of one texture: the requested RGB8/RGBA8 image plus its mip chain
+        //(drivers may pad RGB to four bytes per texel)
+        static size_t get_resident_bytes(unsigned int texture);
+        static Texture_Cache_Stats get_stats();
+        //Prints the hit rate, each resident texture (marking the block-compressed ones) and the total
+        static void print_report();
+
+    private:
+        struct Entry {
+            std::string path;
+            unsigned int texture = 0;
+            int references = 0;
+            size_t bytes = 0;
+            bool compressed = false;
+        };
+
+        static std::map<std::string,Entry> entries;
+        static std::map<unsigned int,std::string> paths_by_texture;
+        static Texture_Cache_Stats stats;
+};
+
+#endif //TEXTURE_CACHE_HPP
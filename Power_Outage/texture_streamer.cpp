@@ -0,0 +1,176 @@
+#include "texture_streamer.hpp"
+#include "compressed_texture.hpp"
+#include "gl_state_cache.hpp"
+#include "texture_cache.hpp"
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+Texture_Streamer::Texture_Streamer(int num_threads, size_t bytes_per_frame)
+    : bytes_per_frame(bytes_per_frame), pool(num_threads) {
+    for (int i = 0; i < TEXTURE_STREAM_PBOS; i++) glGenBuffers(1,&this->buffers[i].buffer);
+}
+
+Texture_Streamer::~Texture_Streamer() {
+    this->pool.wait();
+    for (size_t i = 0; i < this->decoded.size(); i++) {
+        free_texture_image(this->decoded[i]->image);
+        delete this->decoded[i];
+    }
+    for (size_t i = 0; i < this->uploads.size(); i++) {
+        free_texture_image(this->uploads[i]->image);
+        delete this->uploads[i];
+    }
+    for (int i = 0; i < TEXTURE_STREAM_PBOS; i++) {
+        if (this->buffers[i].fence != NULL) glDeleteSync(this->buffers[i].fence);
+        glDeleteBuffers(1,&this->buffers[i].buffer);
+    }
+}
+
+unsigned int Texture_Streamer::request(const std::string& path) {
+    unsigned int texture = Texture_Cache::find(path);
+    if (texture != 0) return texture;
+
+    //The placeholder: one mid-gray texel, with the parameters upload_texture gives real textures
+    unsigned char texel[4] = {128,128,128,255};
+    glGenTextures(1,&texture);
+    GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,texture);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,1,1,0,GL_RGBA,GL_UNSIGNED_BYTE,texel);
+    Texture_Cache::add(path,texture,4);
+
+    Stream_Job* job = new Stream_Job();
+    job->path = Texture_Cache::canonical_path(path);
+    job->texture = texture;
+    job->requested = std::chrono::steady_clock::now();
+    this->decoding++;
+    this->stats.peak_queue_depth = std::max(this->stats.peak_queue_depth,this->decoding + (int)this->uploads.size());
+    bool compressed = compressed_textures_supported();
+    this->pool.submit([this, job, compressed]() {
+        decode_texture(job->path,job->image,compressed);
+        std::lock_guard<std::mutex> lock(this->decoded_mutex);
+        this->decoded.push_back(job);
+    });
+    return texture;
+}
+
+bool Texture_Streamer::upload(Stream_Job* job, bool wait) {
+    Pixel_Buffer& buffer = this->buffers[this->next_buffer];
+    if (buffer.fence != NULL) {
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        GLenum status = glClientWaitSync(buffer.fence,GL_SYNC_FLUSH_COMMANDS_BIT,timeout);
+        if (status == GL_TIMEOUT_EXPIRED) return false;
+        glDeleteSync(buffer.fence);
+        buffer.fence = NULL;
+    }
+
+    Texture_Image& image = job->image;
+    size_t bytes = image.data_bytes;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,buffer.buffer);
+    if (buffer.size < bytes) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER,bytes,NULL,GL_STREAM_DRAW);
+        buffer.size = bytes;
+    }
+    void* pixels = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,0,bytes,GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (pixels == NULL) {
+        //The placeholder stays, and nothing reached the GPU
+        std::cout << "ERROR: could not map a pixel buffer for " << job->path << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+        this->stats.failed++;
+        free_texture_image(image);
+        return true;
+    }
+    memcpy(pixels,image.data,bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    GL_State_Cache::bind_texture(0,GL_TEXTURE_2D,job->texture);
+    //Every level (generated or baked) from offsets in the buffer
+    upload_texture_levels(GL_TEXTURE_2D,image,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAX_LEVEL,image.mip_levels - 1);
+    //The placeholder's GL_LINEAR would never sample the levels below 0
+    if (image.mip_levels > 1) glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+    this->next_buffer = (this->next_buffer + 1) % TEXTURE_STREAM_PBOS;
+    Texture_Cache::set_resident_bytes(job->texture,Texture_Cache::texture_bytes(image),image.compressed_format != 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+
+    this->stats.frame_upload_bytes += bytes;
+    this->stats.total_upload_bytes += bytes;
+    double ms = std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now() - job->requested).count();
+    this->stats.resident++;
+    this->total_time_to_resident_ms += ms;
+    this->stats.max_time_to_resident_ms = std::max(this->stats.max_time_to_resident_ms,ms);
+    free_texture_image(image);
+    return true;
+}
+
+void Texture_Streamer::upload_ready(size_t budget, bool wait) {
+    {
+        std::lock_guard<std::mutex> lock(this->decoded_mutex);
+        for (size_t i = 0; i < this->decoded.size(); i++) {
+            Stream_Job* job = this->decoded[i];
+            this->decoding--;
+            if (job->image.data == NULL) {
+                //The placeholder stays
+                std::cout << "ERROR: could not load texture " << job->path << std::endl;
+                this->stats.failed++;
+                delete job;
+                continue;
+            }
+            this->uploads.push_back(job);
+        }
+        this->decoded.clear();
+    }
+
+    size_t frame_bytes = 0;
+    while (!this->uploads.empty()) {
+        Stream_Job* job = this->uploads.front();
+        size_t bytes = job->image.data_bytes;
+        if (frame_bytes > 0 && frame_bytes + bytes > budget) break;
+        if (!this->upload(job,wait)) break;
+        frame_bytes += bytes;
+        this->uploads.pop_front();
+        delete job;
+    }
+}
+
+void Texture_Streamer::update() {
+    this->stats.frame_upload_bytes = 0;
+    this->upload_ready(this->bytes_per_frame,false);
+    this->end_frame();
+}
+
+void Texture_Streamer::finish() {
+    this->pool.wait();
+    this->stats.frame_upload_bytes = 0;
+    this->upload_ready((size_t)-1,true);
+    this->end_frame();
+}
+
+void Texture_Streamer::end_frame() {
+    if (this->stats.frame_upload_bytes > 0) this->stats.frames_uploading++;
+    this->stats.peak_frame_upload_bytes = std::max(this->stats.peak_frame_upload_bytes,this->stats.frame_upload_bytes);
+}
+
+bool Texture_Streamer::idle() {
+    return this->decoding == 0 && this->uploads.empty();
+}
+
+Texture_Stream_Stats Texture_Streamer::get_stats() {
+    Texture_Stream_Stats current = this->stats;
+    current.decoding = this->decoding;
+    current.waiting_upload = this->uploads.size();
+    current.avg_time_to_resident_ms = current.resident > 0 ? this->total_time_to_resident_ms / current.resident : 0.0;
+    return current;
+}
+
+void Texture_Streamer::print_report() {
+    Texture_Stream_Stats current = this->get_stats();
+    std::cout << "Texture streaming: " << current.resident << " resident, " << current.failed << " failed, "
+              << current.decoding + current.waiting_upload << " queued (peak " << current.peak_queue_depth << "); "
+              << current.total_upload_bytes / (1024.0 * 1024.0) << " MB over " << current.frames_uploading
+              << " frames (peak " << current.peak_frame_upload_bytes / (1024.0 * 1024.0) << " MB/frame); time to resident "
+              << current.avg_time_to_resident_ms << " ms avg, " << current.max_time_to_resident_ms << " ms max" << std::endl;
+}
@@ -0,0 +1,100 @@
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+#include <glad/glad.h>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "build_shapes.hpp"
+#include "thread_pool.hpp"
+
+//Pixel buffer objects the uploads rotate through.  A buffer is reused only once the GPU has
+//finished reading it (a fence per buffer), so up to this many uploads can be in flight.
+#define TEXTURE_STREAM_PBOS 3
+//Default upload budget per update() in bytes of pixels.  A texture larger than the budget is
+//uploaded alone in its frame.
+#define TEXTURE_STREAM_BUDGET (4 * 1024 * 1024)
+
+//Queue depth, upload volume and latency of the streamer.  Times are from request() until the
+//texture's pixels were handed to OpenGL.
+struct Texture_Stream_Stats {
+    int decoding = 0;        //requested, still being decoded on a worker
+    int waiting_upload = 0;  //decoded, waiting for budget or a free pixel buffer
+    int peak_queue_depth = 0;
+    int resident = 0;
+    int failed = 0;
+    size_t frame_upload_bytes = 0;  //during the last update()
+    size_t peak_frame_upload_bytes = 0;
+    size_t total_upload_bytes = 0;
+    int frames_uploading = 0;       //update() calls that uploaded anything
+    double avg_time_to_resident_ms = 0.0;
+    double max_time_to_resident_ms = 0.0;
+};
+
+//Loads textures without stalling the frame: request() returns a texture at once, holding a
+//1x1 placeholder texel, and the image is decoded on worker threads.  update(), called once per
+//frame on the GL context thread, copies decoded images into a ring of pixel buffer objects and
+//specifies the textures from them, within a per-frame byte budget.  The texture's name never
+//changes, so whatever was given it draws the placeholder until the real image is resident.
+//Textures are shared through Texture_Cache like get_texture's.  Destroy it while the context
+//is still current.
+class Texture_Streamer {
+    public:
+        //num_threads <= 0 uses one decode worker per hardware thread.
+        Texture_Streamer(int num_threads = 0, size_t bytes_per_frame = TEXTURE_STREAM_BUDGET);
+        ~Texture_Streamer();
+
+        //Returns the texture for path (the cached one if it is already loaded or streaming)
+        unsigned int request(const std::string& path);
+        //Uploads what the budget allows.  Call once per frame.
+        void update();
+        //Uploads everything, waiting for the decodes (e.g. before measuring frames)
+        void finish();
+        //True when nothing is left to decode or upload
+        bool idle();
+
+        Texture_Stream_Stats get_stats();
+        void print_report();
+
+    private:
+        Texture_Streamer(const Texture_Streamer&);
+        Texture_Streamer& operator=(const Texture_Streamer&);
+
+        struct Stream_Job {
+            std::string path;
+            unsigned int texture = 0;
+            Texture_Image image;
+            std::chrono::steady_clock::time_point requested;
+        };
+        struct Pixel_Buffer {
+            unsigned int buffer = 0;
+            size_t size = 0;
+            GLsync fence = NULL; //set by the last upload from it
+        };
+
+        //Returns false (leaving the job queued) if no pixel buffer is free yet.  A buffer that
+        //cannot be mapped fails the job instead: its placeholder stays.
+        bool upload(Stream_Job* job, bool wait);
+        void upload_ready(size_t budget, bool wait);
+        //Counts this update's uploads into the per-frame stats
+        void end_frame();
+
+        size_t bytes_per_frame;
+        Pixel_Buffer buffers[TEXTURE_STREAM_PBOS];
+        int next_buffer = 0;
+        //Decoded by the workers, in the order they finished (guarded by decoded_mutex)
+        std::mutex decoded_mutex;
+        std::vector<Stream_Job*> decoded;
+        //Waiting for upload, on the context thread only
+        std::deque<Stream_Job*> uploads;
+        int decoding = 0;
+        Texture_Stream_Stats stats;
+        double total_time_to_resident_ms = 0.0;
+        //Last member, so its workers are joined before anything they touch is destroyed
+        Thread_Pool pool;
+};
+
+#endif //TEXTURE_STREAMER_HPP
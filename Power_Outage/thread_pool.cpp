@@ -0,0 +1,68 @@
+#include "thread_pool.hpp"
+
+Thread_Pool::Thread_Pool(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = (int)std::thread::hardware_concurrency();
+    }
+    if (num_threads <= 0) {
+        num_threads = 2; //hardware_concurrency() may not know
+    }
+    for (int i = 0; i < num_threads; i++) {
+        this->workers.push_back(std::thread(&Thread_Pool::worker_loop, this));
+    }
+}
+
+Thread_Pool::~Thread_Pool() {
+    {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->stopping = true;
+    }
+    this->job_ready.notify_all();
+    for (size_t i = 0; i < this->workers.size(); i++) {
+        this->workers[i].join();
+    }
+}
+
+void Thread_Pool::submit(std::function<void()> job) {
+    {
+        std::unique_lock<std::mutex> guard(this->lock);
+        this->jobs.push_back(job);
+    }
+    this->job_ready.notify_one();
+}
+
+void Thread_Pool::wait() {
+    std::unique_lock<std::mutex> guard(this->lock);
+    while (!this->jobs.empty() || this->busy_workers > 0) {
+        this->all_done.wait(guard);
+    }
+}
+
+int Thread_Pool::size() {
+    return (int)this->workers.size();
+}
+
+void Thread_Pool::worker_loop() {
+    std::unique_lock<std::mutex> guard(this->lock);
+    while (true) {
+        while (this->jobs.empty() && !this->stopping) {
+            this->job_ready.wait(guard);
+        }
+        //Drain the queue before stopping so that no submitted job is dropped
+        if (this->jobs.empty()) {
+            return;
+        }
+        std::function<void()> job = this->jobs.front();
+        this->jobs.pop_front();
+        this->busy_workers++;
+
+        guard.unlock();
+        job();
+        guard.lock();
+
+        this->busy_workers--;
+        if (this->jobs.empty() && this->busy_workers == 0) {
+            this->all_done.notify_all();
+        }
+    }
+}
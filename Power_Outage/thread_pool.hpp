@@ -0,0 +1,39 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A fixed set of worker threads pulling jobs from a shared queue.
+//Jobs may submit further jobs; wait() returns once the queue is empty and every worker is idle.
+class Thread_Pool {
+    public:
+        //num_threads <= 0 uses one thread per hardware thread.
+        Thread_Pool(int num_threads = 0);
+        //Finishes the queued jobs, then joins the workers.
+        ~Thread_Pool();
+
+        void submit(std::function<void()> job);
+        void wait();
+        int size();
+
+    private:
+        Thread_Pool(const Thread_Pool&);
+        Thread_Pool& operator=(const Thread_Pool&);
+
+        void worker_loop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()> > jobs;
+        std::mutex lock;
+        std::condition_variable job_ready;
+        std::condition_variable all_done;
+        int busy_workers = 0;
+        bool stopping = false;
+};
+
+#endif //THREAD_POOL_HPP
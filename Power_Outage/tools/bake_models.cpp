@@ -0,0 +1,71 @@
+//Pre-bakes every .obj/.mtl pair under a models directory into .pomesh caches so the
+//game's first launch only maps and uploads binary data.
+//
+//CMake target: bake_models
+//Run (from the Power_Outage directory):
+//  ./build/release/bake_models [models_directory] [--force] [--packed] [--validate]
+//    --packed    bakes the packed vertex layout (<model>.packed.pomesh) instead of the float one
+//    --validate  with --packed, reparses and diffs every packed mesh against its float vertices
+
+#include "import_object.hpp"
+#include "mesh_cache.hpp"
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv) {
+    std::string models_dir = "models";
+    bool force = false;
+    bool packed = false;
+    bool validate = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--force") force = true;
+        else if (arg == "--packed") packed = true;
+        else if (arg == "--validate") validate = true;
+        else models_dir = arg;
+    }
+
+    ImportOBJ importer;
+    importer.debugOutput = false;
+    importer.packVertices = packed;
+    importer.validatePacking = validate;
+    uint32_t layout = packed ? POMESH_LAYOUT_PACKED : POMESH_LAYOUT_FLOAT;
+    int baked = 0, skipped = 0, failed = 0;
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(models_dir)) {
+        if (entry.path().extension() != ".obj") continue;
+        std::string path = entry.path().string();
+        std::string base_name = path.substr(0, path.size() - 4);
+
+        //A cache that still matches its sources is left alone.  open() checks the stat and
+        //falls back to the content hash (re-stamping the header when it matches), so a cache
+        //whose stamp still disagrees could not be re-stamped and is baked again.
+        Mesh_Cache_File existing;
+        if (!force && !validate && existing.open(base_name, layout)) {
+            Mesh_Source_Stamp stamp;
+            get_mesh_source_stamp(base_name, stamp, false);
+            const Mesh_Cache_Header& header = existing.header();
+            if (stamp.obj_mtime == header.obj_mtime && stamp.obj_size == header.obj_size &&
+                stamp.mtl_mtime == header.mtl_mtime && stamp.mtl_size == header.mtl_size) {
+                std::cout << "up to date  " << mesh_cache_path(base_name, layout) << "\n";
+                skipped++;
+                continue;
+            }
+        }
+        existing.close();
+
+        if (importer.parseFiles(base_name) && importer.writeCache(base_name)) {
+            std::cout << "baked       " << mesh_cache_path(base_name, layout) << " (" << importer.getNumCombined()
+                      << " vertices, " << importer.getNumIndices() << " indices)\n";
+            baked++;
+        }
+        else {
+            std::cout << "FAILED      " << base_name << "\n";
+            failed++;
+        }
+    }
+
+    std::cout << baked << " baked, " << skipped << " up to date, " << failed << " failed.\n";
+    return failed == 0 ? 0 : 1;
+}
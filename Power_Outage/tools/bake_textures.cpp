@@ -0,0 +1,138 @@
+//Bakes every image under the texture directories into a block-compressed .dds with its whole
+//mip chain (see compressed_texture.hpp), which get_texture and get_cube_map then load instead
+//of decoding the image and generating mipmaps.  Prints what each asset saves: the GPU memory
+//of the uncompressed RGB8/RGBA8 mip chain against the compressed one, and the time to decode
+//the image with stb_image against the time to read the .dds.
+//
+//CMake target: bake_textures
+//Run (from the Power_Outage directory):
+//  ./build/release/bake_textures [--force] [--cube DIR] [DIR...]
+//    DIR         bakes the images under DIR for get_texture (default: images textures)
+//    --cube DIR  bakes the images under DIR as cube map faces (default: skybox)
+//    --force     rebakes images whose .dds is up to date
+//    --box       filters the mip levels with the 2x2 box instead of the sharper Kaiser filter
+
+#include "build_shapes.hpp"
+#include "compressed_texture.hpp"
+#include "mip_generator.hpp"
+#include "stb_image.h"
+#include "texture_cache.hpp"
+#include <ctype.h>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool is_image(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    for (size_t i = 0; i < extension.size(); i++) extension[i] = tolower(extension[i]);
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".bmp" || extension == ".tga";
+}
+
+int main(int argc, char** argv) {
+    //Each directory with the row order its images are uploaded in (2D textures flipped)
+    std::vector<std::pair<std::string, bool> > directories;
+    bool force = false;
+    //Offline, so the sharper filter and every hardware thread on each image's levels
+    Mip_Options mip_options;
+    mip_options.filter = MIP_FILTER_KAISER;
+    mip_options.num_threads = std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--force") force = true;
+        else if (arg == "--box") mip_options.filter = MIP_FILTER_BOX;
+        else if (arg == "--cube" && i + 1 < argc) directories.push_back(std::make_pair(std::string(argv[++i]), false));
+        else directories.push_back(std::make_pair(arg, true));
+    }
+    if (directories.empty()) {
+        directories.push_back(std::make_pair(std::string("images"), true));
+        directories.push_back(std::make_pair(std::string("textures"), true));
+        directories.push_back(std::make_pair(std::string("skybox"), false));
+    }
+
+    int baked = 0, skipped = 0, failed = 0;
+    size_t total_uncompressed = 0, total_compressed = 0;
+    double total_decode_ms = 0.0, total_read_ms = 0.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(30) << "asset" << std::right << std::setw(11) << "size" << std::setw(6) << "fmt"
+              << std::setw(12) << "RGB(A) KB" << std::setw(10) << "BC KB" << std::setw(8) << "saved"
+              << std::setw(12) << "decode ms" << std::setw(10) << "dds ms" << "\n";
+    for (size_t d = 0; d < directories.size(); d++) {
+        bool flipped = directories[d].second;
+        if (!std::filesystem::is_directory(directories[d].first)) {
+            std::cout << "ERROR: " << directories[d].first << " is not a directory\n";
+            failed++;
+            continue;
+        }
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(directories[d].first)) {
+            if (!entry.is_regular_file() || !is_image(entry.path())) continue;
+            std::string path = entry.path().generic_string();
+
+            Texture_Image existing;
+            if (!force && load_compressed_texture(path, flipped, existing)) {
+                std::cout << "up to date  " << compressed_texture_path(path) << "\n";
+                free_texture_image(existing);
+                skipped++;
+                continue;
+            }
+
+            //Decoded the way the game decodes it when there is no .dds
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            Texture_Image image;
+            stbi_set_flip_vertically_on_load_thread(flipped);
+            image.data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+            double decode_ms = elapsed_ms(start);
+            if (image.data == NULL) {
+                std::cout << "ERROR: could not decode " << path << "\n";
+                failed++;
+                continue;
+            }
+            size_t uncompressed = Texture_Cache::texture_bytes(image.width, image.height, image.channels);
+            size_t compressed = write_compressed_texture(path, image, flipped, mip_options);
+            int width = image.width, height = image.height;
+            free_texture_image(image);
+            if (compressed == 0) {
+                failed++;
+                continue;
+            }
+
+            start = std::chrono::steady_clock::now();
+            Texture_Image reloaded;
+            bool read_back = load_compressed_texture(path, flipped, reloaded);
+            double read_ms = elapsed_ms(start);
+            const char* format = reloaded.compressed_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? "BC3" : "BC1";
+            free_texture_image(reloaded);
+            if (!read_back) {
+                std::cout << "ERROR: could not read back " << compressed_texture_path(path) << "\n";
+                failed++;
+                continue;
+            }
+
+            std::string size = std::to_string(width) + "x" + std::to_string(height);
+            std::cout << std::left << std::setw(30) << path << std::right << std::setw(11) << size << std::setw(6) << format
+                      << std::setw(12) << uncompressed / 1024.0 << std::setw(10) << compressed / 1024.0
+                      << std::setw(7) << 100.0 - 100.0 * compressed / uncompressed << "%"
+                      << std::setw(12) << decode_ms << std::setw(10) << read_ms << "\n";
+            total_uncompressed += uncompressed;
+            total_compressed += compressed;
+            total_decode_ms += decode_ms;
+            total_read_ms += read_ms;
+            baked++;
+        }
+    }
+
+    std::cout << baked << " baked, " << skipped << " up to date, " << failed << " failed\n";
+    if (baked > 0) {
+        std::cout << "GPU memory of the baked textures: " << total_uncompressed / (1024.0 * 1024.0) << " MB -> "
+                  << total_compressed / (1024.0 * 1024.0) << " MB; load time " << total_decode_ms << " ms -> "
+                  << total_read_ms << " ms (plus no glGenerateMipmap)\n";
+    }
+    return failed > 0 ? 1 : 0;
+}
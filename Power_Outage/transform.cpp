@@ -0,0 +1,94 @@
+#include <glm/gtc/matrix_transform.hpp>
+#include "transform.hpp"
+
+unsigned int Transform::rebuilds = 0;
+
+Transform::Transform(glm::vec3 position, glm::vec3 rotation, glm::vec3 scale, float orientation) {
+    this->position = position;
+    this->rotation = rotation;
+    this->scale = scale;
+    this->orientation = orientation;
+}
+
+void Transform::set_position(glm::vec3 position) {
+    if (position == this->position) return;
+    this->position = position;
+    local_dirty = true;
+}
+
+void Transform::set_rotation(glm::vec3 rotation) {
+    if (rotation == this->rotation) return;
+    this->rotation = rotation;
+    local_dirty = true;
+}
+
+void Transform::set_scale(glm::vec3 scale) {
+    if (scale == this->scale) return;
+    this->scale = scale;
+    local_dirty = true;
+}
+
+void Transform::set_orientation(float orientation) {
+    if (orientation == this->orientation) return;
+    this->orientation = orientation;
+    local_dirty = true;
+}
+
+void Transform::set_parent(Transform* parent) {
+    if (parent == this->parent) return;
+    this->parent = parent;
+    world_dirty = true;
+}
+
+glm::vec3 Transform::get_position() {
+    return position;
+}
+
+glm::vec3 Transform::get_rotation() {
+    return rotation;
+}
+
+glm::vec3 Transform::get_scale() {
+    return scale;
+}
+
+float Transform::get_orientation() {
+    return orientation;
+}
+
+const glm::mat4& Transform::get_local_matrix() {
+    if (local_dirty) {
+        glm::mat4 m(1.0f);
+        m = glm::translate(m,position);
+        //Skip the axes that are not rotated so the common y-only case costs one rotate
+        if (rotation.x != 0.0f) m = glm::rotate(m,glm::radians(rotation.x),glm::vec3(1.0,0.0,0.0));
+        if (rotation.y != 0.0f) m = glm::rotate(m,glm::radians(rotation.y),glm::vec3(0.0,1.0,0.0));
+        if (rotation.z != 0.0f) m = glm::rotate(m,glm::radians(rotation.z),glm::vec3(0.0,0.0,1.0));
+        m = glm::scale(m,scale);
+        if (orientation != 0.0f) m = glm::rotate(m,glm::radians(orientation),glm::vec3(0.0,1.0,0.0));
+        local_matrix = m;
+        local_dirty = false;
+        world_dirty = true;
+        rebuilds++;
+    }
+    return local_matrix;
+}
+
+const glm::mat4& Transform::get_world_matrix() {
+    const glm::mat4& local = get_local_matrix();
+    if (parent != NULL) {
+        const glm::mat4& parent_world = parent->get_world_matrix();
+        if (world_dirty || parent->world_version != parent_version) {
+            world_matrix = parent_world * local;
+            parent_version = parent->world_version;
+            world_dirty = false;
+            world_version++;
+        }
+    }
+    else if (world_dirty) {
+        world_matrix = local;
+        world_dirty = false;
+        world_version++;
+    }
+    return world_matrix;
+}
@@ -0,0 +1,52 @@
+#ifndef TRANSFORM_HPP
+#define TRANSFORM_HPP
+
+#include <glm/glm.hpp>
+
+//Position, rotation, scale and a fixed orientation, composed as
+//  translate(position) * rotate_x * rotate_y * rotate_z * scale * rotate_y(orientation)
+//which is the order the moving objects have always built their model matrix in.
+//The local matrix is only rebuilt after a setter actually changes a value, and the world
+//matrix (parent's world * local) only when the local matrix or the parent changed.
+class Transform {
+    public:
+        Transform(glm::vec3 position = glm::vec3(0.0f), glm::vec3 rotation = glm::vec3(0.0f),
+                  glm::vec3 scale = glm::vec3(1.0f), float orientation = 0.0f);
+
+        void set_position(glm::vec3 position);
+        //Euler angles in degrees, applied about x, then y, then z
+        void set_rotation(glm::vec3 rotation);
+        void set_scale(glm::vec3 scale);
+        //Rotation about y (degrees) applied before the scale, e.g. to face a model the right way
+        void set_orientation(float orientation);
+        //Makes this transform relative to another one (NULL for none).  The parent must outlive it.
+        void set_parent(Transform* parent);
+
+        glm::vec3 get_position();
+        glm::vec3 get_rotation();
+        glm::vec3 get_scale();
+        float get_orientation();
+
+        const glm::mat4& get_local_matrix();
+        const glm::mat4& get_world_matrix();
+
+        //Local matrix rebuilds since the last reset, for checking that static objects stay cached
+        static unsigned int rebuilds;
+
+    private:
+        glm::vec3 position;
+        glm::vec3 rotation;
+        glm::vec3 scale;
+        float orientation;
+        Transform* parent = NULL;
+
+        glm::mat4 local_matrix;
+        glm::mat4 world_matrix;
+        bool local_dirty = true;
+        bool world_dirty = true;
+        //Bumped whenever world_matrix changes, so children can tell that they are stale
+        unsigned int world_version = 0;
+        unsigned int parent_version = 0;
+};
+
+#endif //TRANSFORM_HPP
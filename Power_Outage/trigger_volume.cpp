@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <math.h>
+#include <sstream>
+#include "trigger_volume.hpp"
+
+bool load_trigger_configs(std::string path, std::vector<Trigger_Config>& configs) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cout << "ERROR: could not open trigger file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file,line)) {
+        line_number++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line = line.substr(0,comment);
+        std::istringstream fields(line);
+        Trigger_Config config;
+        std::string shape;
+        if (!(fields >> config.name)) continue;
+        bool ok = (bool)(fields >> shape);
+        if (ok && shape == "box") {
+            config.shape = TRIGGER_BOX;
+            ok = (bool)(fields >> config.box.min.x >> config.box.min.y >> config.box.min.z
+                              >> config.box.max.x >> config.box.max.y >> config.box.max.z);
+        }
+        else if (ok && shape == "sphere") {
+            config.shape = TRIGGER_SPHERE;
+            std::string first;
+            ok = (bool)(fields >> first);
+            if (ok && first[0] == '@') config.anchor = first.substr(1);
+            else if (ok) {
+                std::istringstream x(first);
+                ok = (bool)(x >> config.center.x) && (bool)(fields >> config.center.y >> config.center.z);
+            }
+            ok = ok && (bool)(fields >> config.radius);
+        }
+        else ok = false;
+        ok = ok && (bool)(fields >> config.action);
+        if (!ok) {
+            std::cout << "ERROR: " << path << ":" << line_number << ": bad trigger definition" << std::endl;
+            continue;
+        }
+        float argument;
+        while (fields >> argument) config.arguments.push_back(argument);
+        configs.push_back(config);
+    }
+    return true;
+}
+
+int Trigger_System::add(const Trigger_Volume& trigger) {
+    triggers.push_back(trigger);
+    inside.push_back(false);
+    insert_into_hash(triggers.size() - 1);
+    return triggers.size() - 1;
+}
+
+int Trigger_System::add_box(std::string name, const AABB& box, Trigger_Callback callback) {
+    Trigger_Volume trigger;
+    trigger.name = name;
+    trigger.shape = TRIGGER_BOX;
+    trigger.box = box;
+    trigger.callback = callback;
+    return add(trigger);
+}
+
+int Trigger_System::add_sphere(std::string name, glm::vec3 center, float radius, Trigger_Callback callback) {
+    Trigger_Volume trigger;
+    trigger.name = name;
+    trigger.shape = TRIGGER_SPHERE;
+    trigger.center = center;
+    trigger.radius = radius;
+    trigger.callback = callback;
+    return add(trigger);
+}
+
+int Trigger_System::find(std::string name) {
+    for (size_t i = 0; i < triggers.size(); i++) {
+        if (triggers[i].name == name) return i;
+    }
+    return -1;
+}
+
+void Trigger_System::set_box(int trigger, const AABB& box) {
+    if (trigger < 0 || trigger >= (int)triggers.size()) {
+        std::cout << "ERROR: Trigger_System has no trigger " << trigger << std::endl;
+        return;
+    }
+    Trigger_Volume& t = triggers[trigger];
+    if (t.box.min == box.min && t.box.max == box.max) return;
+    remove_from_hash(trigger);
+    t.box = box;
+    insert_into_hash(trigger);
+}
+
+void Trigger_System::set_sphere(int trigger, glm::vec3 center, float radius) {
+    if (trigger < 0 || trigger >= (int)triggers.size()) {
+        std::cout << "ERROR: Trigger_System has no trigger " << trigger << std::endl;
+        return;
+    }
+    Trigger_Volume& t = triggers[trigger];
+    if (t.center == center && t.radius == radius) return;
+    //Only touch the hash if the sphere moved into other cells
+    int x0, z0, x1, z1, nx0, nz0, nx1, nz1;
+    cell_range(extent(t),x0,z0,x1,z1);
+    Trigger_Volume moved = t;
+    moved.center = center;
+    moved.radius = radius;
+    cell_range(extent(moved),nx0,nz0,nx1,nz1);
+    if (x0 != nx0 || z0 != nz0 || x1 != nx1 || z1 != nz1) {
+        remove_from_hash(trigger);
+        t = moved;
+        insert_into_hash(trigger);
+    }
+    else t = moved;
+}
+
+void Trigger_System::set_enabled(int trigger, bool enabled) {
+    if (trigger < 0 || trigger >= (int)triggers.size()) {
+        std::cout << "ERROR: Trigger_System has no trigger " << trigger << std::endl;
+        return;
+    }
+    triggers[trigger].enabled = enabled;
+}
+
+bool Trigger_System::is_inside(int trigger) {
+    if (trigger < 0 || trigger >= (int)triggers.size()) return false;
+    return inside[trigger];
+}
+
+int Trigger_System::size() {
+    return triggers.size();
+}
+
+void Trigger_System::clear() {
+    triggers.clear();
+    inside.clear();
+    inside_list.clear();
+    hash.clear();
+}
+
+bool Trigger_System::contains(const Trigger_Volume& trigger, glm::vec3 point) {
+    if (trigger.shape == TRIGGER_SPHERE) return glm::length(point - trigger.center) < trigger.radius;
+    const AABB& box = trigger.box;
+    return point.x > box.min.x && point.x < box.max.x && point.y > box.min.y && point.y < box.max.y &&
+           point.z > box.min.z && point.z < box.max.z;
+}
+
+AABB Trigger_System::extent(const Trigger_Volume& trigger) {
+    if (trigger.shape == TRIGGER_BOX) return trigger.box;
+    AABB box;
+    box.min = trigger.center - glm::vec3(trigger.radius);
+    box.max = trigger.center + glm::vec3(trigger.radius);
+    return box;
+}
+
+int64_t Trigger_System::cell_key(int x, int z) {
+    return ((int64_t)x << 32) ^ (int64_t)(uint32_t)z;
+}
+
+void Trigger_System::cell_range(const AABB& box, int& x0, int& z0, int& x1, int& z1) {
+    x0 = (int)floorf(box.min.x / TRIGGER_CELL_SIZE);
+    z0 = (int)floorf(box.min.z / TRIGGER_CELL_SIZE);
+    x1 = (int)floorf(box.max.x / TRIGGER_CELL_SIZE);
+    z1 = (int)floorf(box.max.z / TRIGGER_CELL_SIZE);
+}
+
+void Trigger_System::insert_into_hash(int trigger) {
+    int x0, z0, x1, z1;
+    cell_range(extent(triggers[trigger]),x0,z0,x1,z1);
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) hash[cell_key(x,z)].push_back(trigger);
+    }
+}
+
+void Trigger_System::remove_from_hash(int trigger) {
+    int x0, z0, x1, z1;
+    cell_range(extent(triggers[trigger]),x0,z0,x1,z1);
+    for (int x = x0; x <= x1; x++) {
+        for (int z = z0; z <= z1; z++) {
+            std::vector<int>& cell = hash[cell_key(x,z)];
+            cell.erase(std::remove(cell.begin(),cell.end(),trigger),cell.end());
+        }
+    }
+}
+
+void Trigger_System::update(glm::vec3 point) {
+    now_inside.clear();
+    std::unordered_map<int64_t, std::vector<int> >::const_iterator cell =
+        hash.find(cell_key((int)floorf(point.x / TRIGGER_CELL_SIZE),(int)floorf(point.z / TRIGGER_CELL_SIZE)));
+    if (cell != hash.end()) {
+        for (size_t i = 0; i < cell->second.size(); i++) {
+            int t = cell->second[i];
+            tests++;
+            if (triggers[t].enabled && contains(triggers[t],point)) now_inside.push_back(t);
+        }
+    }
+
+    //A point is only ever in one cell, so a trigger left behind in another cell is an exit
+    for (size_t i = 0; i < inside_list.size(); i++) {
+        int t = inside_list[i];
+        if (std::find(now_inside.begin(),now_inside.end(),t) != now_inside.end()) continue;
+        inside[t] = false;
+        if (triggers[t].callback) triggers[t].callback(t,TRIGGER_EXIT);
+    }
+    std::vector<int> previous;
+    previous.swap(inside_list);
+    for (size_t i = 0; i < now_inside.size(); i++) {
+        int t = now_inside[i];
+        inside[t] = true;
+        inside_list.push_back(t);
+    }
+    for (size_t i = 0; i < now_inside.size(); i++) {
+        int t = now_inside[i];
+        bool was_inside = std::find(previous.begin(),previous.end(),t) != previous.end();
+        if (triggers[t].callback) triggers[t].callback(t,was_inside ? TRIGGER_STAY : TRIGGER_ENTER);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef TRIGGER_VOLUME_HPP
+#define TRIGGER_VOLUME_HPP
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bounds.hpp"
+
+//Size (world units) of the spatial hash cells in x and z
+#define TRIGGER_CELL_SIZE 8.0f
+
+enum Trigger_Shape {
+    TRIGGER_BOX,
+    TRIGGER_SPHERE
+};
+
+enum Trigger_Event {
+    TRIGGER_ENTER,  //the point is inside now but was not last update
+    TRIGGER_STAY,   //inside now and last update
+    TRIGGER_EXIT    //inside last update but not now (or the trigger was disabled)
+};
+
+//Called with the trigger's handle and what happened
+typedef std::function<void(int trigger, Trigger_Event event)> Trigger_Callback;
+
+//A box (inside means min < p < max) or a sphere (inside means closer than radius to center)
+struct Trigger_Volume {
+    std::string name;
+    Trigger_Shape shape = TRIGGER_BOX;
+    AABB box;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    bool enabled = true;
+    Trigger_Callback callback;
+};
+
+//One line of a trigger file (see load_trigger_configs)
+struct Trigger_Config {
+    std::string name;
+    Trigger_Shape shape = TRIGGER_BOX;
+    AABB box;
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    //For spheres placed on a moving object ("@door" in the file): the object's name, else empty
+    std::string anchor;
+    std::string action;
+    std::vector<float> arguments;
+};
+
+//Reads trigger definitions, one per line ('#' starts a comment):
+//  name box min_x min_y min_z max_x max_y max_z action [arguments...]
+//  name sphere x y z radius action [arguments...]
+//  name sphere @object radius action [arguments...]
+//What the action names mean is up to the caller.  Returns false (after printing an error) if
+//the file cannot be opened; malformed lines are reported and skipped.
+bool load_trigger_configs(std::string path, std::vector<Trigger_Config>& configs);
+
+//Trigger volumes tested against one point (the player) per update.  Triggers are bucketed in
+//an x/z spatial hash, so an update only tests the triggers in the point's cell plus the ones
+//the point was inside last time.
+class Trigger_System {
+    public:
+        //Adds a trigger and returns its handle.
+        int add(const Trigger_Volume& trigger);
+        int add_box(std::string name, const AABB& box, Trigger_Callback callback);
+        int add_sphere(std::string name, glm::vec3 center, float radius, Trigger_Callback callback);
+        //Handle of the first trigger with the name, or -1
+        int find(std::string name);
+        //Moves a trigger (does nothing if it is unchanged)
+        void set_box(int trigger, const AABB& box);
+        void set_sphere(int trigger, glm::vec3 center, float radius);
+        void set_enabled(int trigger, bool enabled);
+        //True if the point was inside the trigger at the last update
+        bool is_inside(int trigger);
+        int size();
+        void clear();
+
+        //Tests the point and calls the callbacks: exits first, then enters and stays.
+        void update(glm::vec3 point);
+
+        //Triggers tested since the last reset
+        unsigned int tests = 0;
+
+    private:
+        bool contains(const Trigger_Volume& trigger, glm::vec3 point);
+        AABB extent(const Trigger_Volume& trigger);
+        void insert_into_hash(int trigger);
+        void remove_from_hash(int trigger);
+        void cell_range(const AABB& box, int& x0, int& z0, int& x1, int& z1);
+        static int64_t cell_key(int x, int z);
+
+        std::vector<Trigger_Volume> triggers;
+        std::vector<bool> inside;
+        //Triggers inside at the last update
+        std::vector<int> inside_list;
+        std::unordered_map<int64_t, std::vector<int> > hash;
+        std::vector<int> now_inside;
+};
+
+#endif //TRIGGER_VOLUME_HPP
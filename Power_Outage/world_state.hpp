@@ -10,27 +10,74 @@
 #include "post_processor.hpp"
 #include "text_display.hpp"
 #include "skybox.hpp"
-
-struct Draw_Data {
-  Shape* shape;
-  Shader* shader;
-  unsigned int texture = -1;
-};
+#include "frame_uniforms.hpp"
+#include "render_queue.hpp"
+#include "spatial_index.hpp"
+#include "collision_world.hpp"
+#include "trigger_volume.hpp"
+
+//Ids of the moving objects in World::scene_index (queued objects use their queue handle)
+#define SCENE_DOOR_ID -1
+#define SCENE_KEY_ID -2
+#define SCENE_PLATE_ID -3
+//Ids from here on are single instances of DRAW_INSTANCED items (see World::indexed_instances)
+#define SCENE_INSTANCE_ID 0x40000000
 
 class World {
   public:
     //Create the world state using provided window dimensions.
     World(int width, int height);
     void process_input(GLFWwindow* win);
-    void render_scene (std::map<std::string, Draw_Data> objects,Shader *optional_shader = NULL);
+    //Uploads this frame's camera and light blocks.  Call once per frame before render_scene.
+    void update_frame_uniforms();
+    //Draws the queued objects, then the moving objects, outlines, skybox and text.  With a depth
+    //shader (the shadow pass) items flagged DRAW_SHADOW_SHADER are drawn with it instead.
+    void render_scene (Render_Queue& queue,Shader *optional_shader = NULL);
     void render_stencils(Shader* fill_program, Shader* import_program);
+    //Puts the queued objects and the door, key and plate into scene_index (rebuilding it).
+    //Every instance of a DRAW_INSTANCED item gets its own box, so each pass only draws the
+    //instances in its view.  Call again after adding to or moving items in the queue.
+    void index_scene(Render_Queue& queue);
     glm::mat4 getLightPOV();
     void check_collision(glm::vec3 previous_pos);
-    void check_portal_teleport();
+    //Reads the level's trigger file and binds its actions.  Call once door, plate and key are set.
+    void setup_triggers(std::string path);
+    //Moves the triggers that follow an object and tests the player against all of them.
+    void update_triggers();
+    //Turns the instance ids of a scene_index query into their items' handles and selects
+    //the instances each instanced item draws
+    void select_visible_instances(Render_Queue& queue, std::vector<int>& ids);
+    //Makes the instanced items draw every instance (culling off)
+    void select_all_instances(Render_Queue& queue);
     
     glm::vec4 clear_color = glm::vec4(0.0f,0.0f,0.0f,1.0f);
     bool rgba_array[4] = {false,false,false,false};
-    unsigned int floor_texture = 0;
+
+    //Skip queued objects outside the pass's view (the camera's, or the light's for shadows)
+    bool frustum_culling = true;
+
+    //BVH over the scene's objects for frustum, proximity and ray queries.  The moving
+    //objects' boxes are refit at the start of each render_scene.
+    Spatial_Index scene_index;
+    int door_proxy = -1;
+    int key_proxy = -1;
+    int plate_proxy = -1;
+    //Instance boxes in scene_index: id SCENE_INSTANCE_ID + i is indexed_instances[i]
+    struct Indexed_Instance {
+      int item;
+      int instance;
+    };
+    std::vector<Indexed_Instance> indexed_instances;
+    //Queue handles of the items whose instances are culled one by one
+    std::vector<int> instanced_items;
+    //Instances each item drew in the last pass (kept to reuse the allocations)
+    std::vector<std::vector<int> > visible_instances;
+    //Instances of the instanced items drawn and skipped by the culling since the last reset
+    Cull_Stats instance_cull_stats;
+
+    //Programs render_stencils draws the outlines and the outlined objects with
+    Shader* stencil_fill_program = NULL;
+    Shader* stencil_import_program = NULL;
 
     //Point Light
     bool point_light_on = true;
@@ -53,14 +100,33 @@ class World {
     glm::vec3 dir_light_direction = glm::vec3(1.0,-1.0,1.0);
     glm::vec3 dir_light_color = glm::vec3(0.4f,0.4f,0.4f);
 
-    //Teleport Locations
-    glm::vec3 teleport1_pos = glm::vec3(-50.0f,-3.0f,75.0f);
-    glm::vec3 teleport2_pos = glm::vec3(80.0f,-3.0f,75.0f);
-    glm::vec3 teleport3_pos = glm::vec3(-50.0f,-3.0f,-75.0f);
-    glm::vec3 teleport4_pos = glm::vec3(85.0f,-3.0f,-70.0f);
+    //Portals, door, plate and key proximity (levels/office_triggers.txt)
+    Trigger_System triggers;
+    //Set by the trigger callbacks while the player is inside the corresponding trigger
+    bool near_door = false;
+    bool near_plate = false;
+    bool near_plate_outline = false;
+    bool near_key = false;
+    bool near_keyhole = false;
+    //Spheres placed on a moving object (SCENE_DOOR_ID, SCENE_KEY_ID or SCENE_PLATE_ID)
+    struct Anchored_Trigger {
+      int trigger;
+      int object;
+      float radius;
+    };
+    std::vector<Anchored_Trigger> anchored_triggers;
+
+    //Walls, furniture and buildings the player bumps into.  The player is a sphere of
+    //player_radius, player_body_drop below the camera (so that it hits desks and chairs).
+    Collision_World collision_world;
+    float player_radius = 0.2f;
+    float player_body_drop = 0.6f;
+    //Collider of the office door ("door" in levels/office_walls_collision.obj), disabled while it is open
+    int door_collider = -1;
 
     //Singular key press booleans
     bool my_toggle = true;
+    bool trace_dump_flag = false;
     bool spawn_pressed = false;
 
     float deltaTime = 0.0f;
@@ -83,6 +149,8 @@ class World {
     unsigned int shadow_buffer;
     unsigned int shadow_depthMap;
     unsigned int post_buffer;
+    //Texture_Atlas of the models' textures, bound to ATLAS_TEXTURE_UNIT for the main pass (0 = none)
+    unsigned int atlas_texture = 0;
 
     //Camera
     bool cameraView_key_pressed = false;
@@ -90,6 +158,10 @@ class World {
     glm::vec3 bird_cam_pos = glm::vec3(-0.5f,50.0f,1.0f);
     glm::vec3 saved_player_pos = glm::vec3(10.0f,-3.0f,-3.0f);
     Camera* camera;
+    glm::mat4 projection = glm::mat4(1.0f);
+
+    //Per-frame uniform blocks shared by every shader program
+    Frame_Uniforms frame_uniforms;
 
     //Post Processor
     Post_Processor* post_processor;